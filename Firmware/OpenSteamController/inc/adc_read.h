@@ -32,6 +32,7 @@
 #include "lpc_types.h"
 #include "chip.h"
 #include "adc_11xx.h"
+#include "sched.h"
 
 /**
  * Defines which ADC Channels map to which functionality.
@@ -51,8 +52,13 @@ void enableJoystick(bool en);
 #define JOYSTICK_MAX_X (0x400) //!< Defines range for Joystick X Location.
 #define JOYSTICK_MAX_Y (0x400) //!< Defines range for Joystick Y Location.
 
+#define ADC_VAL_TIMEOUT (0xFFFF) //!< Returned by getAdcVal() if ADC update 
+	//!< did not complete. Outside of 10-bit ADC range.
+
 void updateAdcVals(void);
 uint16_t getAdcVal(AdcChan chan);
+uint64_t getAdcTimestamp(void);
+void setAdcUpdateNotify(Task task, uint32_t events);
 
 int adcReadCmdFnc(int argc, const char* argv[]);
 void adcReadCmdUsage(void);
@@ -31,6 +31,7 @@
 #include "lpc_types.h"
 #include "error.h"
 #include "usbd/usbd_rom_api.h"
+#include "fw_cfg.h"
 
 #ifndef __APP_USB_CFG_H_
 #define __APP_USB_CFG_H_
@@ -79,25 +80,28 @@ extern uint8_t USB_FsConfigDescriptor[];
 extern const uint8_t USB_StringDescriptor[];
 extern const uint8_t USB_DeviceQualifier[];
 
-/**
- * @brief	Find the address of interface descriptor for given class type.
- * @param	pDesc		: Pointer to configuration descriptor in which the desired class
- *			interface descriptor to be found.
- * @param	intfClass	: Interface class type to be searched.
- * @return	If found returns the address of requested interface else returns NULL.
- */
-extern USB_INTERFACE_DESCRIPTOR *find_IntfDesc(const uint8_t *pDesc, uint32_t intfClass);
-
 /**
  * @}
  */
 
 #elif (FIRMWARE_BEHAVIOR == SWITCH_WIRED_POWERA_FW)
 
+#define USB_HID_IF_NUM 0
+
 /* HID In/Out Endpoint Address */
 #define HID_EP_IN 0x81
 #define HID_EP_OUT 0x02
 
+/* CDC interfaces and endpoints. Only used if USB_COMPOSITE_CDC is set. CDC 
+   interrupt EP shares EP2 with HID, as HID only uses its OUT direction, 
+   which keeps all EPs within what USB_MAX_EP_NUM allows for.
+ */
+#define USB_CDC_CIF_NUM         1
+#define USB_CDC_DIF_NUM         2
+#define USB_CDC_IN_EP           0x83
+#define USB_CDC_OUT_EP          0x03
+#define USB_CDC_INT_EP          0x82
+
 /* The following manifest constants are used to define this memory area to be used
    by USBD ROM stack.
  */
@@ -123,6 +127,22 @@ extern const uint8_t USB_StringDescriptor[];
 extern const uint8_t USB_DeviceQualifier[];
 #endif
 
+/**
+ * @brief	Find the address of interface descriptor for given class type.
+ * @param	pDesc		: Pointer to configuration descriptor in which the desired class
+ *			interface descriptor to be found.
+ * @param	intfClass	: Interface class type to be searched.
+ * @return	If found returns the address of requested interface else returns NULL.
+ */
+extern USB_INTERFACE_DESCRIPTOR *find_IntfDesc(const uint8_t *pDesc, uint32_t intfClass);
+
+/**
+ * @brief	WriteEP/ReadEP with USB0 IRQ masked, for use outside of USB IRQ.
+ */
+uint32_t usbEpWrite(USBD_HANDLE_T hUsb, uint32_t epNum, uint8_t* data, 
+	uint32_t len);
+uint32_t usbEpRead(USBD_HANDLE_T hUsb, uint32_t epNum, uint8_t* data);
+
 
 #ifdef __cplusplus
 }
@@ -31,8 +31,43 @@
 
 #include <stdint.h>
 
+/**
+ * Defines bit position of each button in ButtonSnapshot pressed mask.
+ */
+typedef enum ButtonId {
+	BTN_STEAM = 0,
+	BTN_FRONT_L,
+	BTN_FRONT_R,
+	BTN_JOY_CLICK,
+	BTN_X,
+	BTN_Y,
+	BTN_B,
+	BTN_A,
+	BTN_R_GRIP,
+	BTN_L_GRIP,
+	BTN_R_TPAD_CLICK,
+	BTN_L_TPAD_CLICK,
+	BTN_R_TRIGGER,
+	BTN_L_TRIGGER,
+	BTN_R_BUMPER,
+	BTN_L_BUMPER,
+	NUM_BUTTONS
+} ButtonId;
+
+/**
+ * State of all buttons captured at a single point in time.
+ */
+typedef struct ButtonSnapshot {
+	uint32_t pressed; //!< Bit set (i.e. 1 << BTN_A) for each button pressed.
+	uint64_t timestamp; //!< getUsTickCnt64() value when GPIOs were read.
+} ButtonSnapshot;
+
+#define BUTTON_PRESSED(snapshot, id) (((snapshot)->pressed >> (id)) & 1)
+
 void initButtons(void);
 
+void getButtonSnapshot(ButtonSnapshot* snapshot);
+
 int getSteamButtonState(void);
 int getFrontLeftButtonState(void);
 int getFrontRightButtonState(void);
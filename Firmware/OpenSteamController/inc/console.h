@@ -31,6 +31,7 @@
 
 #include <stdio.h>
 
+void initConsole(void);
 void handleConsoleInput(void);
 
 #endif /* _SC_CONSOLE_ */
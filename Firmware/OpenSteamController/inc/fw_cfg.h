@@ -51,6 +51,30 @@
 	// above and do a clean build of the project to change the behavior of
 	// the Steam Controller.
 
+#define HID_REPORT_INTERVAL_MS (8) // How often SWITCH_WIRED_POWERA_FW 
+	// samples inputs and asks the host to poll for a report (bInterval).
+	// 1 to 255. Intervals shorter than it takes to sample all inputs lead
+	// to skipped periods (see reportStats command).
+#define HID_REPORT_LEAD_US (2000) // How long before the frame the host polls
+	// for a report in that SWITCH_WIRED_POWERA_FW starts sampling inputs.
+	// Default for reportLead command.
+
+#define USB_COMPOSITE_CDC (0) // Set to 1 to have SWITCH_WIRED_POWERA_FW also
+	// present a USB CDC console alongside the HID controller interface, so
+	// the controller can be observed and commanded while in use. CDC is
+	// always handled after HID reports and only holds off USB interrupts
+	// for the duration of ROM EP calls (see usb_cdc.c). Off by default as
+	// this changes the device class the host sees.
+
+#define USB_LINE_FLUSH (0) // Set to 1 to have DEV_BOARD_FW send console 
+	// output via USB as soon as each line is printed. By default output is
+	// coalesced into full USB packets, with anything left over sent shortly
+	// after (see USB_UART_FLUSH_DELAY_US in usb.c).
+
+#define TRACE_NUM_RECS (32) // Number of records kept by TRACE*() (see 
+	// trace.h). Must be a power of two. Each record takes 20 bytes of RAM.
+	// Set to 0 to compile out all tracing.
+
 #endif /* _FIRMWARE_CONFIG_ */
 
 
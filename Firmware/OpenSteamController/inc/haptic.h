@@ -29,6 +29,7 @@
 #define _HAPTIC_
 
 #include <stdint.h>
+#include <stdbool.h>
 
 /**
  * Defines which haptic we are communicating with.
@@ -38,6 +39,16 @@ typedef enum Haptic {
 	L_HAPTIC = 1
 } Haptic;
 
+/**
+ * Priority of a sequence being played on a haptic. A sequence will not be
+ *  interrupted by one with a lower priority.
+ */
+typedef enum HapticPriority {
+	HAPTIC_PRIO_TICK = 0, //!< Short feedback pulses (e.g. trackpad motion).
+	HAPTIC_PRIO_RUMBLE = 1, //!< Rumble requested by USB host.
+	HAPTIC_PRIO_JINGLE = 2 //!< Jingles and Notes played via commands.
+} HapticPriority;
+
 /**                                                                     
  * Contains information needed to produce a tone for a duration via     
  *  the Steam Controller haptics.                                       
@@ -45,17 +56,52 @@ typedef enum Haptic {
 typedef struct Note {                                                           
 	uint8_t dutyCycle; //!< Percentage time that pulse is high, where 
 		//!< value with 0% = 0 and 100% = 511
-	uint8_t RSVD;
+	uint8_t envelope; //!< Duty cycle envelope applied over the duration 
+		//!< of the note. See HAPTIC_ENV(). 0 means a fixed dutyCycle.
+		//!< Note that this byte is reserved in official firmware.
 	uint16_t pulseFreq; //!< Frequency of the pulse being generated for
 		//!< this note in Hz.
 	uint16_t duration; //!< Duration of the note in milliseconds.
 } Note;
 
+/**
+ * Build a Note envelope descriptor.
+ *
+ * attack, decay and release select the fraction of the note spent ramping 
+ *  duty cycle up from 0, down to the sustain level and down to 0 at the end
+ *  (0 = none, 1 = 1/8, 2 = 1/4, 3 = 1/2 of the note). sustain selects the level
+ *  held between decay and release (0 = 100%, 1 = 75%, 2 = 50%, 3 = 25% of 
+ *  dutyCycle).
+ */
+#define HAPTIC_ENV(attack, decay, sustain, release) \
+	((uint8_t)((((attack) & 0x3) << 6) | (((decay) & 0x3) << 4) | \
+	(((sustain) & 0x3) << 2) | ((release) & 0x3)))
+#define HAPTIC_ENV_ATTACK(env) (((env) >> 6) & 0x3)
+#define HAPTIC_ENV_DECAY(env) (((env) >> 4) & 0x3)
+#define HAPTIC_ENV_SUSTAIN(env) (((env) >> 2) & 0x3)
+#define HAPTIC_ENV_RELEASE(env) ((env) & 0x3)
+
+/**
+ * Function called from Timer IRQ each time a haptic needs the next Note of a
+ *  sequence. This runs at Note boundaries in the highest priority IRQ, so it
+ *  must be quick.
+ *
+ * \param[inout] ctx Context given when sequence was started.
+ * \param[out] note Next Note to be played.
+ *
+ * \return False if there are no more Notes in the sequence.
+ */
+typedef bool (*NoteSrcFnc)(void* ctx, struct Note* note);
+
 void initHaptics(void);
 int playHaptic(enum Haptic haptic, const struct Note* notes, uint32_t numNotes);
-
-void usleepHaptic(uint32_t usec);
-uint32_t getUsTickCntHaptic(void);
+int playHapticStereo(const struct Note* notesRight, uint32_t numNotesRight,
+	const struct Note* notesLeft, uint32_t numNotesLeft);
+int playHapticSrcStereo(NoteSrcFnc srcRight, void* ctxRight, 
+	NoteSrcFnc srcLeft, void* ctxLeft);
+bool hapticSeqAvailable(enum Haptic haptic);
+void queueHapticTick(enum Haptic haptic, const struct Note* note);
+void setHapticRumble(enum Haptic haptic, uint16_t freq, uint8_t dutyCycle);
 
 void hapticCmdUsage(void);
 int hapticCmdFnc(int argc, const char* argv[]);
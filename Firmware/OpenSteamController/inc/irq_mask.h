@@ -0,0 +1,71 @@
+/**
+ * \file irq_mask.h
+ * \brief Critical sections that mask only the NVIC lines that share data, so
+ *  unrelated interrupts (i.e. haptic timer) are never held off.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _IRQ_MASK_
+#define _IRQ_MASK_
+
+#include "chip.h"
+
+#include <stdint.h>
+
+#define IRQ_MASK_USE_PRIMASK (0) // Set to 1 to have enterIrqMask() disable
+	// all interrupts instead of masking specific lines. Only useful to
+	// compare max interrupt disabled window (see irqStats command).
+
+typedef uint32_t IrqMask; //!< Bit per NVIC line (i.e. layout of NVIC ISER).
+
+#define IRQ_MASK_BIT(irq) ((IrqMask)1 << (irq)) //!< Mask for single IRQn.
+
+#define IRQ_MASK_DEFERRED IRQ_MASK_BIT(RESERVED28_IRQn) //!< Reserved NVIC 
+	//!< line used to also hold off deferred tasks (PendSV), which cannot
+	//!< be masked in NVIC.
+
+#define IRQ_MASK_TPAD (IRQ_MASK_BIT(PIN_INT3_IRQn) | \
+	IRQ_MASK_BIT(PIN_INT4_IRQn) | IRQ_MASK_BIT(SSP0_IRQn) | \
+	IRQ_MASK_DEFERRED) //!< Everything that accesses trackpad SPI bus.
+#define IRQ_MASK_USB (IRQ_MASK_BIT(USB0_IRQn)) //!< Everything that calls
+	//!< USB ROM API endpoint functions.
+
+/**
+ * State needed to exit a masked critical section.
+ */
+typedef struct IrqMaskState {
+	IrqMask mask; //!< Mask requested by enterIrqMask().
+	IrqMask masked; //!< Lines that were enabled and are now masked.
+	uint32_t primask; //!< PRIMASK on entry (IRQ_MASK_USE_PRIMASK only).
+	uint32_t start; //!< SysTick value on entry (counts down).
+} IrqMaskState;
+
+void initIrqMask(void);
+IrqMaskState enterIrqMask(IrqMask mask);
+void exitIrqMask(IrqMaskState state);
+
+int irqStatsCmdFnc(int argc, const char* argv[]);
+void irqStatsCmdUsage(void);
+
+#endif /* _IRQ_MASK_ */
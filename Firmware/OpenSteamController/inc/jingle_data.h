@@ -36,6 +36,7 @@
 
 #include <stdint.h>
 
+void initJingles(void);
 uint8_t getNumJingles(void);
 int playJingle(uint8_t idx);
 
@@ -0,0 +1,77 @@
+/**
+ * \file sched.h
+ * \brief Run-to-completion task scheduler. Work is posted to tasks as event flags
+ *  (safe from any ISR) and tasks run either deferred (in PendSV, below all
+ *  other interrupts) or in thread mode (main loop).
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _SCHED_
+#define _SCHED_
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Defines all tasks. Lower values run first when more than one task in the
+ *  same context is ready.
+ */
+typedef enum Task {
+	TASK_ADC = 0, //!< Average accumulated ADC samples.
+	TASK_TPAD, //!< Convert AnyMeas ADC values to trackpad X/Y location.
+	TASK_REPORT, //!< Sample inputs and send status reports to host.
+	TASK_USB_CDC, //!< Move data between USB CDC EPs and console FIFOs. 
+		//!< After TASK_REPORT so console traffic never delays reports.
+	TASK_CONSOLE, //!< Handle console input.
+	TASK_WDOG, //!< Watchdog heartbeat.
+	TASK_JINGLE, //!< Prefetch Jingle Data being played from EEPROM.
+	NUM_TASKS
+} Task;
+
+/**
+ * Defines where a task runs.
+ */
+typedef enum TaskCtx {
+	TASK_CTX_DEFERRED = 0, //!< Runs in PendSV. Preempts thread mode (i.e.
+		//!< blocking console commands) but is preempted by all other
+		//!< interrupts. Must not block.
+	TASK_CTX_THREAD, //!< Runs from main loop in runSched(). May block.
+	NUM_TASK_CTXS
+} TaskCtx;
+
+/**
+ * Function that implements a task.
+ *
+ * \param events All event flags posted to the task since it last ran.
+ */
+typedef void (*TaskFnc)(uint32_t events);
+
+void initSched(void);
+void registerTask(Task task, TaskFnc fnc, TaskCtx ctx);
+void postTaskEvent(Task task, uint32_t events);
+bool lockDeferredTasks(void);
+void unlockDeferredTasks(void);
+void runSched(void);
+
+#endif /* _SCHED_ */
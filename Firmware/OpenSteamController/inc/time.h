@@ -31,11 +31,59 @@
 #define _TIME_
 
 #include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Function called from Timer IRQ when a software timer expires. Must be short
+ *  as it holds off all other software timers.
+ *
+ * \param[in] ctx Context pointer given to initSwTimer().
+ */
+typedef void (*SwTimerCallback)(void* ctx);
+
+/**
+ * Software timer. Any number of these can be active at once and all share a 
+ *  single hardware timer. Contents are managed by time.c, do not modify 
+ *  directly.
+ */
+typedef struct SwTimer {
+	struct SwTimer* next; //!< Next timer in same timer wheel slot.
+	uint32_t deadline; //!< Absolute getUsTickCnt() value at which timer 
+		//!< expires.
+	uint32_t period; //!< Number of microseconds between expirations for a
+		//!< periodic timer. 0 for a one-shot timer.
+	SwTimerCallback callback; //!< Called on expiration. May be NULL if only
+		//!< expired flag is needed.
+	void* ctx; //!< Passed to callback.
+	volatile bool active; //!< True while timer is in the timer wheel.
+	volatile bool expired; //!< Set on expiration. Cleared by 
+		//!< swTimerExpired() and startSwTimer().
+} SwTimer;
+
+/**
+ * Condition checked by waitUntil().
+ *
+ * \param[in] ctx Context pointer given to waitUntil().
+ *
+ * \return True once the condition being waited for is met.
+ */
+typedef bool (*WaitCond)(void* ctx);
+
+#define WAIT_FOREVER (0xFFFFFFFF) //!< waitUntil() timeout to never time out.
 
 void initTime(void);
 
 void usleep(uint32_t usec);
 
 uint32_t getUsTickCnt(void);
+uint64_t getUsTickCnt64(void);
+
+int waitUntil(WaitCond cond, void* ctx, uint32_t timeoutUs);
+int waitForFlag(volatile bool* flag, uint32_t timeoutUs);
+
+void initSwTimer(SwTimer* timer, SwTimerCallback callback, void* ctx);
+void startSwTimer(SwTimer* timer, uint32_t delayUs, uint32_t periodUs);
+void stopSwTimer(SwTimer* timer);
+bool swTimerExpired(SwTimer* timer);
 
 #endif /* _TIME_ */
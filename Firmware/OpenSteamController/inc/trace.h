@@ -0,0 +1,60 @@
+/**
+ * \file trace.h
+ * \brief Cheap binary trace logging for hot paths and ISRs. Records hold only
+ *	a format string address, timestamp and a few arguments. Formatting is 
+ *	done on the host by Firmware/tests/trace_decode.py using the ELF.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _TRACE_
+#define _TRACE_
+
+#include "fw_cfg.h"
+
+#include <stdint.h>
+
+#define TRACE_MAX_ARGS (3) //!< Max number of 32-bit arguments per record.
+
+#if (TRACE_NUM_RECS)
+// fmt must be a string literal (or other string in flash), as only its 
+//  address is logged. Arguments are logged as 32-bit values, so %s may only
+//  be used for strings in flash and 64-bit arguments are not supported.
+#define TRACE0(fmt) traceRec(fmt, 0, 0, 0)
+#define TRACE1(fmt, a0) traceRec(fmt, (uint32_t)(a0), 0, 0)
+#define TRACE2(fmt, a0, a1) traceRec(fmt, (uint32_t)(a0), (uint32_t)(a1), 0)
+#define TRACE3(fmt, a0, a1, a2) traceRec(fmt, (uint32_t)(a0), \
+	(uint32_t)(a1), (uint32_t)(a2))
+#else
+#define TRACE0(fmt) ((void)0)
+#define TRACE1(fmt, a0) ((void)0)
+#define TRACE2(fmt, a0, a1) ((void)0)
+#define TRACE3(fmt, a0, a1, a2) ((void)0)
+#endif
+
+void traceRec(const char* fmt, uint32_t arg0, uint32_t arg1, uint32_t arg2);
+
+int traceCmdFnc(int argc, const char* argv[]);
+void traceCmdUsage(void);
+
+#endif /* _TRACE_ */
@@ -29,6 +29,8 @@
 #ifndef _TRACKPAD_ 
 #define _TRACKPAD_
 
+#include "sched.h"
+
 #include <stdint.h>
 
 /**
@@ -45,7 +47,9 @@ typedef enum Trackpad_t {
 void initTrackpad(void);
 
 void trackpadLocUpdate(Trackpad trackpad);
-void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc);
+int trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc);
+uint64_t trackpadGetLastTimestamp(Trackpad trackpad);
+void setTrackpadUpdateNotify(Trackpad trackpad, Task task, uint32_t events);
 
 void trackpadCmdUsage(void);
 int trackpadCmdFnc(int argc, const char* argv[]);
@@ -31,6 +31,10 @@
 #ifndef _STEAM_CONTROLLER_USB_
 #define _STEAM_CONTROLLER_USB_
 
+#define USB_CDC_CONSOLE ((FIRMWARE_BEHAVIOR == DEV_BOARD_FW) || \
+	(USB_COMPOSITE_CDC)) //!< Set if build has a USB CDC console. usb_*() 
+	//!< functions do nothing otherwise.
+
 int usbConfig(void);
 
 int usb_flush(void);
@@ -38,9 +42,13 @@ int usb_putc(int character);
 void usb_putb(const char* buff, uint32_t len);
 int usb_tstc(void);
 int usb_getc(void);
+uint32_t usb_getb(char* buff, uint32_t len, uint32_t timeoutUs);
 
 #if (FIRMWARE_BEHAVIOR == SWITCH_WIRED_POWERA_FW)
-void updateControllerStatusPacket(void);
+int reportLeadCmdFnc(int argc, const char* argv[]);
+void reportLeadCmdUsage(void);
+int reportStatsCmdFnc(int argc, const char* argv[]);
+void reportStatsCmdUsage(void);
 #endif
 
 #endif /* _STEAM_CONTROLLER_USB_ */
@@ -0,0 +1,39 @@
+/**
+ * \file usb_cdc.h
+ * \brief USB CDC ACM interface that acts as a virtual UART for the console.
+ *  Console facing functions are declared in usb.h, this is only for setting
+ *  up the interface as part of a USB configuration.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _USB_CDC_
+#define _USB_CDC_
+
+#include "usb.h"
+#include "app_usbd_cfg.h"
+
+ErrorCode_t usbCdcInit(USBD_HANDLE_T usbHandle, 
+	const USB_CORE_DESCS_T* usbDescs, USBD_API_INIT_PARAM_T* usbParams);
+
+#endif /* _USB_CDC_ */
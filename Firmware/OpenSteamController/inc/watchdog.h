@@ -0,0 +1,71 @@
+/**
+ * \file watchdog.h
+ * \brief Supervises system with Windowed Watchdog Timer, resetting the chip if
+ *  any part of the system stops checking in (i.e. stuck ISR or busy loop).
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _WATCHDOG_
+#define _WATCHDOG_
+
+#include "sched.h"
+
+#include <stdint.h>
+
+/**
+ * Defines everything that must check in for watchdog to be fed. Watchdog is
+ *  only fed once all clients have checked in since the last feed.
+ */
+typedef enum WdogClient {
+	WDOG_CLIENT_THREAD = 0, //!< Thread mode. Checks in each time it wakes
+		//!< up or waits (i.e. runSched(), usleep(), waitUntil()).
+	WDOG_CLIENT_DEFERRED, //!< Deferred tasks. Checks in from a heartbeat
+		//!< task posted each time watchdog timer callback runs.
+	NUM_WDOG_CLIENTS
+} WdogClient;
+
+/**
+ * Defines code locations that are recorded so the cause of a hang can be 
+ *  determined after a watchdog reset.
+ */
+typedef enum WdogMarker {
+	WDOG_MARK_NONE = 0, //!< No marker recorded.
+	WDOG_MARK_INIT, //!< Running init before scheduler started.
+	WDOG_MARK_RUNNING, //!< Scheduler running.
+	WDOG_MARK_EEPROM_LOCK, //!< Hard lock due to failed EEPROM read.
+	WDOG_MARK_HW_VER_LOCK, //!< Hard lock due to untested HW version.
+	WDOG_MARK_TPAD_SETUP, //!< Setting up trackpad ASIC.
+	WDOG_MARK_TPAD_CC, //!< Waiting for trackpad Command Complete.
+	WDOG_MARK_TPAD_ERA, //!< Waiting for trackpad ERA write to complete.
+	NUM_WDOG_MARKERS
+} WdogMarker;
+
+void initWatchdog(void);
+void watchdogCheckIn(WdogClient client);
+WdogMarker watchdogMark(WdogMarker marker);
+Task watchdogSetTask(Task task);
+void watchdogLock(WdogMarker marker) __attribute__((noreturn));
+void printWatchdogStats(void);
+
+#endif /* _WATCHDOG_ */
@@ -30,6 +30,7 @@
 #include "clock_11xx.h"
 #include "usb.h"
 #include "time.h"
+#include "sched.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -42,6 +43,69 @@
 static LPC_ADC_T* adcRegs = LPC_ADC;
 static ADC_CLOCK_SETUP_T adcSetup; 
 
+static volatile uint16_t adcData[8]; //!< Stores most recently averaged ADC
+	//!< values. Call updateAdcVals() to update this.
+
+static uint32_t adcAccums[8]; //!< ADC samples accumulated by ISR. Averaged
+	//!< into adcData by ADC task.
+
+static volatile int adcUpdateCnt = 0; //!< Used to count how many times ADC data is 
+	//!< accumulated in ISR.
+
+static const int ADC_UPDATE_CNT_DONE = 8; //!< Defines when ISR has fired enough
+	//!< times and adcAccums are ready to be averaged.
+
+static uint64_t adcAccumsTimestamp; //!< getUsTickCnt64() value when last
+	//!< sample was accumulated into adcAccums.
+static volatile uint64_t adcDataTimestamp; //!< Capture time of adcData.
+
+static volatile bool adcValsReady = true; //!< Set by ADC task once adcData is
+	//!< up to date with latest ADC readings.
+
+static const uint32_t ADC_TIMEOUT_US = 10000; //!< How long to wait for an
+	//!< update before assuming ADC is wedged. An update normally takes well
+	//!< under 1ms.
+
+static Task adcNotifyTask = NUM_TASKS; //!< Task to post to when adcData is
+	//!< updated. NUM_TASKS for none.
+static uint32_t adcNotifyEvents; //!< Events to post to adcNotifyTask.
+
+/**
+ * Deferred task that averages ADC samples once ISR has accumulated all of 
+ *  them. This keeps the divides out of the ISR.
+ *
+ * \param events Not used.
+ *
+ * \return None.
+ */
+static void adcTask(uint32_t events) {
+	// Divide accumulated values to get average
+	for (int idx = 0; idx < 8; idx++) {
+		adcData[idx] = adcAccums[idx] / ADC_UPDATE_CNT_DONE;
+	}
+	adcDataTimestamp = adcAccumsTimestamp;
+
+	adcValsReady = true;
+
+	if (adcNotifyTask != NUM_TASKS) {
+		postTaskEvent(adcNotifyTask, adcNotifyEvents);
+	}
+}
+
+/**
+ * Define task to be notified each time a requested ADC update (i.e. via 
+ *  updateAdcVals()) completes.
+ *
+ * \param task Task to post to. NUM_TASKS to disable notification.
+ * \param events Events to post to task.
+ *
+ * \return None.
+ */
+void setAdcUpdateNotify(Task task, uint32_t events) {
+	adcNotifyEvents = events;
+	adcNotifyTask = task;
+}
+
 /**
  * Setup all clocks, peripherals, etc. so the ADC chnanels can be read.
  *
@@ -92,6 +156,8 @@ void initAdc(void) {
 
 	// Disable clock to ADC until we need to update readings
 	Chip_Clock_DisablePeriphClock(SYSCTL_CLOCK_ADC);
+
+	registerTask(TASK_ADC, adcTask, TASK_CTX_DEFERRED);
 	
 	NVIC_EnableIRQ(ADC_IRQn);
 }
@@ -132,15 +198,6 @@ void enableJoystick(bool en) {
 	Chip_Clock_DisablePeriphClock(SYSCTL_CLOCK_ADC);
 }
 
-static volatile uint16_t adcData[8]; //!< Stores most recently averaged ADC
-	//!< values. Call updateAdcVals() to update this.
-
-static volatile int adcUpdateCnt = 0; //!< Used to count how many times ADC data is 
-	//!< accumulated in ISR.
-
-static const int ADC_UPDATE_CNT_DONE = 8; //!< Defines when ISR has fired enough
-	//!< times and adcData is up to date with latest ADC readings.
-
 /**
  * This will start new conversion of all enabled ADC channels and return
  *  immediately. Used getAdcVal() to wait for conversion to complete. These
@@ -150,11 +207,13 @@ static const int ADC_UPDATE_CNT_DONE = 8; //!< Defines when ISR has fired enough
  * \return None.
  */
 void updateAdcVals(void) {
+	adcValsReady = false;
+
 	// Clear counter used by ISR
 	adcUpdateCnt = 0; 
 
-	// Clear adcData
-	memset((void*)adcData, 0, sizeof(adcData));
+	// Clear accumulators
+	memset(adcAccums, 0, sizeof(adcAccums));
 
 	// Enable clock to ADC
 	Chip_Clock_EnablePeriphClock(SYSCTL_CLOCK_ADC);
@@ -182,17 +241,17 @@ void ADC_IRQHandler(void) {
 	for (int idx = 0; idx < 8; idx++) {
 		uint16_t retval = 0;
 		if (SUCCESS == Chip_ADC_ReadValue(adcRegs, idx, &retval))
-			adcData[idx] += retval;
+			adcAccums[idx] += retval;
 	}
 
 	if (adcUpdateCnt == ADC_UPDATE_CNT_DONE) {
-		// Divide accumulated values to get average
-		for (int idx = 0; idx < 8; idx++) {
-			adcData[idx] /= ADC_UPDATE_CNT_DONE;
-		}
+		adcAccumsTimestamp = getUsTickCnt64();
 
 		// Shutdown ADC until next request for update
 		Chip_Clock_DisablePeriphClock(SYSCTL_CLOCK_ADC);
+
+		// Leave averaging to task
+		postTaskEvent(TASK_ADC, 1);
 	}
 }
 
@@ -202,19 +261,43 @@ void ADC_IRQHandler(void) {
  *
  * Note: updateAdcVals() dicates when ADC samples are started. Make sure it has
  *  recently been called or returned value may be stale.
+ *
+ * Note: Averaging is done by TASK_ADC, which runs in PendSV and so cannot 
+ *  preempt an ISR or deferred task. Only thread context waits. From handler 
+ *  mode the last averaged value is returned right away (i.e. wait for the 
+ *  ADC update notification before calling this from a task).
  * 
  * \param chan ADC channel to retrieve data from.
  * 
- * \return The raw ADC value.
+ * \return The raw ADC value. ADC_VAL_TIMEOUT if update did not complete in
+ *	time.
  */
 uint16_t getAdcVal(AdcChan chan) {
 	// Wait for ADC samples to be accumulated and averaged
-	while (adcUpdateCnt < ADC_UPDATE_CNT_DONE) {
+	if (!__get_IPSR() && waitForFlag(&adcValsReady, ADC_TIMEOUT_US)) {
+		return ADC_VAL_TIMEOUT;
 	}
 
 	return adcData[chan];
 }
 
+/**
+ * Get the capture time of the values returned by getAdcVal(). If 
+ *  conversions/averaging is ongoing this function will wait until it is 
+ *  complete. Only waits in thread context (see getAdcVal()).
+ *
+ * \return getUsTickCnt64() value when the last sample of the averaged burst
+ *	was taken. Capture time of previous values if update did not complete in
+ *	time.
+ */
+uint64_t getAdcTimestamp(void) {
+	if (!__get_IPSR()) {
+		waitForFlag(&adcValsReady, ADC_TIMEOUT_US);
+	}
+
+	return adcDataTimestamp;
+}
+
 /**
  * Print command usage details to console.
  *
@@ -248,6 +331,11 @@ int adcReadCmdFnc(int argc, const char* argv[]) {
 
 		updateAdcVals();
 
+		if (getAdcVal(ADC_CH6) == ADC_VAL_TIMEOUT) {
+			printf("\nTimed out waiting for ADC update\n");
+			return -1;
+		}
+
 		printf("0x%08x ", getUsTickCnt());
 
 		adc_val = getAdcVal(ADC_CH6);
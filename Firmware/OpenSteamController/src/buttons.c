@@ -53,6 +53,33 @@
 #define GPIO_X_BTN 1, 9
 #define GPIO_A_BTN 0, 17
 
+/**
+ * Port and pin for a button GPIO.
+ */
+typedef struct ButtonGpio {
+	uint8_t port;
+	uint8_t pin;
+} ButtonGpio;
+
+static const ButtonGpio buttonGpios[NUM_BUTTONS] = {
+	[BTN_STEAM] = {GPIO_STEAM_BTN},
+	[BTN_FRONT_L] = {GPIO_FRONT_L},
+	[BTN_FRONT_R] = {GPIO_FRONT_R},
+	[BTN_JOY_CLICK] = {GPIO_ANALOG_JOY_CLICK},
+	[BTN_X] = {GPIO_X_BTN},
+	[BTN_Y] = {GPIO_Y_BTN},
+	[BTN_B] = {GPIO_B_BTN},
+	[BTN_A] = {GPIO_A_BTN},
+	[BTN_R_GRIP] = {GPIO_R_GRIP},
+	[BTN_L_GRIP] = {GPIO_L_GRIP},
+	[BTN_R_TPAD_CLICK] = {GPIO_R_TRACKPAD},
+	[BTN_L_TPAD_CLICK] = {GPIO_L_TRACKPAD},
+	[BTN_R_TRIGGER] = {GPIO_R_TRIGGER},
+	[BTN_L_TRIGGER] = {GPIO_L_TRIGGER},
+	[BTN_R_BUMPER] = {GPIO_R_BUMPER},
+	[BTN_L_BUMPER] = {GPIO_L_BUMPER},
+}; //!< GPIO for each button, indexed by ButtonId.
+
 /**
  * Initialize GPIOs used to read button states.
  *
@@ -93,6 +120,30 @@ void initButtons(void) {
 		IOCON_MODE_PULLUP, IOCON_FUNC0);
 }
 
+/**
+ * Capture state of all buttons at once. Both GPIO ports are read back to back
+ *  so all buttons reflect the same instant. Safe to call from any context.
+ *
+ * \param[out] snapshot Filled in with button states and capture time.
+ *
+ * \return None.
+ */
+void getButtonSnapshot(ButtonSnapshot* snapshot) {
+	uint32_t ports[2];
+	ports[0] = Chip_GPIO_GetPortValue(LPC_GPIO, 0);
+	ports[1] = Chip_GPIO_GetPortValue(LPC_GPIO, 1);
+	snapshot->timestamp = getUsTickCnt64();
+
+	// Buttons are active low
+	uint32_t pressed = 0;
+	for (int id = 0; id < NUM_BUTTONS; id++) {
+		if (!(ports[buttonGpios[id].port] & (1 << buttonGpios[id].pin))) {
+			pressed |= 1 << id;
+		}
+	}
+	snapshot->pressed = pressed;
+}
+
 /**
  * \return true if Steam Button is being pressed. False otherwise.
  */
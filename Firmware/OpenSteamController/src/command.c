@@ -43,6 +43,8 @@
 #include "buttons.h"
 #include "test.h"
 #include "time.h"
+#include "irq_mask.h"
+#include "trace.h"
 
 #include <stdlib.h>
 #include <string.h>
@@ -91,12 +93,18 @@ static Cmd cmds[] = {
 	{.cmdName = "haptic", .cmdFnc = hapticCmdFnc, .cmdUsg = hapticCmdUsage},
 	{.cmdName = "help", .cmdFnc = helpCmdFnc, .cmdUsg = helpCmdUsage},
 	{.cmdName = "initStats", .cmdFnc = initStatsCmdFnc, .cmdUsg = initStatsCmdUsage},
+	{.cmdName = "irqStats", .cmdFnc = irqStatsCmdFnc, .cmdUsg = irqStatsCmdUsage},
 	{.cmdName = "jingle", .cmdFnc = jingleCmdFnc, .cmdUsg = jingleCmdUsage},
 	{.cmdName = "led", .cmdFnc = ledCmdFnc, .cmdUsg = ledCmdUsage},
 	{.cmdName = "mem", .cmdFnc = memCmdFnc, .cmdUsg = memCmdUsage},
 	{.cmdName = "monitor", .cmdFnc = monitorCmdFnc, .cmdUsg = monitorCmdUsage},
+#if (FIRMWARE_BEHAVIOR == SWITCH_WIRED_POWERA_FW)
+	{.cmdName = "reportLead", .cmdFnc = reportLeadCmdFnc, .cmdUsg = reportLeadCmdUsage},
+	{.cmdName = "reportStats", .cmdFnc = reportStatsCmdFnc, .cmdUsg = reportStatsCmdUsage},
+#endif
 	{.cmdName = "trackpad", .cmdFnc = trackpadCmdFnc, .cmdUsg = trackpadCmdUsage},
 	{.cmdName = "test", .cmdFnc = testCmdFnc, .cmdUsg = testCmdUsage},
+	{.cmdName = "trace", .cmdFnc = traceCmdFnc, .cmdUsg = traceCmdUsage},
 	{.cmdName = "version", .cmdFnc = versionCmdFnc, .cmdUsg = versionCmdUsage},
 };
 
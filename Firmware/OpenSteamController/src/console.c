@@ -31,6 +31,7 @@
 #include "usb.h"
 #include "command.h"
 #include "led_ctrl.h"
+#include "sched.h"
 
 #include <stdio.h>
 #include <stdarg.h>
@@ -450,3 +451,27 @@ void handleConsoleInput(void) {
 		handleSerialChar(usb_getc());
 	}
 }
+
+/**
+ * Console task. Run in thread mode as commands may block for a long time 
+ *  (i.e. monitor). Deferred tasks keep running while they do.
+ *
+ * \param events Not used. Any event means new characters may be available.
+ *
+ * \return None.
+ */
+static void consoleTask(uint32_t events) {
+	handleConsoleInput();
+}
+
+/**
+ * Setup console to handle input as it is received.
+ *
+ * \return None.
+ */
+void initConsole(void) {
+	registerTask(TASK_CONSOLE, consoleTask, TASK_CTX_THREAD);
+
+	// Handle anything that was received before task was registered
+	postTaskEvent(TASK_CONSOLE, 1);
+}
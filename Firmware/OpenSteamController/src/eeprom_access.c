@@ -26,6 +26,7 @@
  */
 
 #include "eeprom_access.h"
+#include "sched.h"
 
 #include "lpc_types.h"
 #include "chip.h"
@@ -196,7 +197,12 @@ int eepromRead(uint32_t offset, void* readData, uint32_t numBytes){
 	// System clock frequency in kHz
 	command_param[4] = 46875;
 
+	// IAP is not reentrant and TASK_JINGLE reads EEPROM as a deferred task
+	bool unlock = lockDeferredTasks();
 	iap_entry(command_param, status_result);
+	if (unlock) {
+		unlockDeferredTasks();
+	}
 
 	return status_result[0];
 }
@@ -231,7 +237,12 @@ int eepromWrite(uint32_t offset, const void* writeData, uint32_t numBytes){
 	// System clock frequency in kHz
 	command_param[4] = 46875;
 
+	// IAP is not reentrant and TASK_JINGLE reads EEPROM as a deferred task
+	bool unlock = lockDeferredTasks();
 	iap_entry(command_param, status_result);
+	if (unlock) {
+		unlockDeferredTasks();
+	}
 
 	return status_result[0];
 }
@@ -44,25 +44,105 @@ static LPC_TIMER_T* hapticTimer = LPC_TIMER32_0; //!< Timer used to toggle
 
 static volatile bool hapticBusy[2]; //!< non-zero if the haptic is currently 
 	//!< playing a sequence.
-static const Note* hapticNotes[2]; //!< Pointer to the first note in a 
- 	//!< sequence to play on the haptics.
-static int hapticNotesIdx[2]; //!< Index of which note is currently
+static volatile HapticPriority hapticPrio[2]; //!< Priority of the sequence
+	//!< currently being played on a haptic.
+
+/**
+ * Note source for a sequence stored as an array of Notes.
+ */
+typedef struct ArrayNoteSrc {
+	const Note* notes; //!< First Note in sequence.
+	uint32_t idx; //!< Index of next Note to be played.
+	uint32_t len; //!< Number of Notes in sequence.
+} ArrayNoteSrc;
+
+static ArrayNoteSrc queuedSrcs[2]; //!< Used for ticks and rumble. Only
+	//!< accessed from Timer IRQ.
+static ArrayNoteSrc seqSrcs[2]; //!< Used for sequences started via 
+	//!< playHapticStereo().
+static NoteSrcFnc hapticSrc[2]; //!< Provides Notes of the sequence currently
 	//!< being played on a haptic.
-static int hapticNotesLen[2]; //!< The number of notes in a sequence 
-	//!< to be played on a haptic.
-static uint32_t pulseHiDur[2]; //!< Number of microseconds for which
-	//!< Haptic GPIO is high for pulse being generated for current Note.
-static uint32_t pulseLoDur[2]; //!< Number of microseconds for which
-	//!< Haptic GPIO is low for pulse being generated for current Note.
-static uint32_t pulseRptCntr[2]; //!< Down counter for the number of
-	//!< of times to geneate the pulse sequence.
-static uint32_t nextMR[2]; //!< Calculated value of what MR should be set to
-	//!< so that next IRQ occurs to change GPIO states to produce desired
-	//!< frequency. 
-
-static const uint8_t SLEEP_MR = 3; //!< MR used for sleep functionality.
-static volatile bool sleepDoneHaptic = true; //!< Flag used to indicate 
-	//!< requested sleep is complete (i.e. IRQ has fired).
+static void* hapticSrcCtx[2]; //!< Context passed to hapticSrc.
+static Note hapticNote[2]; //!< Copy of Note currently being played on a 
+	//!< haptic.
+static uint32_t hapticTicksPerUs; //!< Number of timer ticks per microsecond.
+	//!< Timer runs at the core clock so that pulse edges are not limited to
+	//!< a microsecond grid.
+static uint32_t hapticTicksPerMs; //!< Number of timer ticks per millisecond.
+
+static uint32_t pulseHiDur[2]; //!< Number of timer ticks for which Haptic
+	//!< GPIO is high for pulse being generated for current Note.
+static uint32_t pulsePeriod[2]; //!< Whole number of timer ticks for one full
+	//!< period (high plus low) of pulse being generated for current Note.
+static uint32_t pulsePeriodFrac[2]; //!< Fractional part of pulse period in
+	//!< units of 1/65536 timer ticks.
+static uint32_t pulseFracAcc[2]; //!< Accumulated fractional period error. Each
+	//!< time this carries past 1 tick the current pulse is made 1 tick
+	//!< longer, so that the average period matches the requested frequency.
+static uint32_t pulseEnd[2]; //!< Absolute timer count at which the current
+	//!< pulse period ends.
+static uint32_t noteEnd[2]; //!< Absolute timer count at which the current
+	//!< Note ends and the next Note in the sequence starts. 
+static uint32_t nextMR[2]; //!< Absolute timer count at which the next GPIO
+	//!< state change is to occur. This is what MR is set to.
+
+/**
+ * Stages of a duty cycle envelope, in the order they are played.
+ */
+typedef enum EnvStage {
+	ENV_ATTACK = 0,
+	ENV_DECAY,
+	ENV_SUSTAIN,
+	ENV_RELEASE,
+	NUM_ENV_STAGES
+} EnvStage;
+
+#define ENV_FRAC_BITS (6) //!< Number of fractional bits used for envelope
+	//!< levels and steps. Limited so that the longest possible high duration
+	//!< (in core clock ticks) still fits in an int32_t.
+
+static int32_t envLevel[2]; //!< High duration of the current pulse in units
+	//!< of 1/(2^ENV_FRAC_BITS) timer ticks.
+static int32_t envStep[2]; //!< Amount envLevel changes by each pulse in the 
+	//!< current envelope stage.
+static uint32_t envPulsesLeft[2]; //!< Number of pulses left in the current 
+	//!< envelope stage.
+static uint8_t envStage[2]; //!< Current envelope stage (see EnvStage).
+static uint32_t envStageLen[2][NUM_ENV_STAGES]; //!< Number of pulses in 
+	//!< each envelope stage for the current Note.
+static int32_t envStageLevel[2][NUM_ENV_STAGES]; //!< envLevel at the start 
+	//!< of each envelope stage for the current Note.
+static int32_t envStageStep[2][NUM_ENV_STAGES]; //!< envStep for each 
+	//!< envelope stage for the current Note.
+
+static Note tickNotes[2]; //!< Tick currently being played by a haptic. Only
+	//!< accessed from Timer IRQ.
+static volatile Note tickReqNotes[2]; //!< Tick requested to be played by a 
+	//!< haptic. Written by queueHapticTick().
+static volatile uint8_t tickReqSeq[2]; //!< Incremented by queueHapticTick() 
+	//!< after tickReqNotes is written.
+static uint8_t tickAckSeq[2]; //!< Last tickReqSeq handled by Timer IRQ.
+
+static Note rumbleNotes[2]; //!< Rumble currently being played by a haptic.
+	//!< Only accessed from Timer IRQ.
+static volatile Note rumbleReqNotes[2]; //!< Latest rumble requested for a
+	//!< haptic. Written by setHapticRumble().
+static volatile uint8_t rumbleReqSeq[2]; //!< Incremented by setHapticRumble()
+	//!< after rumbleReqNotes is written.
+static uint8_t rumbleAckSeq[2]; //!< Last rumbleReqSeq handled by Timer IRQ.
+
+static const uint16_t RUMBLE_HOLD_MS = 2000; //!< Rumble stops if it is not
+	//!< updated for this long. Guards against haptics being left on if host
+	//!< goes away mid rumble.
+
+static const uint32_t HAPTIC_START_LEAD_US = 50; //!< Number of microseconds
+	//!< in the future a sequence is scheduled to start. This gives time to
+	//!< arm both haptics so that they start on the exact same timer count.
+
+static const uint32_t HAPTIC_MAX_WAIT_TICKS = 0x40000000; //!< Longest time
+	//!< the IRQ is scheduled out in one step. Keeps every MR well within half
+	//!< the timer range, so hapticStateChangeDue() cannot mistake a long rest
+	//!< (which at the core clock can exceed half the range) for a past count.
 
 /**
  * \param haptic Defines which haptic we are referring too. 
@@ -105,61 +185,147 @@ inline static bool getHapticGpioState(enum Haptic haptic) {
 
 	return false;
 }
+
+/**
+ * \param haptic Defines which haptic we are referring too. 
+ *
+ * \return True if the timer has reached (or passed) the count at which the
+ *	next state change for the haptic is to occur.
+ */
+inline static bool hapticStateChangeDue(enum Haptic haptic) {
+	// Signed difference keeps this correct across timer wrap
+	return (int32_t)(Chip_TIMER_ReadCount(hapticTimer) - nextMR[haptic]) 
+		>= 0;
+}
+
+/**
+ * \param numPulses Number of pulses in Note.
+ * \param code 2-bit attack, decay or release code from Note envelope.
+ *
+ * \return Number of pulses in envelope stage (0, 1/8, 1/4 or 1/2 of Note).
+ */
+inline static uint32_t getEnvStageLen(uint32_t numPulses, uint8_t code) {
+	if (!code) {
+		return 0;
+	}
+	return numPulses >> (4 - code);
+}
+
 /**
- * Convert data from Note struct to microsecond durations and counter values to
- *  to be used by interrupt handler for toggling GPIO appropriately.
+ * Compute envelope stages for a Note so that the IRQ only needs to do one
+ *  add per pulse to follow the envelope.
  * 
  * \param haptic Defines which haptic we are referring too. 
- * \param[in] note Points to Note to be played.
+ * \param envelope Envelope descriptor from Note.
+ * \param peak High duration of pulse (in timer ticks) at peak of envelope.
+ * \param numPulses Number of pulses that will be generated for Note.
  *
  * \return None.
  */
-static void startHapticNote(Haptic haptic, const struct Note* note) {
-	// Make sure pointer is valid
-	if (!note) {
-		return;
+static void setupEnvelope(Haptic haptic, uint8_t envelope, uint32_t peak,
+	uint32_t numPulses) {
+	int32_t peak_lvl = peak << ENV_FRAC_BITS;
+	int32_t sustain_lvl = peak_lvl - 
+		(peak_lvl >> 2) * HAPTIC_ENV_SUSTAIN(envelope);
+
+	uint32_t* len = envStageLen[haptic];
+	len[ENV_ATTACK] = getEnvStageLen(numPulses, 
+		HAPTIC_ENV_ATTACK(envelope));
+	len[ENV_DECAY] = getEnvStageLen(numPulses - len[ENV_ATTACK],
+		HAPTIC_ENV_DECAY(envelope));
+	len[ENV_RELEASE] = getEnvStageLen(numPulses, 
+		HAPTIC_ENV_RELEASE(envelope));
+	if (len[ENV_RELEASE] > numPulses - len[ENV_ATTACK] - len[ENV_DECAY]) {
+		len[ENV_RELEASE] = numPulses - len[ENV_ATTACK] - len[ENV_DECAY];
 	}
+	len[ENV_SUSTAIN] = numPulses - len[ENV_ATTACK] - len[ENV_DECAY] - 
+		len[ENV_RELEASE];
+
+	// Level is stepped before each pulse, so each stage ends exactly on
+	//  the level the following stage starts from
+	int32_t* lvl = envStageLevel[haptic];
+	int32_t* step = envStageStep[haptic];
+	lvl[ENV_ATTACK] = 0;
+	step[ENV_ATTACK] = len[ENV_ATTACK] ? peak_lvl / (int32_t)len[ENV_ATTACK]
+		: 0;
+	lvl[ENV_DECAY] = peak_lvl;
+	step[ENV_DECAY] = len[ENV_DECAY] ? 
+		(sustain_lvl - peak_lvl) / (int32_t)len[ENV_DECAY] : 0;
+	lvl[ENV_SUSTAIN] = sustain_lvl;
+	step[ENV_SUSTAIN] = 0;
+	lvl[ENV_RELEASE] = sustain_lvl;
+	// Add one so that last pulse of release is not silent
+	step[ENV_RELEASE] = -sustain_lvl / (int32_t)(len[ENV_RELEASE] + 1);
+
+	envStage[haptic] = ENV_ATTACK;
+	envLevel[haptic] = lvl[ENV_ATTACK];
+	envStep[haptic] = step[ENV_ATTACK];
+	envPulsesLeft[haptic] = len[ENV_ATTACK];
+}
 
-	// Make sure note is not currently being played
-	if (hapticBusy[haptic]) {
-		return;
-	}
-	
-	if (!note->duration) {
-		return;
+/**
+ * Move on to the next envelope stage that contains pulses.
+ * 
+ * \param haptic Defines which haptic we are referring too. 
+ *
+ * \return None.
+ */
+static void nextEnvStage(Haptic haptic) {
+	uint8_t stage = envStage[haptic];
+
+	while (!envPulsesLeft[haptic] && stage < NUM_ENV_STAGES - 1) {
+		stage++;
+		envLevel[haptic] = envStageLevel[haptic][stage];
+		envStep[haptic] = envStageStep[haptic][stage];
+		envPulsesLeft[haptic] = envStageLen[haptic][stage];
 	}
 
-	// Convert data in struct Note to variables for IRQ handler
-	if (!note->dutyCycle || !note->pulseFreq) {
-		// This Note is just a delay, so keep GPIO low
-		setHapticGpioState(haptic, false);
-
-		pulseHiDur[haptic] = 0;
-		pulseLoDur[haptic] = 0;
-		pulseRptCntr[haptic] = 1;
-
-		// Setup interrupt to occur after full delay
-		nextMR[haptic] = note->duration * 1000 + 
-			Chip_TIMER_ReadCount(hapticTimer);
-		hapticTimer->MR[getHapticMR(haptic)] = nextMR[haptic]; 
-	} else {
-		uint32_t pulse_width = 1000000 / note->pulseFreq;
-
-		pulseHiDur[haptic] = (pulse_width * note->dutyCycle) / 512;
-		pulseLoDur[haptic] = pulse_width - pulseHiDur[haptic];
-		pulseRptCntr[haptic] = (note->duration * note->pulseFreq) / 1000;
-
-		// Start with haptic GPIO in high state
-		setHapticGpioState(haptic, true);
+	envStage[haptic] = stage;
+}
 
-		// Setup interrupt to occur when high portion is done
-		nextMR[haptic] = pulseHiDur[haptic] + 
-			Chip_TIMER_ReadCount(hapticTimer);
-		hapticTimer->MR[getHapticMR(haptic)] = nextMR[haptic]; 
+/**
+ * Convert data from Note struct to timer tick durations to be used by 
+ *  interrupt handler for toggling GPIO appropriately.
+ *
+ * All times are absolute on the timeline shared by both haptics. The end of a
+ *  Note is always start + duration, regardless of pulse frequency or IRQ
+ *  latency, so the haptics cannot drift relative to each other.
+ *
+ * The pulse period is kept as whole ticks plus a 16-bit fraction. Individual
+ *  pulses are a whole number of ticks, but the fraction is accumulated so 
+ *  that the average pitch is accurate to a small fraction of a cent.
+ * 
+ * \param haptic Defines which haptic we are referring too. 
+ * \param[in] note Points to Note to be played.
+ * \param start Absolute timer count at which Note starts.
+ *
+ * \return None.
+ */
+static void startHapticNote(Haptic haptic, const struct Note* note, 
+	uint32_t start) {
+	uint32_t note_ticks = note->duration * hapticTicksPerMs;
+
+	noteEnd[haptic] = start + note_ticks;
+	pulsePeriod[haptic] = 0;
+	pulsePeriodFrac[haptic] = 0;
+	pulseFracAcc[haptic] = 0;
+	pulseHiDur[haptic] = 0;
+
+	if (note->dutyCycle && note->pulseFreq) {
+		uint32_t period = SystemCoreClock / note->pulseFreq;
+		uint32_t rem = SystemCoreClock % note->pulseFreq;
+		uint32_t num_periods = note_ticks / period;
+
+		pulsePeriod[haptic] = period;
+		// rem < pulseFreq <= 65535, so this cannot overflow
+		pulsePeriodFrac[haptic] = (rem << 16) / note->pulseFreq;
+		// Last period of a Note is always low, so it does not count.
+		//  64-bit product as a 1Hz period in core clock ticks times 
+		//  dutyCycle does not fit in 32 bits
+		setupEnvelope(haptic, note->envelope, 
+			(uint32_t)(((uint64_t)period * note->dutyCycle) / 512), 
+			num_periods ? num_periods - 1 : 0);
 	}
-
-	// Mark that note is being played
-	hapticBusy[haptic] = true;
 }
 
 /**
@@ -170,58 +336,233 @@ static void startHapticNote(Haptic haptic, const struct Note* note) {
  * \return None.
  */
 static void nextHapticState(Haptic haptic) {
-	const Note* notes = hapticNotes[haptic];
-
-	if (!notes) {
-		Chip_TIMER_MatchDisableInt(hapticTimer, getHapticMR(haptic));
-	}
+	// The time at which this state change was scheduled to occur. All
+	//  following times are computed from this, not the current count
+	uint32_t now = nextMR[haptic];
 
 	if (getHapticGpioState(haptic)) {
 		// High portion of pulse is finished, on to low portion
 		setHapticGpioState(haptic, false);
-		// Setup interrupt to occur when low portion is done
-		nextMR[haptic] += pulseLoDur[haptic];
-		hapticTimer->MR[getHapticMR(haptic)] = nextMR[haptic];
+		nextMR[haptic] = pulseEnd[haptic];
 	} else {
-		// Pulse low finished (i.e. iteration of pulse is complete)
-		pulseRptCntr[haptic]--;
-
-		// Check if another pulse is to be generated for this Note
-		if (pulseRptCntr[haptic]) {
-			// If this is last repeat count stay low to create a
-			//  distinct break between notes
-			if (pulseRptCntr[haptic] > 1) {
-				// Start another high portion of pulse
-				setHapticGpioState(haptic, true);
-
-				// Setup interrupt to occur when high portion is done
-				nextMR[haptic] += pulseHiDur[haptic];
-				hapticTimer->MR[getHapticMR(haptic)] = 
-					nextMR[haptic];
-			} else {
-				// Since we are not changing GPIO state, we 
-				//  do not want to come back to ISR until
-				//  a full period has elapsed
-				nextMR[haptic] += pulseHiDur[haptic] + 
-					pulseLoDur[haptic];
-				hapticTimer->MR[getHapticMR(haptic)] = 
-					nextMR[haptic];
-			}
-		} else {
+		if (now == noteEnd[haptic]) {
 			// Attempt to move onto next note in sequence
-			hapticBusy[haptic] = false;			
-			hapticNotesIdx[haptic]++;
-			if (hapticNotesIdx[haptic] < hapticNotesLen[haptic]) {
-				startHapticNote(haptic, 
-					&notes[hapticNotesIdx[haptic]]);
-			} else {
+			if (!hapticSrc[haptic](hapticSrcCtx[haptic], 
+				&hapticNote[haptic])) {
 				// Stop interrupt from firing as all notes in 
 				//  sequence have been played
 				Chip_TIMER_MatchDisableInt(hapticTimer, 
 					getHapticMR(haptic));
+				hapticBusy[haptic] = false;
+				return;
+			}
+			startHapticNote(haptic, &hapticNote[haptic], now);
+		}
+
+		// Only start another pulse if there is time for it plus a 
+		//  full period low to create a distinct break between notes
+		uint32_t remaining = noteEnd[haptic] - now;
+		if (pulsePeriod[haptic] && remaining >= 2 * pulsePeriod[haptic]) {
+			// Follow envelope for high duration of this pulse
+			if (!envPulsesLeft[haptic]) {
+				nextEnvStage(haptic);
+			}
+			envPulsesLeft[haptic]--;
+			envLevel[haptic] += envStep[haptic];
+			pulseHiDur[haptic] = envLevel[haptic] >> ENV_FRAC_BITS;
+
+			// Carry accumulated fraction into length of this pulse
+			pulseFracAcc[haptic] += pulsePeriodFrac[haptic];
+			pulseEnd[haptic] = now + pulsePeriod[haptic] + 
+				(pulseFracAcc[haptic] >> 16);
+			pulseFracAcc[haptic] &= 0xFFFF;
+
+			if (pulseHiDur[haptic]) {
+				setHapticGpioState(haptic, true);
+				nextMR[haptic] = now + pulseHiDur[haptic];
+			} else {
+				// Envelope is silent for this pulse
+				nextMR[haptic] = pulseEnd[haptic];
 			}
+		} else if (remaining > HAPTIC_MAX_WAIT_TICKS) {
+			// Long rest, check back part way through
+			nextMR[haptic] = now + HAPTIC_MAX_WAIT_TICKS;
+		} else {
+			// Stay low until end of Note
+			nextMR[haptic] = noteEnd[haptic];
 		}
 	}
+
+	hapticTimer->MR[getHapticMR(haptic)] = nextMR[haptic];
+}
+
+/**
+ * Process all state changes for a haptic that are due. More than one may be 
+ *  due if the IRQ was delayed or a Note has very short pulses. Without this
+ *  an MR value already in the past would not match until the timer wraps.
+ * 
+ * \param haptic Defines which haptic we are referring too. 
+ *
+ * \return None.
+ */
+static void serviceHaptic(Haptic haptic) {
+	while (hapticBusy[haptic] && hapticStateChangeDue(haptic)) {
+		nextHapticState(haptic);
+	}
+}
+
+/**
+ * NoteSrcFnc for sequences stored as an array of Notes.
+ *
+ * \param[inout] ctx ArrayNoteSrc for sequence.
+ * \param[out] note Next Note to play.
+ *
+ * \return False if there are no more Notes.
+ */
+static bool arrayNoteSrc(void* ctx, struct Note* note) {
+	ArrayNoteSrc* src = (ArrayNoteSrc*)ctx;
+
+	if (src->idx >= src->len) {
+		return false;
+	}
+
+	*note = src->notes[src->idx++];
+
+	return true;
+}
+
+/**
+ * Setup a source for a sequence stored as an array of Notes.
+ *
+ * \param[out] src Source to setup. Must not be in use by Timer IRQ.
+ * \param[in] notes Buffer containing a sequence of notes to be played.
+ * \param numNotes The number of notes in the notes buffer.
+ *
+ * \return None.
+ */
+static void setArraySrc(ArrayNoteSrc* src, const struct Note* notes, 
+	uint32_t numNotes) {
+	src->notes = notes;
+	src->idx = 0;
+	src->len = numNotes;
+}
+
+/**
+ * Setup a haptic to start playing a sequence of notes at a given time.
+ *
+ * Note: Caller must make sure Timer IRQ cannot fire while this is called.
+ *
+ * \param haptic Defines which haptic is being referred to.
+ * \param src Provides the notes to be played.
+ * \param[in] ctx Context passed to src.
+ * \param epoch Absolute timer count at which first note is to start.
+ * \param prio Priority of the sequence.
+ *
+ * \return None.
+ */
+static void armHaptic(enum Haptic haptic, NoteSrcFnc src, void* ctx, 
+	uint32_t epoch, HapticPriority prio) {
+	hapticSrc[haptic] = src;
+	hapticSrcCtx[haptic] = ctx;
+
+	// Pretend a note just ended at epoch so that the first IRQ moves on
+	//  to the first note in the sequence
+	setHapticGpioState(haptic, false);
+	noteEnd[haptic] = epoch;
+	nextMR[haptic] = epoch;
+	hapticTimer->MR[getHapticMR(haptic)] = epoch;
+
+	Chip_TIMER_ClearMatch(hapticTimer, getHapticMR(haptic));
+	Chip_TIMER_MatchEnableInt(hapticTimer, getHapticMR(haptic));
+	hapticPrio[haptic] = prio;
+	hapticBusy[haptic] = true;
+}
+
+/**
+ * \param haptic Defines which haptic is being referred to.
+ * \param prio Priority of the sequence that would like to be played.
+ *
+ * \return True if a sequence with the given priority is allowed to start on 
+ *	the haptic (i.e. haptic is idle, playing something of lower priority or
+ *	both are ticks).
+ */
+inline static bool hapticAvailable(enum Haptic haptic, HapticPriority prio) {
+	if (!hapticBusy[haptic]) {
+		return true;
+	}
+	if (hapticPrio[haptic] < prio) {
+		return true;
+	}
+	return prio == HAPTIC_PRIO_TICK && hapticPrio[haptic] == HAPTIC_PRIO_TICK;
+}
+
+/**
+ * Stop whatever is being played on a haptic. Must be called from Timer IRQ.
+ *
+ * \param haptic Defines which haptic is being referred to.
+ *
+ * \return None.
+ */
+static void stopHaptic(enum Haptic haptic) {
+	Chip_TIMER_MatchDisableInt(hapticTimer, getHapticMR(haptic));
+	setHapticGpioState(haptic, false);
+	hapticBusy[haptic] = false;
+}
+
+/**
+ * Start (or update) any rumble set via setHapticRumble() and start any ticks 
+ *  that have been queued via queueHapticTick(), if the haptic is available. 
+ *  Must be called from Timer IRQ.
+ *
+ * \return None.
+ */
+static void startQueuedRequests(void) {
+	for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+		uint8_t seq = rumbleReqSeq[haptic];
+		if (seq == rumbleAckSeq[haptic]) {
+			continue;
+		}
+		rumbleAckSeq[haptic] = seq;
+
+		rumbleNotes[haptic] = *(const Note*)&rumbleReqNotes[haptic];
+		if (!rumbleNotes[haptic].dutyCycle || 
+			!rumbleNotes[haptic].pulseFreq) {
+			if (hapticBusy[haptic] && 
+				hapticPrio[haptic] == HAPTIC_PRIO_RUMBLE) {
+				stopHaptic(haptic);
+			}
+			continue;
+		}
+
+		// Restarting an in progress rumble applies new parameters 
+		//  right away
+		if (!hapticAvailable(haptic, HAPTIC_PRIO_RUMBLE) && 
+			hapticPrio[haptic] != HAPTIC_PRIO_RUMBLE) {
+			continue;
+		}
+
+		setArraySrc(&queuedSrcs[haptic], &rumbleNotes[haptic], 1);
+		armHaptic(haptic, arrayNoteSrc, &queuedSrcs[haptic], 
+			Chip_TIMER_ReadCount(hapticTimer), HAPTIC_PRIO_RUMBLE);
+	}
+
+	for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+		uint8_t seq = tickReqSeq[haptic];
+		if (seq == tickAckSeq[haptic]) {
+			continue;
+		}
+		tickAckSeq[haptic] = seq;
+
+		// Ticks do not stomp on anything more important
+		if (!hapticAvailable(haptic, HAPTIC_PRIO_TICK)) {
+			continue;
+		}
+
+		tickNotes[haptic] = *(const Note*)&tickReqNotes[haptic];
+		setArraySrc(&queuedSrcs[haptic], &tickNotes[haptic], 1);
+		armHaptic(haptic, arrayNoteSrc, &queuedSrcs[haptic], 
+			Chip_TIMER_ReadCount(hapticTimer), HAPTIC_PRIO_TICK);
+	}
 }
 
 /**
@@ -231,26 +572,18 @@ static void nextHapticState(Haptic haptic) {
  * \return None.
  */
 void TIMER32_0_IRQHandler(void) {
-	// Check if interrupt was generated by Right haptic finishing high or
-	//  low pulse
+	// Clear match flags for both haptics first and then service any that 
+	//  are due. Servicing both keeps haptics that share the same match 
+	//  count in lock step
 	if (Chip_TIMER_MatchPending(hapticTimer, getHapticMR(R_HAPTIC))) {
 		Chip_TIMER_ClearMatch(hapticTimer, getHapticMR(R_HAPTIC));
-		nextHapticState(R_HAPTIC);
 	}
-
-	// Check if interrupt was generated by Left haptic finishing high or
-	//  low pulse
 	if (Chip_TIMER_MatchPending(hapticTimer, getHapticMR(L_HAPTIC))) {
 		Chip_TIMER_ClearMatch(hapticTimer, getHapticMR(L_HAPTIC));
-		nextHapticState(L_HAPTIC);
-	}
-
-	// Check if interrupt was generated by sleep request
-	if (Chip_TIMER_MatchPending(hapticTimer, SLEEP_MR)) {
-		Chip_TIMER_ClearMatch(hapticTimer, SLEEP_MR);
-		Chip_TIMER_MatchDisableInt(hapticTimer, SLEEP_MR);
-		sleepDoneHaptic = true;
 	}
+	startQueuedRequests();
+	serviceHaptic(R_HAPTIC);
+	serviceHaptic(L_HAPTIC);
 }
 
 /**
@@ -281,8 +614,10 @@ void initHaptics(void) {
 
 	Chip_TIMER_Init(hapticTimer);
 
-	// Set the timer to increment every microsecond
-	Chip_TIMER_PrescaleSet(hapticTimer, SystemCoreClock/1000000-1);
+	// Run the timer at the core clock for the finest possible pulse edges
+	Chip_TIMER_PrescaleSet(hapticTimer, 0);
+	hapticTicksPerUs = SystemCoreClock / 1000000;
+	hapticTicksPerMs = SystemCoreClock / 1000;
 
 	// Set priority of Timer IRQ to max
 	NVIC_SetPriority(TIMER_32_0_IRQn, 0);
@@ -297,12 +632,122 @@ void initHaptics(void) {
 }
 
 
+/**
+ * \param haptic Defines which haptic is being referred to.
+ *
+ * \return True if a sequence can be started on the haptic via 
+ *	playHapticStereo() or playHapticSrcStereo(). When this is true the 
+ *	source of any previous such sequence is no longer in use by Timer IRQ.
+ */
+bool hapticSeqAvailable(enum Haptic haptic) {
+	return hapticAvailable(haptic, HAPTIC_PRIO_JINGLE);
+}
+
+/**
+ * Initiate playing sequences of notes on both haptics, with each Note being
+ *  requested from a source as it is needed (i.e. decoded on the fly). The 
+ *  sequences share a single timeline, which means they start on the same 
+ *  timer count and stay in sync for their whole length.
+ *
+ * Note: Sources and their contexts must persist until the sequences are 
+ *	finished playing (which will be after this returns).
+ * 
+ * \param srcRight Provides Notes to play on right haptic. NULL if nothing is
+ *	to be played on right haptic.
+ * \param[in] ctxRight Context passed to srcRight.
+ * \param srcLeft Provides Notes to play on left haptic. NULL if nothing is
+ *	to be played on left haptic.
+ * \param[in] ctxLeft Context passed to srcLeft.
+ *
+ * \return 0 on sucess.
+ */
+int playHapticSrcStereo(NoteSrcFnc srcRight, void* ctxRight, 
+	NoteSrcFnc srcLeft, void* ctxLeft) {
+	if ((srcRight && !hapticAvailable(R_HAPTIC, HAPTIC_PRIO_JINGLE)) ||
+		(srcLeft && !hapticAvailable(L_HAPTIC, HAPTIC_PRIO_JINGLE))) {
+		return -2;
+	}
+
+	if (!srcRight && !srcLeft) {
+		return -3;
+	}
+
+	// Keep Timer IRQ from changing match registers and interrupt enables
+	//  while haptics are being armed
+	NVIC_DisableIRQ(TIMER_32_0_IRQn);
+
+	uint32_t epoch = Chip_TIMER_ReadCount(hapticTimer) + 
+		HAPTIC_START_LEAD_US * hapticTicksPerUs;
+
+	if (srcRight) {
+		armHaptic(R_HAPTIC, srcRight, ctxRight, epoch, 
+			HAPTIC_PRIO_JINGLE);
+	}
+	if (srcLeft) {
+		armHaptic(L_HAPTIC, srcLeft, ctxLeft, epoch, 
+			HAPTIC_PRIO_JINGLE);
+	}
+
+	// In case we were held off long enough for epoch to pass, make sure
+	//  IRQ fires to get things started
+	if ((int32_t)(Chip_TIMER_ReadCount(hapticTimer) - epoch) >= 0) {
+		NVIC_SetPendingIRQ(TIMER_32_0_IRQn);
+	}
+
+	NVIC_EnableIRQ(TIMER_32_0_IRQn);
+
+	return 0;
+}
+
+/**
+ * Initiate playing sequences of notes on both haptics. The sequences share a
+ *  single timeline, which means they start on the same timer count and stay
+ *  in sync for their whole length.
+ *
+ * Note: The notes buffers must persist until the sequences are finished 
+ *	playing (which will be after this returns). Don't put this on the stack!
+ * 
+ * \param[in] notesRight Notes to play on right haptic. May be NULL if 
+ *	numNotesRight is 0.
+ * \param numNotesRight The number of notes in the notesRight buffer.
+ * \param[in] notesLeft Notes to play on left haptic. May be NULL if 
+ *	numNotesLeft is 0.
+ * \param numNotesLeft The number of notes in the notesLeft buffer.
+ *
+ * \return 0 on sucess.
+ */
+int playHapticStereo(const struct Note* notesRight, uint32_t numNotesRight,
+	const struct Note* notesLeft, uint32_t numNotesLeft) {
+	if ((numNotesRight && !notesRight) || (numNotesLeft && !notesLeft)) {
+		return -1;
+	}
+
+	// seqSrcs are only in use by Timer IRQ while a sequence of the same 
+	//  priority is playing, so check before they are changed
+	if ((numNotesRight && !hapticAvailable(R_HAPTIC, HAPTIC_PRIO_JINGLE)) ||
+		(numNotesLeft && !hapticAvailable(L_HAPTIC, HAPTIC_PRIO_JINGLE))) {
+		return -2;
+	}
+
+	// Only touch source of side being played, as other side may still be
+	//  in use by a sequence already playing on it
+	if (numNotesRight) {
+		setArraySrc(&seqSrcs[R_HAPTIC], notesRight, numNotesRight);
+	}
+	if (numNotesLeft) {
+		setArraySrc(&seqSrcs[L_HAPTIC], notesLeft, numNotesLeft);
+	}
+
+	return playHapticSrcStereo(
+		numNotesRight ? arrayNoteSrc : NULL, &seqSrcs[R_HAPTIC], 
+		numNotesLeft ? arrayNoteSrc : NULL, &seqSrcs[L_HAPTIC]);
+}
+
 /**
  * Initiate playing a sequence of notes via a particular haptic.
  *
  * Note: The notes buffer must persist until the sequence is finished playing
  *	(which will be after this returns). Don't put this on the stack!
-//TODO: It is dangerous that buffer must persist beyond function exit... Figure out a better way or split into two functions (i.e. add one that copies)!
  * 
  * \param haptic Defines which haptic is being referred to.
  * \param[in] notes Buffer containing a sequence of notes to be played.
@@ -315,56 +760,68 @@ int playHaptic(enum Haptic haptic, const struct Note* notes, uint32_t numNotes)
 		return -1;
 	}
 
-	if (hapticBusy[haptic]) {
-		return -2;
-	}
-
 	if (!numNotes) {
 		return -3;
 	}
 
-	hapticNotes[haptic] = notes;
-	hapticNotesIdx[haptic] = 0;
-	hapticNotesLen[haptic] = numNotes;
-
-	Chip_TIMER_ClearMatch(hapticTimer, getHapticMR(haptic));
-
-	startHapticNote(haptic, notes);
-
-	//TODO: need to protect this with locking mechanism?
-	Chip_TIMER_MatchEnableInt(hapticTimer, getHapticMR(haptic));
-
-	return 0;
+	if (haptic == R_HAPTIC) {
+		return playHapticStereo(notes, numNotes, NULL, 0);
+	}
+	return playHapticStereo(NULL, 0, notes, numNotes);
 }
 
 /**
- * Sleep for the specific number of microseconds.
- * 
- * \param usec The number of microseconds to sleep for.
+ * Queue a short Note (i.e. tick) to be played on a haptic as soon as possible.
+ *  Ticks have the lowest priority, so they are dropped if the haptic is busy
+ *  with anything other than another tick. This is safe to call from an ISR
+ *  and the tick starts within microseconds, as the Timer IRQ is used to pick
+ *  it up.
  * 
+ * \param haptic Defines which haptic is being referred to.
+ * \param[in] note Tick to be played. This is copied.
+ *
  * \return None.
  */
-void usleepHaptic(uint32_t usec) {
-	// Reset the flag for indicating we have slept the desired amout of time
-	sleepDoneHaptic = false;
-
-	// Setup MR to generate interrupt when sleep is complete
-	hapticTimer->MR[SLEEP_MR] = Chip_TIMER_ReadCount(hapticTimer) + usec;
-	Chip_TIMER_MatchEnableInt(hapticTimer, SLEEP_MR);
-
-	while (!sleepDoneHaptic) {
-		__WFI();
-	}
+void queueHapticTick(enum Haptic haptic, const struct Note* note) {
+	// Note is fully written before the sequence number is bumped, and Timer
+	//  IRQ only takes a Note once it sees a new sequence number. Timer IRQ
+	//  can preempt us at any point, but mid-write it still sees the old
+	//  sequence number. Once pended, it preempts us again right away and 
+	//  takes the Note before another request can start overwriting it. 
+	//  This does not cover a caller preempting another caller mid-write: 
+	//  the preempted caller then finishes writing over the newer Note, and
+	//  a mix of both is played. A caller with interrupts disabled (PRIMASK)
+	//  also holds off Timer IRQ, so a later request can replace the Note
+	//  before it is taken
+	tickReqNotes[haptic] = *note;
+	tickReqSeq[haptic]++;
+
+	NVIC_SetPendingIRQ(TIMER_32_0_IRQn);
 }
 
 /**
- * Get the current value of a timer running with usec precision.
+ * Set rumble to be played on a haptic. Rumble continues until it is changed,
+ *  set to 0, or RUMBLE_HOLD_MS pass without an update. Rumble is dropped if
+ *  a jingle is being played. This is safe to call from an ISR and takes
+ *  effect within microseconds, as the Timer IRQ is used to pick it up.
  * 
- * \return The count value for a timer configured where the count increments
- *	each usec. 
+ * \param haptic Defines which haptic is being referred to.
+ * \param freq Frequency of pulses in Hz. 0 to stop rumble.
+ * \param dutyCycle Duty cycle of pulses (see Note). 0 to stop rumble.
+ *
+ * \return None.
  */
-uint32_t getUsTickCntHaptic(void) {
-	return Chip_TIMER_ReadCount(hapticTimer);
+void setHapticRumble(enum Haptic haptic, uint16_t freq, uint8_t dutyCycle) {
+	rumbleReqNotes[haptic].dutyCycle = dutyCycle;
+	rumbleReqNotes[haptic].envelope = 0;
+	rumbleReqNotes[haptic].pulseFreq = freq;
+	rumbleReqNotes[haptic].duration = RUMBLE_HOLD_MS;
+	// Same handoff as queueHapticTick(): Timer IRQ only takes the Note once
+	//  the sequence number changes, so it must be bumped after the Note is
+	//  written. Callers preempting each other mid-write can mix Notes
+	rumbleReqSeq[haptic]++;
+
+	NVIC_SetPendingIRQ(TIMER_32_0_IRQn);
 }
 
 /**
@@ -375,12 +832,16 @@ uint32_t getUsTickCntHaptic(void) {
  */
 void hapticCmdUsage(void) {
 	printf(
-		"usage: haptic {hapticId} {dutyCycle} {frequency} {duration}\n"
+		"usage: haptic {hapticId} {dutyCycle} {frequency} {duration} "
+			"[{envelope}]\n"
 		"\n"
 		"hapticId = \"right\" or \"left\" to specify which haptic\n"
 		"dutyCycle = 0-255 for percentage pulse should be in high state\n"
 		"frequency = Frequency of pulse to generate in Hz\n"
 		"duration = Duration of repeated pulse in ms\n"
+		"envelope = Optional 0-255 duty cycle envelope. Bits 7:6 attack,\n"
+		"\t5:4 decay, 1:0 release (0, 1/8, 1/4 or 1/2 of duration) and\n"
+		"\t3:2 sustain level (100%%, 75%%, 50%% or 25%% of dutyCycle)\n"
 	);
 }
 
@@ -395,7 +856,7 @@ void hapticCmdUsage(void) {
 int hapticCmdFnc(int argc, const char* argv[]) {
 	static struct Note note = {0, 0, 0, 0};
 
-	if (argc != 5) {
+	if (argc != 5 && argc != 6) {
 		hapticCmdUsage();
 		
 		return -1;
@@ -406,6 +867,10 @@ int hapticCmdFnc(int argc, const char* argv[]) {
 	note.dutyCycle = strtol(argv[2], NULL, 0);
 	note.pulseFreq = strtol(argv[3], NULL, 0);
 	note.duration = strtol(argv[4], NULL, 0);
+	uint32_t envelope = 0;
+	if (argc == 6) {
+		envelope = strtol(argv[5], NULL, 0);
+	}
 
 	if (note.dutyCycle < 0 || note.dutyCycle > 255) {
 		printf("dutyCycle outside range 0-255\n");
@@ -420,6 +885,12 @@ int hapticCmdFnc(int argc, const char* argv[]) {
 		return -1;
 	}
 
+	if (envelope > 255) {
+		printf("envelope outside range 0-255\n");
+		return -1;
+	}
+	note.envelope = envelope;
+
 	if (!strcmp("right", argv[1])) {
 		haptic = R_HAPTIC;
 	} else if (!strcmp("left", argv[1])) {
@@ -0,0 +1,124 @@
+/**
+ * \file haptic_feedback.c
+ * \brief Generates haptic feedback (i.e. ticks) based on trackpad activity.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "haptic_feedback.h"
+
+#include "haptic.h"
+#include "fw_cfg.h"
+
+#include <stdlib.h>
+
+static volatile bool tpadFeedbackEn = 
+	(FIRMWARE_BEHAVIOR == SWITCH_WIRED_POWERA_FW); //!< Set to enable 
+	//!< generating haptic ticks as finger moves across trackpads.
+static volatile uint16_t tpadTickDist = 40; //!< Distance (in X/Y location
+	//!< units) finger has to travel across trackpad between ticks.
+
+static const Note TPAD_TICK = {
+	.dutyCycle = 255,
+	.envelope = 0,
+	.pulseFreq = 300,
+	.duration = 7
+}; //!< Tick generated as finger moves across trackpad. This works out to a
+	//!< single pulse followed by a quiet period.
+
+static bool lastFingerDown[2]; //!< Whether finger was down on last update.
+static uint16_t lastXLoc[2]; //!< X location on last update.
+static uint16_t lastYLoc[2]; //!< Y location on last update.
+static uint32_t tpadTravel[2]; //!< Distance finger has traveled since last
+	//!< tick.
+
+/**
+ * Update feedback engine with newly calculated trackpad location. Meant to be
+ *  called as soon as location has been calculated (i.e. from ISR) so tick is
+ *  queued with minimal latency. Ticks are generated at a rate proportional to
+ *  the distance the finger travels.
+ *
+ * \param trackpad Specifies which Trackpad the location is for.
+ * \param fingerDown True if finger is down on trackpad.
+ * \param xLoc X location of finger.
+ * \param yLoc Y location of finger.
+ *
+ * \return None.
+ */
+void hapticFeedbackTpadUpdate(Trackpad trackpad, bool fingerDown, 
+	uint16_t xLoc, uint16_t yLoc) {
+	if (!tpadFeedbackEn || !fingerDown) {
+		lastFingerDown[trackpad] = false;
+		tpadTravel[trackpad] = 0;
+		return;
+	}
+
+	// Do not generate tick for finger being placed down
+	if (lastFingerDown[trackpad]) {
+		tpadTravel[trackpad] += abs((int32_t)xLoc - lastXLoc[trackpad]) +
+			abs((int32_t)yLoc - lastYLoc[trackpad]);
+
+		if (tpadTravel[trackpad] >= tpadTickDist) {
+			// Only one tick can be generated per update, so do not 
+			//  carry over more than one tick worth of travel
+			tpadTravel[trackpad] %= tpadTickDist;
+
+			queueHapticTick(trackpad == R_TRACKPAD ? R_HAPTIC : 
+				L_HAPTIC, &TPAD_TICK);
+		}
+	}
+
+	lastFingerDown[trackpad] = true;
+	lastXLoc[trackpad] = xLoc;
+	lastYLoc[trackpad] = yLoc;
+}
+
+/**
+ * Change settings for haptic feedback generated by trackpad activity.
+ *
+ * \param enable True to generate ticks as finger moves across trackpads.
+ * \param tickDist Distance (in X/Y location units) finger has to travel
+ *	between ticks. Must be non-zero.
+ *
+ * \return None.
+ */
+void setTpadHapticFeedback(bool enable, uint16_t tickDist) {
+	if (tickDist) {
+		tpadTickDist = tickDist;
+	}
+	tpadFeedbackEn = enable;
+}
+
+/**
+ * \return True if ticks are generated as finger moves across trackpads.
+ */
+bool getTpadHapticFeedbackEn(void) {
+	return tpadFeedbackEn;
+}
+
+/**
+ * \return Distance (in X/Y location units) finger has to travel between ticks.
+ */
+uint16_t getTpadHapticFeedbackTickDist(void) {
+	return tpadTickDist;
+}
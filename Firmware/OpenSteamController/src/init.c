@@ -44,7 +44,11 @@
 #include "buttons.h"
 #include "trackpad.h"
 #include "haptic.h"
+#include "jingle_data.h"
 #include "time.h"
+#include "sched.h"
+#include "watchdog.h"
+#include "irq_mask.h"
 
 #include <stdio.h>
 
@@ -131,8 +135,7 @@ void stage2Init(uint32_t hwVersion){
 	if (hwVersion < 8){
 		// Hard lock if version is not what we have tested to. HW version
 		//  changes pins, such as battery power enable.
-		volatile int lock = 1;
-		while (lock) {}
+		watchdogLock(WDOG_MARK_HW_VER_LOCK);
 	}
 
 	// Enables clock for GPIO port registers via system clock control register
@@ -227,8 +230,14 @@ void stage2Init(uint32_t hwVersion){
 	Chip_GPIO_WriteDirBit(LPC_GPIO, 0, 7, true);
 
 	// Call initialization routines for specific peripherals, etc.
+	initSched();
+
+	initIrqMask();
+
 	initTime();
 
+	initWatchdog();
+
 	initAdc();
 	enableTriggers(true);
 	enableJoystick(true);
@@ -240,6 +249,8 @@ void stage2Init(uint32_t hwVersion){
 	initTrackpad();
 
 	initHaptics();
+
+	initJingles();
 }
 
 /**
@@ -251,7 +262,8 @@ void initStatsCmdUsage(void) {
 	printf(
 		"usage: initStats\n"
 		"\n"
-		"Prints details on GPIO states at startup v.s. upon command call.\n"
+		"Prints details on GPIO states at startup v.s. upon command call, reset\n"
+		" cause and what system was doing before last watchdog reset.\n"
 	);
 }
 
@@ -268,6 +280,8 @@ int initStatsCmdFnc(int argc, const char* argv[]) {
 	printf("PIO0_2 was %d on startup. Is %d now.\n", 
 		pio0_2_start_val, Chip_GPIO_GetPinState(LPC_GPIO, 0, 2));
 
+	printWatchdogStats();
+
 	return 0;
 
 }
@@ -0,0 +1,179 @@
+/**
+ * \file irq_mask.c
+ * \brief Critical sections that mask only the NVIC lines that share data, so
+ *  unrelated interrupts (i.e. haptic timer) are never held off.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "irq_mask.h"
+#include "sched.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define SYSTICK_MAX (0xFFFFFF) //!< SysTick is a 24-bit down counter.
+
+#define MAX_IRQ_MASK_STATS (4) //!< Max number of distinct masks to track.
+
+/**
+ * Statistics on critical sections using a single mask.
+ */
+typedef struct IrqMaskStats {
+	IrqMask mask; //!< Mask stats are for. 0 if entry unused.
+	uint32_t cnt; //!< Number of times critical section was exited.
+	uint32_t maxTicks; //!< Longest time mask was held, in core clocks.
+} IrqMaskStats;
+
+static IrqMaskStats stats[MAX_IRQ_MASK_STATS]; //!< Stats for each mask used.
+
+/**
+ * Start SysTick free running at core clock so masked windows can be measured.
+ *  SysTick interrupt is not used.
+ *
+ * \return None.
+ */
+void initIrqMask(void) {
+	memset(stats, 0, sizeof(stats));
+
+	SysTick->LOAD = SYSTICK_MAX;
+	SysTick->VAL = 0;
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+/**
+ * Mask interrupts sharing data with caller. May be nested and called from any
+ *  context. Interrupts not in mask (i.e. haptic timer) continue to run.
+ *
+ * \param mask NVIC lines to mask. See IRQ_MASK_*.
+ *
+ * \return State to pass to exitIrqMask().
+ */
+IrqMaskState enterIrqMask(IrqMask mask) {
+	IrqMaskState state;
+
+	state.mask = mask;
+	state.masked = 0;
+	state.primask = 0;
+
+#if (IRQ_MASK_USE_PRIMASK)
+	state.primask = __get_PRIMASK();
+	__disable_irq();
+#else
+	// Only mask lines that are currently enabled, so that nested calls 
+	//  and lines that are disabled for other reasons are left alone
+	state.masked = NVIC->ISER[0] & mask & ~IRQ_MASK_DEFERRED;
+	NVIC->ICER[0] = state.masked;
+
+	if ((mask & IRQ_MASK_DEFERRED) && lockDeferredTasks()) {
+		state.masked |= IRQ_MASK_DEFERRED;
+	}
+
+	// Make sure mask takes effect before touching shared data
+	__DSB();
+	__ISB();
+#endif
+
+	state.start = SysTick->VAL;
+
+	return state;
+}
+
+/**
+ * Restore interrupts masked by enterIrqMask() and record how long they were
+ *  masked.
+ *
+ * \param state Value returned by matching enterIrqMask().
+ *
+ * \return None.
+ */
+void exitIrqMask(IrqMaskState state) {
+	uint32_t ticks = (state.start - SysTick->VAL) & SYSTICK_MAX;
+
+	// Stats are only updated with mask still held. Entries for different
+	//  masks can race, but only cost a lost max sample
+	for (int idx = 0; idx < MAX_IRQ_MASK_STATS; idx++) {
+		if (!stats[idx].mask) {
+			stats[idx].mask = state.mask;
+		}
+		if (stats[idx].mask == state.mask) {
+			stats[idx].cnt++;
+			if (ticks > stats[idx].maxTicks) {
+				stats[idx].maxTicks = ticks;
+			}
+			break;
+		}
+	}
+
+#if (IRQ_MASK_USE_PRIMASK)
+	__set_PRIMASK(state.primask);
+#else
+	if (state.masked & IRQ_MASK_DEFERRED) {
+		unlockDeferredTasks();
+	}
+	NVIC->ISER[0] = state.masked & ~IRQ_MASK_DEFERRED;
+#endif
+}
+
+/**
+ * Print command usage details to console.
+ *
+ * \return None.
+ */
+void irqStatsCmdUsage(void) {
+	printf(
+		"usage: irqStats [reset]\n"
+		"\n"
+		"Print longest time each critical section mask has been held, or\n"
+		" reset the statistics. Interrupts that are not in a mask are not\n"
+		" held off unless IRQ_MASK_USE_PRIMASK is set in irq_mask.h.\n"
+	);
+}
+
+/**
+ * Print or reset statistics on how long interrupts have been masked.
+ *
+ * \return 0 on success.
+ */
+int irqStatsCmdFnc(int argc, const char* argv[]) {
+	if (argc == 2 && !strcmp(argv[1], "reset")) {
+		memset(stats, 0, sizeof(stats));
+		return 0;
+	} else if (argc != 1) {
+		irqStatsCmdUsage();
+		return -1;
+	}
+
+	printf("Mode: %s\n", IRQ_MASK_USE_PRIMASK ? "all IRQs disabled" : 
+		"selective mask");
+	for (int idx = 0; idx < MAX_IRQ_MASK_STATS; idx++) {
+		if (!stats[idx].mask) {
+			break;
+		}
+		printf("Mask 0x%08x: cnt=%u max=%u clks (%u us)\n", 
+			stats[idx].mask, stats[idx].cnt, stats[idx].maxTicks, 
+			stats[idx].maxTicks / (SystemCoreClock / 1000000));
+	}
+
+	return 0;
+}
@@ -30,6 +30,10 @@
 #include "jingle_data.h"
 
 #include "eeprom_access.h"
+#include "usb.h"
+#include "sched.h"
+
+#include <cr_section_macros.h>
 
 #include <stdlib.h>
 #include <string.h>
@@ -52,9 +56,112 @@ static const uint8_t MAX_NUM_JINGLES = 14; //!< This is not only the maximum
 	//!< due to the fact that this is how many Jingles are in the default
 	//!< data and (presumably) how many Jingles Steam expects.
 
+/*
+ * Compact (v2) Jingle Data blob format. This is only understood by this
+ *  firmware, so it uses a different Magic Word to make sure official firmware
+ *  falls back to its default Jingles if a v2 blob is saved to EEPROM.
+ *
+ *	Header {
+ *	 byte[0] and byte[1] form a uint16_t that is a magic word (0xc0de).
+ *	 byte[2] is the format version (2).
+ *	 byte[4] is the number of Jingles in the data blob
+ *	 byte[6] onwards are MAX_NUM_JINGLES pairs of uint16_t byte offsets to
+ *	  the Right and Left Haptic streams of each Jingle (0 = no notes).
+ *	 Followed by a uint16_t byte offset to the end of all stream data.
+ *	}
+ *
+ *	A stream starts with a byte for the dutyCycle and a byte for the envelope
+ *	 shared by all of its notes, a byte for the number of entries in its
+ *	 duration table and then the table itself (uint16_t ms, little endian).
+ *	This is followed by tokens:
+ *	 0x00 End of stream.
+ *	 0x01 {duty} Change dutyCycle for following notes.
+ *	 0x02 {env} Change envelope for following notes.
+ *	 0x40 | durIdx {freqDelta} Note. durIdx indexes the duration table. 
+ *	  durIdx 0x3f means duration follows as a varint instead. freqDelta is 
+ *	  a zigzag varint added to the frequency of the previous note.
+ *	 0x80 | durIdx Rest, with duration given the same way as for Note.
+ *	 0xc0 | cnt Repeat previous Note or Rest cnt more times.
+ *	Varints are little endian base 128 (bit 7 set if another byte follows).
+ */
+static const uint16_t JD2_MAGIC_WORD = 0xc0de; //!< First 16 bits of a compact
+	//!< (v2) Jingle Data blob.
+#define JD2_VERSION (2) //!< Compact blob format version.
+#define JD2_STREAM_OFFSETS_ADDR (6) //!< Byte offset of stream offset table.
+#define JD2_DATA_END_ADDR (JD2_STREAM_OFFSETS_ADDR + 2 * sizeof(uint16_t) * \
+	MAX_NUM_JINGLES) //!< Byte offset of end of stream data field.
+#define JD2_HDR_BYTES (JD2_DATA_END_ADDR + sizeof(uint16_t)) //!< Number of
+	//!< bytes in compact blob header.
+#define JD2_STREAM_HDR_BYTES (3) //!< dutyCycle, envelope, duration table size.
+
+#define JD2_TOK_END (0x00)
+#define JD2_TOK_DUTY (0x01)
+#define JD2_TOK_ENV (0x02)
+#define JD2_TOK_OP_MASK (0xc0)
+#define JD2_TOK_NOTE (0x40)
+#define JD2_TOK_REST (0x80)
+#define JD2_TOK_REPEAT (0xc0)
+#define JD2_TOK_ARG_MASK (0x3f)
+#define JD2_DUR_VARINT (0x3f) //!< durIdx indicating varint duration follows.
+
+#define JINGLE_CHUNK_BYTES (32) //!< Number of bytes prefetched from EEPROM at
+	//!< a time when playing Jingles directly from EEPROM.
+
+/**
+ * Reads a range of Jingle Data in EEPROM sequentially. Two chunks are 
+ *  buffered so that the haptic Timer IRQ consumes one while TASK_JINGLE
+ *  prefetches the other. Note boundaries never wait on IAP this way.
+ */
+typedef struct JingleReader {
+	uint16_t addr; //!< Byte offset in blob of next byte to prefetch.
+	uint16_t end; //!< Byte offset in blob where reading stops.
+	uint8_t bufs[2][JINGLE_CHUNK_BYTES]; //!< Prefetched chunks.
+	uint8_t lens[2]; //!< Number of valid bytes in each of bufs.
+	volatile bool full[2]; //!< Set once chunk is prefetched. Cleared once
+		//!< chunk has been consumed.
+	volatile uint8_t rdBuf; //!< Which of bufs is being read from.
+	uint8_t rdIdx; //!< Next byte to read from bufs[rdBuf].
+} JingleReader;
+
+static JingleReader jingleReaders[2]; //!< Used to play Jingles from EEPROM.
+
+/**
+ * State for decoding a compact stream into Notes as they are played.
+ */
+typedef struct JingleDecoder {
+	JingleReader* reader; //!< If not NULL, stream is read from EEPROM using
+		//!< this instead of ptr.
+	const uint8_t* ptr; //!< Next byte of stream to decode.
+	const uint8_t* end; //!< End of Jingle Data blob. Decoding stops here.
+	const uint8_t* durs; //!< Duration table of stream.
+	uint8_t numDurs; //!< Number of entries in duration table.
+	uint8_t dutyCycle; //!< dutyCycle for following Notes.
+	uint8_t envelope; //!< envelope for following Notes.
+	uint8_t repeatsLeft; //!< Number of times to repeat last before moving
+		//!< on to next token.
+	uint16_t freq; //!< Frequency of last Note. Base for next freqDelta.
+	Note last; //!< Last Note or Rest decoded.
+} JingleDecoder;
+
+static JingleDecoder jingleDecoders[2]; //!< Used to play compact Jingles.
+static uint8_t jingleDurs[2][2 * JD2_DUR_VARINT]; //!< Duration tables of 
+	//!< compact streams being played from EEPROM.
+
+/**
+ * Where the Jingle Data currently in use lives.
+ */
+typedef enum JingleDataLoc {
+	JD_LOC_FLASH, //!< Default Jingle Data built into firmware.
+	JD_LOC_EEPROM, //!< Jingle Data saved in EEPROM. Only the header is 
+		//!< mirrored in RAM. Jingles are streamed from EEPROM.
+	JD_LOC_RAM //!< Jingle Data in RAM mirror. Needed to change Jingle Data.
+} JingleDataLoc;
+
+static JingleDataLoc jingleDataLoc = JD_LOC_FLASH; //!< See JingleDataLoc.
+
 /**
- * This is the jingle data in store in raw form. This makes for easier 
- *  initialization and loading/saving from/to EEPROM, etc.
+ * This is the default jingle data in raw form. It stays in flash and is only
+ *  copied to RAM mirror if it is changed (see useJingleMirror()).
  *
  * Use setJingleData16()/getJingleData16() to access 16-bit words in this blob.
  *
@@ -86,7 +193,7 @@ static const uint8_t MAX_NUM_JINGLES = 14; //!< This is not only the maximum
  *	Next comes the sequence of Notes for the Right Haptic, immediately
  *	 followed by the Notes for the Left Haptic. 
  */
-static uint32_t rawJingleData32[JINGLE_DATA_MAX_BYTES/sizeof(uint32_t)] = {
+static const uint32_t defaultJingleData32[JINGLE_DATA_MAX_BYTES/sizeof(uint32_t)] = {
 	 0x0000bead,
 	 0x00227b0e,
 	 0x00de0062,
@@ -344,8 +451,30 @@ static uint32_t rawJingleData32[JINGLE_DATA_MAX_BYTES/sizeof(uint32_t)] = {
 	 0x00000000
 };
 
-static uint8_t* rawJingleData = (uint8_t*)rawJingleData32; //!< Granular access
-	//!< to Jingle Data.
+__BSS(RAM3) static uint32_t jingleMirror32[JINGLE_DATA_MAX_BYTES/sizeof(uint32_t)];
+	//!< RAM mirror of Jingle Data. Only used while Jingle Data is being 
+	//!< changed. Kept in SRAM1 (RAM3) to leave main SRAM free. Must not go in
+	//!< RAM2, which is all used by USB ROM stack (see USB_STACK_MEM_BASE).
+__BSS(RAM3) static uint32_t loadJingleData32[JINGLE_DATA_MAX_BYTES/sizeof(uint32_t)];
+	//!< Staging area for Jingle Data received by "jingle load". Kept in
+	//!< SRAM1 (RAM3) next to jingleMirror32.
+
+#define SRAM1_BYTES (0x800) //!< Size of SRAM1 (RAM3) on LPC11U37.
+
+_Static_assert(sizeof(jingleMirror32) + sizeof(loadJingleData32) <= SRAM1_BYTES,
+	"Jingle Data buffers must fit in SRAM1 (RAM3)");
+
+static uint8_t* rawJingleData = (uint8_t*)defaultJingleData32; //!< Granular 
+	//!< access to Jingle Data. Only write through this when jingleDataLoc is
+	//!< JD_LOC_RAM.
+static uint8_t* jingleMirror = (uint8_t*)jingleMirror32; //!< RAM mirror of 
+	//!< Jingle Data.
+static uint8_t* loadJingleData = (uint8_t*)loadJingleData32; //!< Swapped with
+	//!< jingleMirror once upload is verified.
+
+#define JINGLE_LOAD_TIMEOUT_US (1000000) //!< Maximum time to wait for more
+	//!< Jingle Data (i.e. the next USB packet) to arrive once all received
+	//!< data has been taken, while uploading via "jingle load".
 
 /**
  * Read 16-bit words from Jingle Data blob.
@@ -425,26 +554,94 @@ static void setNumJingles(uint8_t numJingles) {
 }
 
 /**
+ * \return True if the Jingle Data blob is in compact (v2) format.
+ */
+static bool jingleDataIsCompact(void) {
+	return getMagicWord() == JD2_MAGIC_WORD;
+}
+
+/**
+ * Check Jingle Data blob before it is accepted. Header fields and the offset
+ *  and size of each Jingle (or stream) are checked against the blob size, so
+ *  nothing that reads the blob (i.e. Timer IRQ while playing) can be sent 
+ *  outside of it.
+ *
  * \return True if the Jingle Data blob seems to contain valid data.
  */
 static bool jingleDataIsValid() {
+	if (getNumJingles() > MAX_NUM_JINGLES) {
+		return false;
+	}
+
+	if (jingleDataIsCompact()) {
+		if (rawJingleData[2] != JD2_VERSION) {
+			return false;
+		}
+		uint16_t data_end = getJingleData16(JD2_DATA_END_ADDR);
+		if (data_end < JD2_HDR_BYTES || data_end > JINGLE_DATA_MAX_BYTES) {
+			return false;
+		}
+		for (int idx = 0; idx < getNumJingles(); idx++) {
+			for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+				uint16_t offset = getJingleData16(
+					JD2_STREAM_OFFSETS_ADDR + 
+					(2 * idx + haptic) * sizeof(uint16_t));
+				if (offset && (offset < JD2_HDR_BYTES || 
+					offset + JD2_STREAM_HDR_BYTES > data_end)) {
+					return false;
+				}
+			}
+		}
+		return true;
+	}
+
 	if (getMagicWord() != JD_MAGIC_WORD) {
 		return false;
 	}
 
-	//TODO: Check that offsets are incrementing
+	// Header (i.e. Magic Word, Reserved uint16_t, Number of Jingles, 
+	//  Reserved uint8_t and offsets)
+	const uint32_t hdr_bytes = sizeof(JD_MAGIC_WORD) + 2 + 1 + 1 + 
+		sizeof(uint16_t) * MAX_NUM_JINGLES;
+
+	for (int idx = 0; idx < getNumJingles(); idx++) {
+		uint32_t offset = getJingleData16(6 + idx * sizeof(uint16_t));
+
+		// Notes are accessed in place, so they need to be aligned
+		if (offset < hdr_bytes || offset % sizeof(uint16_t) ||
+			offset + 2 * sizeof(uint16_t) > JINGLE_DATA_MAX_BYTES) {
+			return false;
+		}
 
-	//TODO: validate location of each jingle
+		uint32_t end = offset + 2 * sizeof(uint16_t) + 
+			(getJingleData16(offset) + 
+			getJingleData16(offset + sizeof(uint16_t))) * sizeof(Note);
+		if (end > JINGLE_DATA_MAX_BYTES) {
+			return false;
+		}
+	}
 
 	return true;
 }
 
+/**
+ * Switch to using RAM mirror for Jingle Data without copying current Jingle
+ *  Data into it. For when Jingle Data is about to be overwritten.
+ *
+ * \return None.
+ */
+static void selectJingleMirror(void) {
+	rawJingleData = jingleMirror;
+	jingleDataLoc = JD_LOC_RAM;
+}
+
 /**
  * Initialize Jingle Data to known empty and valid state.
  *
  * \return None.
  */
 static void initJingleData(void) {
+	selectJingleMirror();
 	setMagicWord(JD_MAGIC_WORD);
 	setNumJingles(0);
 
@@ -566,6 +763,38 @@ static Note* getJingleNotes(enum Haptic haptic, uint8_t idx) {
 	return (Note*)&rawJingleData[offset];
 }
 
+/**
+ * \param idx Index of the Jingle being referred to.
+ *
+ * \return Number of bytes Jingle takes up in (non-compact) Jingle Data.
+ */
+static uint16_t getJingleSize(uint8_t idx) {
+	return 2 * sizeof(uint16_t) + 
+		getNumJingleNotes(R_HAPTIC, idx) * sizeof(Note) +
+		getNumJingleNotes(L_HAPTIC, idx) * sizeof(Note);
+}
+
+/**
+ * \return Byte offset just past the last byte used in Jingle Data blob.
+ */
+static uint16_t getJingleDataEnd(void) {
+	if (jingleDataIsCompact()) {
+		return getJingleData16(JD2_DATA_END_ADDR);
+	}
+
+	uint16_t end = sizeof(JD_MAGIC_WORD) + 2 + 1 + 1 +
+		sizeof(uint16_t) * MAX_NUM_JINGLES;
+
+	for (int idx = 0; idx < getNumJingles(); idx++) {
+		uint16_t offset = getJingleOffset(idx);
+		if (offset && offset + getJingleSize(idx) > end) {
+			end = offset + getJingleSize(idx);
+		}
+	}
+
+	return end;
+}
+
 /**
  * Allocates space in Jingle Data for another Jingle. This Jingle will be
  *  stored immediately following the last Jingle (if there is room). Use
@@ -579,11 +808,20 @@ static Note* getJingleNotes(enum Haptic haptic, uint8_t idx) {
 static int addJingle(uint16_t numNotesRight, uint16_t numNotesLeft) {
 	int retval = 0;
 
+	if (jingleDataIsCompact()) {
+		return -1;
+	}
+
 	uint8_t num_jingles = getNumJingles();
 	if (num_jingles >= MAX_NUM_JINGLES) {
 		return -1;
 	}
 
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -6;
+	}
+
 	// Check if there is enough room in blob for another Jingle
 	uint32_t num_jingle_bytes = 2 * sizeof(uint16_t) + 
 		numNotesLeft * sizeof(Note) +
@@ -592,17 +830,11 @@ static int addJingle(uint16_t numNotesRight, uint16_t numNotesLeft) {
 		return -2;
 	}
 
-	// Start with assumption this is the first Jingle. Save room for
-	//  Magic Word, Reserved uint16_t, Number of Jingles, Reserved uint8_t
-	uint16_t offset = sizeof(JD_MAGIC_WORD) + 2 + 1 + 1 +
-		sizeof(uint16_t) * MAX_NUM_JINGLES;
-
-	// If this is not the first Jingle, data will start after last Jingle
-	if (num_jingles > 0) {
-		offset = getJingleOffset(num_jingles-1) + 2 * sizeof(uint16_t) + 
-			getNumJingleNotes(L_HAPTIC, num_jingles-1) * sizeof(Note) +
-			getNumJingleNotes(R_HAPTIC, num_jingles-1) * sizeof(Note);
-	}
+	// Data starts after header (i.e. Magic Word, Reserved uint16_t, Number
+	//  of Jingles, Reserved uint8_t and offsets) or after last byte used by
+	//  other Jingles. Last Jingle is not always last in blob (i.e. it may be
+	//  shared or replaced, see packJingleData() and replaceJingle())
+	uint16_t offset = getJingleDataEnd();
 
 	// Set offset for new Jingle. Also set all remaining possible offsets.
 	for (int idx = num_jingles; idx < MAX_NUM_JINGLES; idx++) {
@@ -634,225 +866,1476 @@ static int addJingle(uint16_t numNotesRight, uint16_t numNotesLeft) {
 	return 0;
 }	
 
-//TODO
-static int delJingle() {
-	// decrement number of jingles
-	// Compute/adjust how much room is left in blob
-	return -1;
+/**
+ * Initialize Jingle Data to known empty and valid state in compact (v2) 
+ *  format.
+ *
+ * \return None.
+ */
+static void initJingleDataV2(void) {
+	selectJingleMirror();
+	memset(rawJingleData, 0, JD2_HDR_BYTES);
+	setMagicWord(JD2_MAGIC_WORD);
+	rawJingleData[2] = JD2_VERSION;
+	setNumJingles(0);
+	setJingleData16(JD2_DATA_END_ADDR, JD2_HDR_BYTES);
+
+	numJingleBytesFree = JINGLE_DATA_MAX_BYTES - JD2_HDR_BYTES;
 }
 
 /**
- * Print information on Jingle Data Blob.
- * 
- * \return 0 on success.
+ * \param haptic Specifies which haptic is being referred to.
+ * \param idx Index of the Jingle being referred to.
+ *
+ * \return Byte offset from start of compact Jingle Data to stream for the
+ *	given Jingle and haptic. 0 if there is no such stream.
  */
-static int printJingleData(void) {
-	printf("Magic Word = 0x%04x\n", getMagicWord());
-	printf("Number of Jingles = %d\n", getNumJingles());
+static uint16_t getJingleStreamOffset(enum Haptic haptic, uint8_t idx) {
+	if (idx >= getNumJingles()) {
+		return 0;
+	}
 
-	for (int idx = 0; idx < getNumJingles(); idx++) {
-		printf("Jingle[%d] offset = 0x%03x\n", idx, getJingleOffset(idx));
+	uint16_t offset = getJingleData16(JD2_STREAM_OFFSETS_ADDR + 
+		(2 * idx + haptic) * sizeof(uint16_t));
+
+	if (offset < JD2_HDR_BYTES || offset >= JINGLE_DATA_MAX_BYTES) {
+		return 0;
 	}
 
-	printf("Bytes free in blob = 0x%03x\n", numJingleBytesFree);
+	return offset;
+}
 
-	return 0;
+/**
+ * Find where space allocated to a stream ends. This is the start of the next
+ *  stream in the blob, or the end of all stream data.
+ *
+ * \param offset Byte offset of stream.
+ *
+ * \return Byte offset just past end of stream.
+ */
+static uint16_t getJingleStreamEnd(uint16_t offset) {
+	uint16_t end = getJingleData16(JD2_DATA_END_ADDR);
+
+	for (int idx = 0; idx < getNumJingles(); idx++) {
+		for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+			uint16_t other = getJingleStreamOffset(haptic, idx);
+			if (other > offset && other < end) {
+				end = other;
+			}
+		}
+	}
+
+	return end;
 }
 
 /**
- * Print to console details on a particular Jingle.
+ * Allocates space in compact Jingle Data for another Jingle. Streams are 
+ *  stored immediately following the last stream and zeroed (i.e. empty) until
+ *  written with writeJingleStream().
+ *
+ * \param numBytesRight Number of bytes in right haptic stream. 0 for none.
+ * \param numBytesLeft Number of bytes in left haptic stream. 0 for none.
  *
- * \param idx Indicates which Jingle is being referred to.
- * 
  * \return 0 on success.
  */
-static int printJingle(uint8_t idx) {
-	if (idx >= getNumJingles()) {
-		printf("jingleNum %d too large\n", idx);
+static int addJingleV2(uint16_t numBytesRight, uint16_t numBytesLeft) {
+	if (!jingleDataIsCompact()) {
 		return -1;
 	}
 
-	uint16_t offset = getJingleOffset(idx);
-	if (!offset) {
-		printf("Invalid offset (0x%04x)\n", offset);
-		return -1;
+	uint8_t num_jingles = getNumJingles();
+	if (num_jingles >= MAX_NUM_JINGLES) {
+		return -2;
 	}
 
-	printf("offset = 0x%03x\n", offset);
-	uint16_t numNotesRight = getNumJingleNotes(R_HAPTIC, idx);
-	printf("numNotesRight = %d\n", numNotesRight);
-	uint16_t numNotesLeft = getNumJingleNotes(L_HAPTIC, idx);
-	printf("numNotesLeft = %d\n", numNotesLeft);
-	struct Note* notesRight = getJingleNotes(R_HAPTIC, idx);
-	printf("notesRight = 0x%08x\n", notesRight);
-	struct Note* notesLeft = getJingleNotes(L_HAPTIC, idx);
-	printf("notesLeft = 0x%08x\n", notesLeft);
-
-	for (int idx = 0; idx < numNotesRight; idx++) {
-		if (!notesRight)
-			break;
-
-		printf("Note[%d] = 0x%04x (%d), 0x%04x (%d), 0x%04x (%d)\n", idx,
-			notesRight[idx].dutyCycle, notesRight[idx].dutyCycle, 
-			notesRight[idx].pulseFreq, notesRight[idx].pulseFreq, 
-			notesRight[idx].duration, notesRight[idx].duration);
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -4;
 	}
-	for (int idx = 0; idx < numNotesLeft; idx++) {
-		if (!notesLeft)
-			break;
 
-		printf("Note[%d] = 0x%04x (%d), 0x%04x (%d), 0x%04x (%d)\n", idx,
-			notesLeft[idx].dutyCycle, notesLeft[idx].dutyCycle,
-			notesLeft[idx].pulseFreq, notesLeft[idx].pulseFreq,
-			notesLeft[idx].duration, notesLeft[idx].duration);
+	uint32_t num_bytes = numBytesRight + numBytesLeft;
+	if (num_bytes > numJingleBytesFree) {
+		return -3;
 	}
 
-	return 0;
-}
+	uint16_t offset = getJingleData16(JD2_DATA_END_ADDR);
+	uint16_t offset_addr = JD2_STREAM_OFFSETS_ADDR + 
+		2 * num_jingles * sizeof(uint16_t);
 
-/**
- * Play a specified Jingle using the haptics.
- * 
- * \param idx Indicates which Jingle is being referred to. 
- * 
- * \return 0 on success.
- */
-int playJingle(uint8_t idx) {
-	if (idx >= getNumJingles())
-		return -1;
+	memset(&rawJingleData[offset], 0, num_bytes);
 
-	uint16_t offset = getJingleOffset(idx);
-	if (!offset)
-		return -1;
+	setJingleData16(offset_addr, numBytesRight ? offset : 0);
+	offset += numBytesRight;
+	setJingleData16(offset_addr + sizeof(uint16_t), 
+		numBytesLeft ? offset : 0);
+	offset += numBytesLeft;
 
-	uint16_t numNotesRight = getNumJingleNotes(R_HAPTIC, idx);
-	uint16_t numNotesLeft = getNumJingleNotes(L_HAPTIC, idx);
-	struct Note* notesRight = getJingleNotes(R_HAPTIC, idx);
-	struct Note* notesLeft = getJingleNotes(L_HAPTIC, idx);
+	setJingleData16(JD2_DATA_END_ADDR, offset);
+	setNumJingles(num_jingles + 1);
 
-	if (numNotesRight && notesRight)
-		playHaptic(R_HAPTIC, notesRight, numNotesRight);
-	if (numNotesLeft && notesLeft)
-		playHaptic(L_HAPTIC, notesLeft, numNotesLeft);
+	numJingleBytesFree -= num_bytes;
 
 	return 0;
 }
 
 /**
- * Load Jingle Data from EEPROM. This will attempt to replace Jingle Data with 
- *  data from EEPROM. If EEPROM data is invalid, local Jingle Data will be
- *  cleared.
- * 
+ * Write encoded bytes to a stream allocated by addJingleV2().
+ *
+ * \param haptic Specifies which haptic stream is being written.
+ * \param idx Index of the Jingle being written.
+ * \param byteIdx Byte offset within stream to start writing at.
+ * \param[in] data Bytes to write.
+ * \param len Number of bytes to write.
+ *
  * \return 0 on success.
  */
-static int loadJingleEEPROM(void) {
-	int retval = eepromRead(JINGLE_DATA_EEPROM_OFFSET, rawJingleData, 
-		JINGLE_DATA_MAX_BYTES);
-
-	if (retval) {
-		initJingleData();
+static int writeJingleStream(enum Haptic haptic, uint8_t idx, uint16_t byteIdx,
+	const uint8_t* data, uint16_t len) {
+	if (!jingleDataIsCompact()) {
 		return -1;
 	}
 
-	if (!jingleDataIsValid()) {
-		initJingleData();
+	uint16_t offset = getJingleStreamOffset(haptic, idx);
+	if (!offset) {
 		return -2;
 	}
 
+	if (offset + byteIdx + len > getJingleStreamEnd(offset)) {
+		return -3;
+	}
+
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -4;
+	}
+
+	memcpy(&rawJingleData[offset + byteIdx], data, len);
+
 	return 0;
 }
 
 /**
- * Save Jingle Data to EEPROM. This will write current Jingle Data to EEPROM. 
- *  Note: This will PERSIST even after updating firmware and may affect how the
- *  official firmware functions. Use \"clear\" to erase.
- * 
- * \return 0 on success.
+ * Recompute numJingleBytesFree from what is in Jingle Data blob.
+ *
+ * \return None.
  */
-static int saveJingleEEPROM(void) {
-	// Make sure we report there are MAX_NUM_JINGLES in the data blob
-	//  as this is what Steam and the official FW are setup to expect.
-	//  If there are fewer than MAX_NUM_JINGLES the addition spots will
-	//  simply reference back to the last Jingle (this is ensured by 
-	//  addJingle()
-	uint8_t num_jingles = getNumJingles();
-	setNumJingles(MAX_NUM_JINGLES);
+static void updateJingleBytesFree(void) {
+	uint16_t end = getJingleDataEnd();
 
-	int retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET, rawJingleData, 
-		JINGLE_DATA_MAX_BYTES);
+	numJingleBytesFree = end < JINGLE_DATA_MAX_BYTES ? 
+		JINGLE_DATA_MAX_BYTES - end : 0;
+}
 
-	// Restore the number of Jingles back to original in case user wants to
-	//  continue to change data blob
-	setNumJingles(num_jingles);
+/**
+ * Make sure Jingle Data is in RAM mirror so it can be changed (or inspected 
+ *  in detail). 
+ *
+ * \return 0 on success.
+ */
+static int useJingleMirror(void) {
+	switch (jingleDataLoc) {
+	case JD_LOC_RAM:
+		return 0;
 
-	// Now check if EEPROM write succeeded
-	if (retval) {
-		return -1;
+	case JD_LOC_FLASH:
+		memcpy(jingleMirror, defaultJingleData32, JINGLE_DATA_MAX_BYTES);
+		break;
+
+	case JD_LOC_EEPROM:
+		if (eepromRead(JINGLE_DATA_EEPROM_OFFSET, jingleMirror, 
+			JINGLE_DATA_MAX_BYTES)) {
+			return -1;
+		}
+		break;
 	}
 
+	selectJingleMirror();
+	updateJingleBytesFree();
+
 	return 0;
 }
 
 /**
- * Clear out Jingle Data saved to EEPROM. This will cause official firmware to
- *   use default Jingle Data embedded in firmware.
- * 
+ * Grow or shrink a region (i.e. Jingle or stream) of Jingle Data in place. 
+ *  Everything after the region is moved to keep the blob packed and all
+ *  offsets in the header referring to moved data are fixed up. If the region
+ *  grows, the added bytes are zeroed.
+ *
+ * \param start Byte offset of region to resize.
+ * \param oldLen Current number of bytes in region.
+ * \param newLen Requested number of bytes in region.
+ *
  * \return 0 on success.
  */
-static int clearJingleEEPROM(void) {
-	uint16_t empty_word = 0;
-	// Clear out header bytes for Jingle Data blob
-	int retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET, &empty_word, 
-		sizeof(empty_word));
-	if (retval) {
+static int resizeJingleRegion(uint16_t start, uint16_t oldLen, uint16_t newLen) {
+	uint16_t end = getJingleDataEnd();
+	if (start + oldLen > end) {
 		return -1;
 	}
-	retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET+2, &empty_word, 
-		sizeof(empty_word));
-	if (retval) {
+
+	if (newLen > oldLen && newLen - oldLen > numJingleBytesFree) {
 		return -2;
 	}
-	retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET+4, &empty_word, 
-		sizeof(empty_word));
-	if (retval) {
-		return -3;
+
+	int32_t delta = (int32_t)newLen - oldLen;
+
+	memmove(&rawJingleData[start + newLen], &rawJingleData[start + oldLen],
+		end - (start + oldLen));
+	if (delta > 0) {
+		memset(&rawJingleData[start + oldLen], 0, delta);
+	}
+
+	// Offsets equal to start refer to the region itself (or repeat last 
+	//  Jingle offset), so only those past it move
+	int num_offsets = MAX_NUM_JINGLES;
+	uint16_t offsets_addr = 6;
+	if (jingleDataIsCompact()) {
+		num_offsets = 2 * MAX_NUM_JINGLES;
+		offsets_addr = JD2_STREAM_OFFSETS_ADDR;
+		setJingleData16(JD2_DATA_END_ADDR, end + delta);
 	}
 
+	for (int idx = 0; idx < num_offsets; idx++) {
+		uint16_t addr = offsets_addr + idx * sizeof(uint16_t);
+		uint16_t offset = getJingleData16(addr);
+		if (offset > start && offset < JINGLE_DATA_MAX_BYTES) {
+			setJingleData16(addr, offset + delta);
+		}
+	}
+
+	updateJingleBytesFree();
+
 	return 0;
 }
 
 /**
- * Prints details to console regarding how to use the haptic command line 
- *  function.
+ * \return Number of offsets in Jingle Data header that reference data (i.e. 
+ *	one per Jingle, or one per stream for compact Jingle Data).
+ */
+static uint8_t getNumJingleRefs(void) {
+	if (jingleDataIsCompact()) {
+		return 2 * getNumJingles();
+	}
+	return getNumJingles();
+}
+
+/**
+ * \param ref Index of offset in Jingle Data header. This is the Jingle index,
+ *	or 2 * Jingle index + haptic for compact Jingle Data.
  *
- * \return None.
+ * \return Byte offset in Jingle Data where the offset is stored.
  */
-void jingleCmdUsage(void) {
-	printf(
-		"usage: jingle play {jingleIdx}\n"
-		"       jingle print [{jingleIdx}]\n"
-		"       jingle clear\n"
-		"       jingle delete\n"
+static uint16_t getJingleRefAddr(uint8_t ref) {
+	if (jingleDataIsCompact()) {
+		return JD2_STREAM_OFFSETS_ADDR + ref * sizeof(uint16_t);
+	}
+	return 6 + ref * sizeof(uint16_t);
+}
+
+/**
+ * \param offset Byte offset of a Jingle (or stream for compact Jingle Data).
+ *
+ * \return Number of bytes in Jingle (or stream).
+ */
+static uint16_t getJingleRegionLen(uint16_t offset) {
+	if (jingleDataIsCompact()) {
+		return getJingleStreamEnd(offset) - offset;
+	}
+	return 2 * sizeof(uint16_t) + (getJingleData16(offset) + 
+		getJingleData16(offset + sizeof(uint16_t))) * sizeof(Note);
+}
+
+/**
+ * \param offset Byte offset of a Jingle (or stream for compact Jingle Data).
+ *
+ * \return True if more than one offset in header references the data (see
+ *	packJingleData()).
+ */
+static bool jingleRegionIsShared(uint16_t offset) {
+	int num_refs = 0;
+
+	for (int ref = 0; ref < getNumJingleRefs(); ref++) {
+		if (getJingleData16(getJingleRefAddr(ref)) == offset) {
+			num_refs++;
+		}
+	}
+
+	return num_refs > 1;
+}
+
+/**
+ * Make unused Jingle offsets reference last Jingle, as official firmware 
+ *  expects (see addJingle()).
+ *
+ * \return None.
+ */
+static void fillUnusedJingleOffsets(void) {
+	uint8_t num_jingles = getNumJingles();
+
+	if (jingleDataIsCompact() || !num_jingles) {
+		return;
+	}
+
+	for (int idx = num_jingles; idx < MAX_NUM_JINGLES; idx++) {
+		setJingleOffset(idx, getJingleOffset(num_jingles - 1));
+	}
+}
+
+/**
+ * Give a Jingle (or stream) its own copy of data shared with other Jingles, 
+ *  so that it can be changed without affecting them.
+ *
+ * \param ref Index of offset in header (see getJingleRefAddr()).
+ *
+ * \return 0 on success.
+ */
+static int unshareJingleRegion(uint8_t ref) {
+	uint16_t addr = getJingleRefAddr(ref);
+	uint16_t offset = getJingleData16(addr);
+
+	if (!offset || !jingleRegionIsShared(offset)) {
+		return 0;
+	}
+
+	uint16_t len = getJingleRegionLen(offset);
+	uint16_t end = getJingleDataEnd();
+	if (resizeJingleRegion(end, 0, len)) {
+		return -1;
+	}
+
+	memcpy(&rawJingleData[end], &rawJingleData[offset], len);
+	setJingleData16(addr, end);
+	fillUnusedJingleOffsets();
+	updateJingleBytesFree();
+
+	return 0;
+}
+
+/**
+ * Find identical Jingles (or identical streams for compact Jingle Data) and 
+ *  have all offsets reference a single copy. Space used by the duplicates is
+ *  freed by compacting the blob. Format is unchanged, so this does not affect
+ *  how Jingles are played.
+ *
+ * \return Number of bytes freed on success, negative value on error.
+ */
+static int packJingleData(void) {
+	int num_freed = 0;
+
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -1;
+	}
+
+	uint8_t num_refs = getNumJingleRefs();
+	for (int ref = 1; ref < num_refs; ref++) {
+		uint16_t offset = getJingleData16(getJingleRefAddr(ref));
+		if (!offset) {
+			continue;
+		}
+
+		uint16_t len = getJingleRegionLen(offset);
+		if (offset + len > JINGLE_DATA_MAX_BYTES) {
+			return -2;
+		}
+
+		for (int prev = 0; prev < ref; prev++) {
+			uint16_t prev_offset = getJingleData16(getJingleRefAddr(prev));
+			if (!prev_offset || prev_offset == offset || 
+				getJingleRegionLen(prev_offset) != len ||
+				memcmp(&rawJingleData[prev_offset], 
+				&rawJingleData[offset], len)) {
+				continue;
+			}
+
+			// Offsets become ambiguous once duplicate is removed, so note
+			//  which reference it first
+			uint32_t dups = 0;
+			for (int dup = 0; dup < num_refs; dup++) {
+				if (getJingleData16(getJingleRefAddr(dup)) == offset) {
+					dups |= 1 << dup;
+				}
+			}
+
+			if (resizeJingleRegion(offset, len, 0)) {
+				return -3;
+			}
+
+			if (prev_offset > offset) {
+				prev_offset -= len;
+			}
+			for (int dup = 0; dup < num_refs; dup++) {
+				if (dups & (1 << dup)) {
+					setJingleData16(getJingleRefAddr(dup), prev_offset);
+				}
+			}
+
+			num_freed += len;
+			break;
+		}
+	}
+
+	fillUnusedJingleOffsets();
+	updateJingleBytesFree();
+
+	return num_freed;
+}
+
+/**
+ * Resize and clear a Jingle in place. Other Jingles keep their indices. Use
+ *  "note" or "write" commands to fill in the Jingle afterwards.
+ *
+ * \param idx Index of the Jingle to replace.
+ * \param numRight Number of notes (or bytes for compact Jingle Data) in right
+ *	haptic data.
+ * \param numLeft Number of notes (or bytes for compact Jingle Data) in left
+ *	haptic data.
+ *
+ * \return 0 on success.
+ */
+static int replaceJingle(uint8_t idx, uint16_t numRight, uint16_t numLeft) {
+	int retval = 0;
+
+	if (idx >= getNumJingles()) {
+		return -1;
+	}
+
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -2;
+	}
+
+	if (!jingleDataIsCompact()) {
+		uint16_t offset = getJingleOffset(idx);
+		if (!offset) {
+			return -3;
+		}
+
+		uint32_t num_bytes = 2 * sizeof(uint16_t) + 
+			(numRight + numLeft) * sizeof(Note);
+		if (num_bytes > JINGLE_DATA_MAX_BYTES) {
+			return -4;
+		}
+
+		// Other Jingles keep shared data, replacement is appended
+		uint16_t old_len = getJingleSize(idx);
+		if (jingleRegionIsShared(offset)) {
+			offset = getJingleDataEnd();
+			old_len = 0;
+		}
+
+		retval = resizeJingleRegion(offset, old_len, num_bytes);
+		if (retval) {
+			return -4;
+		}
+		setJingleOffset(idx, offset);
+		fillUnusedJingleOffsets();
+
+		setNumJingleNotes(R_HAPTIC, idx, numRight);
+		setNumJingleNotes(L_HAPTIC, idx, numLeft);
+		memset(getJingleNotes(R_HAPTIC, idx), 0, 
+			(numRight + numLeft) * sizeof(Note));
+
+		updateJingleBytesFree();
+
+		return 0;
+	}
+
+	uint16_t nums[2] = {numRight, numLeft};
+	for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+		uint16_t offset_addr = JD2_STREAM_OFFSETS_ADDR + 
+			(2 * idx + haptic) * sizeof(uint16_t);
+		uint16_t offset = getJingleStreamOffset(haptic, idx);
+		uint16_t len = 0;
+
+		if (offset && !jingleRegionIsShared(offset)) {
+			len = getJingleStreamEnd(offset) - offset;
+		} else {
+			// New streams are appended, leaving shared streams to other
+			//  Jingles. Order of streams in blob does not matter
+			offset = getJingleData16(JD2_DATA_END_ADDR);
+		}
+
+		retval = resizeJingleRegion(offset, len, nums[haptic]);
+		if (retval) {
+			return -5;
+		}
+		memset(&rawJingleData[offset], 0, nums[haptic]);
+
+		setJingleData16(offset_addr, nums[haptic] ? offset : 0);
+	}
+
+	return 0;
+}
+
+/**
+ * Remove a Jingle from Jingle Data. Jingles after it are moved down one index
+ *  and the blob is compacted so the space can be reused.
+ *
+ * \param idx Index of the Jingle to delete.
+ *
+ * \return 0 on success.
+ */
+static int delJingle(uint8_t idx) {
+	int retval = 0;
+
+	uint8_t num_jingles = getNumJingles();
+	if (idx >= num_jingles) {
+		return -1;
+	}
+
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -2;
+	}
+
+	if (num_jingles == 1) {
+		if (jingleDataIsCompact()) {
+			initJingleDataV2();
+		} else {
+			initJingleData();
+		}
+		return 0;
+	}
+
+	if (jingleDataIsCompact()) {
+		// Dropping streams leaves Jingle with 0 bytes in each
+		retval = replaceJingle(idx, 0, 0);
+		if (retval) {
+			return -3;
+		}
+
+		uint16_t* offsets = (uint16_t*)&rawJingleData[JD2_STREAM_OFFSETS_ADDR];
+		memmove(&offsets[2 * idx], &offsets[2 * (idx + 1)], 
+			2 * (MAX_NUM_JINGLES - idx - 1) * sizeof(uint16_t));
+		offsets[2 * (MAX_NUM_JINGLES - 1)] = 0;
+		offsets[2 * (MAX_NUM_JINGLES - 1) + 1] = 0;
+
+		setNumJingles(num_jingles - 1);
+
+		return 0;
+	}
+
+	uint16_t offset = getJingleOffset(idx);
+	if (!offset) {
+		return -4;
+	}
+
+	// Data shared with other Jingles stays
+	if (!jingleRegionIsShared(offset)) {
+		retval = resizeJingleRegion(offset, getJingleSize(idx), 0);
+		if (retval) {
+			return -5;
+		}
+	}
+
+	// Shift down offsets of following Jingles. Unused offsets reference the
+	//  last Jingle (see addJingle())
+	uint16_t* offsets = (uint16_t*)&rawJingleData[6];
+	memmove(&offsets[idx], &offsets[idx + 1], 
+		(MAX_NUM_JINGLES - idx - 1) * sizeof(uint16_t));
+	setNumJingles(num_jingles - 1);
+	fillUnusedJingleOffsets();
+
+	updateJingleBytesFree();
+
+	return 0;
+}
+
+/**
+ * Prefetch chunks of EEPROM Jingle Data into any JingleReader buffers that 
+ *  have been consumed.
+ *
+ * \param[inout] reader Reader to fill buffers of.
+ *
+ * \return None.
+ */
+static void fillJingleReader(JingleReader* reader) {
+	for (int cnt = 0; cnt < 2; cnt++) {
+		uint8_t buf = (reader->rdBuf + cnt) & 1;
+		if (reader->full[buf] || reader->addr >= reader->end) {
+			continue;
+		}
+
+		uint16_t len = reader->end - reader->addr;
+		if (len > JINGLE_CHUNK_BYTES) {
+			len = JINGLE_CHUNK_BYTES;
+		}
+
+		if (eepromRead(JINGLE_DATA_EEPROM_OFFSET + reader->addr, 
+			reader->bufs[buf], len)) {
+			// Treat as end of data
+			reader->end = reader->addr;
+			return;
+		}
+
+		reader->lens[buf] = len;
+		reader->addr += len;
+		reader->full[buf] = true;
+	}
+}
+
+/**
+ * Setup reader for range of EEPROM Jingle Data and prefetch first chunks.
+ *  Deferred tasks must be locked while calling this.
+ *
+ * \param[out] reader Reader to setup.
+ * \param start Byte offset in blob to start reading at.
+ * \param end Byte offset in blob to stop reading at.
+ *
+ * \return None.
+ */
+static void initJingleReader(JingleReader* reader, uint16_t start, 
+	uint16_t end) {
+	memset(reader, 0, sizeof(*reader));
+	reader->addr = start;
+	reader->end = end <= JINGLE_DATA_MAX_BYTES ? end : JINGLE_DATA_MAX_BYTES;
+
+	fillJingleReader(reader);
+}
+
+/**
+ * Get next byte from JingleReader. Called from haptic Timer IRQ. Switches
+ *  to other chunk once current one is consumed and requests a prefetch. 
+ *
+ * \param[inout] reader Reader to get byte from.
+ * \param[out] val Byte read.
+ *
+ * \return False at end of data (or if prefetch fell behind).
+ */
+static bool readJingleByte(JingleReader* reader, uint8_t* val) {
+	for (int cnt = 0; cnt < 2; cnt++) {
+		uint8_t buf = reader->rdBuf;
+		if (!reader->full[buf]) {
+			return false;
+		}
+
+		if (reader->rdIdx < reader->lens[buf]) {
+			*val = reader->bufs[buf][reader->rdIdx++];
+			return true;
+		}
+
+		reader->full[buf] = false;
+		reader->rdBuf = buf ^ 1;
+		reader->rdIdx = 0;
+		postTaskEvent(TASK_JINGLE, 1);
+	}
+
+	return false;
+}
+
+/**
+ * Prefetch more EEPROM Jingle Data for Jingles being played.
+ *
+ * \param events Not used. Any event means a buffer was consumed.
+ *
+ * \return None.
+ */
+static void jingleTask(uint32_t events) {
+	fillJingleReader(&jingleReaders[R_HAPTIC]);
+	fillJingleReader(&jingleReaders[L_HAPTIC]);
+}
+
+/**
+ * NoteSrcFnc that reads (non-compact) Notes from EEPROM Jingle Data.
+ *
+ * \param[inout] ctx JingleReader for Notes.
+ * \param[out] note Next Note to play.
+ *
+ * \return False if there are no more Notes.
+ */
+static bool eepromNoteSrc(void* ctx, struct Note* note) {
+	JingleReader* reader = (JingleReader*)ctx;
+	uint8_t bytes[sizeof(Note)];
+
+	for (int idx = 0; idx < sizeof(bytes); idx++) {
+		if (!readJingleByte(reader, &bytes[idx])) {
+			return false;
+		}
+	}
+
+	note->dutyCycle = bytes[0];
+	note->envelope = bytes[1];
+	note->pulseFreq = bytes[2] | (bytes[3] << 8);
+	note->duration = bytes[4] | (bytes[5] << 8);
+
+	return true;
+}
+
+/**
+ * Get next byte from compact stream.
+ *
+ * \param[inout] dec Decoder state.
+ * \param[out] val Byte read.
+ *
+ * \return False if end of blob was reached.
+ */
+static inline bool decodeByte(JingleDecoder* dec, uint8_t* val) {
+	if (dec->reader) {
+		return readJingleByte(dec->reader, val);
+	}
+
+	if (dec->ptr >= dec->end) {
+		return false;
+	}
+
+	*val = *dec->ptr++;
+
+	return true;
+}
+
+/**
+ * Get next varint from compact stream.
+ *
+ * \param[inout] dec Decoder state.
+ * \param[out] val Value read.
+ *
+ * \return False if end of blob was reached or varint is too long.
+ */
+static bool decodeVarint(JingleDecoder* dec, uint32_t* val) {
+	uint32_t result = 0;
+
+	// Values are at most 17 bits (i.e. zigzag of 16-bit delta)
+	for (int shift = 0; shift <= 14; shift += 7) {
+		uint8_t byte = 0;
+		if (!decodeByte(dec, &byte)) {
+			return false;
+		}
+		result |= (uint32_t)(byte & 0x7f) << shift;
+		if (!(byte & 0x80)) {
+			*val = result;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/**
+ * Get duration for a Note or Rest token.
+ *
+ * \param[inout] dec Decoder state.
+ * \param durIdx Index into duration table from token.
+ * \param[out] duration Duration in ms.
+ *
+ * \return False on invalid stream.
+ */
+static bool decodeDuration(JingleDecoder* dec, uint8_t durIdx, 
+	uint16_t* duration) {
+	if (durIdx == JD2_DUR_VARINT) {
+		uint32_t val = 0;
+		if (!decodeVarint(dec, &val) || val > 0xffff) {
+			return false;
+		}
+		*duration = val;
+		return true;
+	}
+
+	if (durIdx >= dec->numDurs) {
+		return false;
+	}
+
+	// Table may not be aligned, so read a byte at a time
+	*duration = dec->durs[2 * durIdx] | (dec->durs[2 * durIdx + 1] << 8);
+
+	return true;
+}
+
+/**
+ * Setup decoder to start at beginning of a compact stream.
+ *
+ * \param[out] dec Decoder state.
+ * \param offset Byte offset of stream in Jingle Data.
+ *
+ * \return False if there is no valid stream at offset.
+ */
+static bool initJingleDecoder(JingleDecoder* dec, uint16_t offset) {
+	if (!offset || offset + JD2_STREAM_HDR_BYTES > JINGLE_DATA_MAX_BYTES) {
+		return false;
+	}
+
+	memset(dec, 0, sizeof(*dec));
+
+	dec->ptr = &rawJingleData[offset];
+	dec->end = &rawJingleData[JINGLE_DATA_MAX_BYTES];
+	dec->dutyCycle = *dec->ptr++;
+	dec->envelope = *dec->ptr++;
+	dec->numDurs = *dec->ptr++;
+	dec->durs = dec->ptr;
+	dec->ptr += 2 * dec->numDurs;
+
+	return dec->ptr <= dec->end;
+}
+
+/**
+ * Setup decoder to start at beginning of a compact stream in EEPROM. 
+ *  Deferred tasks must be locked while calling this.
+ *
+ * \param[out] dec Decoder state.
+ * \param[out] reader Used to read stream from EEPROM.
+ * \param[out] durs Buffer for copy of stream duration table.
+ * \param offset Byte offset of stream in Jingle Data.
+ * \param end Byte offset of end of all stream data.
+ *
+ * \return False if there is no valid stream at offset.
+ */
+static bool initJingleDecoderEEPROM(JingleDecoder* dec, JingleReader* reader,
+	uint8_t* durs, uint16_t offset, uint16_t end) {
+	uint8_t hdr[JD2_STREAM_HDR_BYTES];
+
+	if (!offset || offset + JD2_STREAM_HDR_BYTES > JINGLE_DATA_MAX_BYTES) {
+		return false;
+	}
+
+	if (eepromRead(JINGLE_DATA_EEPROM_OFFSET + offset, hdr, sizeof(hdr))) {
+		return false;
+	}
+	offset += sizeof(hdr);
+
+	// Duration table is accessed randomly, so copy it to RAM
+	uint8_t num_durs = hdr[2];
+	if (num_durs > JD2_DUR_VARINT || 
+		offset + 2 * num_durs > JINGLE_DATA_MAX_BYTES) {
+		return false;
+	}
+	if (num_durs && eepromRead(JINGLE_DATA_EEPROM_OFFSET + offset, durs, 
+		2 * num_durs)) {
+		return false;
+	}
+	offset += 2 * num_durs;
+
+	memset(dec, 0, sizeof(*dec));
+
+	dec->dutyCycle = hdr[0];
+	dec->envelope = hdr[1];
+	dec->numDurs = num_durs;
+	dec->durs = durs;
+	dec->reader = reader;
+
+	initJingleReader(reader, offset, end);
+
+	return true;
+}
+
+/**
+ * NoteSrcFnc that decodes compact stream one Note at a time. Called from 
+ *  haptic Timer IRQ at Note boundaries, so it only does a few byte reads and
+ *  adds per Note.
+ *
+ * \param[inout] ctx JingleDecoder for stream.
+ * \param[out] note Next Note to play.
+ *
+ * \return False if there are no more Notes.
+ */
+static bool jingleNoteSrc(void* ctx, struct Note* note) {
+	JingleDecoder* dec = (JingleDecoder*)ctx;
+
+	if (dec->repeatsLeft) {
+		dec->repeatsLeft--;
+		*note = dec->last;
+		return true;
+	}
+
+	while (1) {
+		uint8_t tok = 0;
+		if (!decodeByte(dec, &tok)) {
+			return false;
+		}
+		uint8_t arg = tok & JD2_TOK_ARG_MASK;
+
+		switch (tok & JD2_TOK_OP_MASK) {
+		case JD2_TOK_NOTE: {
+			uint16_t duration = 0;
+			uint32_t zigzag = 0;
+			if (!decodeDuration(dec, arg, &duration) || 
+				!decodeVarint(dec, &zigzag)) {
+				return false;
+			}
+			dec->freq += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+
+			dec->last.dutyCycle = dec->dutyCycle;
+			dec->last.envelope = dec->envelope;
+			dec->last.pulseFreq = dec->freq;
+			dec->last.duration = duration;
+			*note = dec->last;
+			return true;
+		}
+		case JD2_TOK_REST: {
+			uint16_t duration = 0;
+			if (!decodeDuration(dec, arg, &duration)) {
+				return false;
+			}
+
+			dec->last.dutyCycle = 0;
+			dec->last.envelope = 0;
+			dec->last.pulseFreq = 0;
+			dec->last.duration = duration;
+			*note = dec->last;
+			return true;
+		}
+		case JD2_TOK_REPEAT:
+			if (!arg) {
+				return false;
+			}
+			dec->repeatsLeft = arg - 1;
+			*note = dec->last;
+			return true;
+		default:
+			if (tok == JD2_TOK_DUTY) {
+				if (!decodeByte(dec, &dec->dutyCycle)) {
+					return false;
+				}
+			} else if (tok == JD2_TOK_ENV) {
+				if (!decodeByte(dec, &dec->envelope)) {
+					return false;
+				}
+			} else {
+				// End of stream (or reserved token)
+				return false;
+			}
+			break;
+		}
+	}
+}
+
+/**
+ * Print to console details on a particular Jingle in compact Jingle Data.
+ *
+ * \param idx Indicates which Jingle is being referred to.
+ * 
+ * \return 0 on success.
+ */
+static int printJingleV2(uint8_t idx) {
+	for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+		uint16_t offset = getJingleStreamOffset(haptic, idx);
+		printf("%s stream offset = 0x%03x\n", 
+			haptic == R_HAPTIC ? "Right" : "Left", offset);
+
+		JingleDecoder dec;
+		if (!initJingleDecoder(&dec, offset)) {
+			continue;
+		}
+
+		Note note;
+		int note_idx = 0;
+		while (jingleNoteSrc(&dec, &note)) {
+			printf("Note[%d] = 0x%04x (%d), 0x%04x (%d), 0x%04x (%d), "
+				"0x%02x\n", note_idx,
+				note.dutyCycle, note.dutyCycle, 
+				note.pulseFreq, note.pulseFreq, 
+				note.duration, note.duration,
+				note.envelope);
+			note_idx++;
+		}
+		printf("Stream bytes = %d\n", dec.ptr - &rawJingleData[offset]);
+	}
+
+	return 0;
+}
+
+/**
+ * Play a Jingle from compact Jingle Data. Notes are decoded as they are 
+ *  needed by haptic Timer IRQ.
+ *
+ * \param idx Indicates which Jingle is being referred to. 
+ * 
+ * \return 0 on success.
+ */
+static int playJingleV2(uint8_t idx) {
+	// Decoders may still be in use by a Jingle that is playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -1;
+	}
+
+	bool right = initJingleDecoder(&jingleDecoders[R_HAPTIC],
+		getJingleStreamOffset(R_HAPTIC, idx));
+	bool left = initJingleDecoder(&jingleDecoders[L_HAPTIC],
+		getJingleStreamOffset(L_HAPTIC, idx));
+
+	if (!right && !left) {
+		return 0;
+	}
+
+	if (playHapticSrcStereo(
+		right ? jingleNoteSrc : NULL, &jingleDecoders[R_HAPTIC],
+		left ? jingleNoteSrc : NULL, &jingleDecoders[L_HAPTIC])) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Compute CRC-32 (IEEE 802.3, as used by zlib) of a buffer. Uses a nibble
+ *  table to keep flash usage small.
+ *
+ * \param[in] data Buffer to compute CRC of.
+ * \param len Number of bytes in data.
+ *
+ * \return CRC-32 of data.
+ */
+static uint32_t crc32(const uint8_t* data, uint32_t len) {
+	static const uint32_t table[16] = {
+		0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+		0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+		0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+		0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+	};
+
+	uint32_t crc = 0xffffffff;
+	for (uint32_t idx = 0; idx < len; idx++) {
+		crc ^= data[idx];
+		crc = (crc >> 4) ^ table[crc & 0xf];
+		crc = (crc >> 4) ^ table[crc & 0xf];
+	}
+
+	return ~crc;
+}
+
+/**
+ * Receive raw Jingle Data blob as binary data via USB and replace current
+ *  Jingle Data with it. Current Jingle Data is only replaced if the whole 
+ *  blob is received and valid.
+ *
+ * \param len Number of bytes in blob.
+ * \param crc Expected CRC-32 of blob.
+ *
+ * \return 0 on success.
+ */
+static int uploadJingleData(uint16_t len, uint32_t crc) {
+	if (len < sizeof(JD_MAGIC_WORD) || len > JINGLE_DATA_MAX_BYTES) {
+		return -1;
+	}
+
+	// Notes are read directly from Jingle Data while playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -2;
+	}
+
+	printf("Ready for %d bytes.\n", len);
+	usb_flush();
+
+	uint32_t num_rcvd = usb_getb((char*)loadJingleData, len, 
+		JINGLE_LOAD_TIMEOUT_US);
+	if (num_rcvd != len) {
+		printf("Timeout after %d bytes\n", num_rcvd);
+		return -3;
+	}
+
+	if (crc32(loadJingleData, len) != crc) {
+		return -4;
+	}
+
+	memset(&loadJingleData[len], 0, JINGLE_DATA_MAX_BYTES - len);
+
+	// Swap in new data. Swap back if it turns out to not be valid
+	uint8_t* prev_data = rawJingleData;
+	rawJingleData = loadJingleData;
+
+	if (!jingleDataIsValid()) {
+		rawJingleData = prev_data;
+		return -5;
+	}
+
+	loadJingleData = jingleMirror;
+	jingleMirror = rawJingleData;
+	jingleDataLoc = JD_LOC_RAM;
+
+	updateJingleBytesFree();
+
+	return 0;
+}
+
+/**
+ * Print information on Jingle Data Blob.
+ * 
+ * \return 0 on success.
+ */
+static int printJingleData(void) {
+	printf("Magic Word = 0x%04x\n", getMagicWord());
+	printf("Number of Jingles = %d\n", getNumJingles());
+
+	if (jingleDataIsCompact()) {
+		printf("Format version = %d\n", rawJingleData[2]);
+		for (int idx = 0; idx < getNumJingles(); idx++) {
+			printf("Jingle[%d] offsets = 0x%03x, 0x%03x\n", idx, 
+				getJingleStreamOffset(R_HAPTIC, idx),
+				getJingleStreamOffset(L_HAPTIC, idx));
+		}
+	} else {
+		for (int idx = 0; idx < getNumJingles(); idx++) {
+			printf("Jingle[%d] offset = 0x%03x\n", idx, 
+				getJingleOffset(idx));
+		}
+	}
+
+	printf("Bytes free in blob = 0x%03x\n", numJingleBytesFree);
+
+	return 0;
+}
+
+/**
+ * Print to console details on a particular Jingle.
+ *
+ * \param idx Indicates which Jingle is being referred to.
+ * 
+ * \return 0 on success.
+ */
+static int printJingle(uint8_t idx) {
+	if (idx >= getNumJingles()) {
+		printf("jingleNum %d too large\n", idx);
+		return -1;
+	}
+
+	if (jingleDataIsCompact()) {
+		return printJingleV2(idx);
+	}
+
+	uint16_t offset = getJingleOffset(idx);
+	if (!offset) {
+		printf("Invalid offset (0x%04x)\n", offset);
+		return -1;
+	}
+
+	printf("offset = 0x%03x\n", offset);
+	uint16_t numNotesRight = getNumJingleNotes(R_HAPTIC, idx);
+	printf("numNotesRight = %d\n", numNotesRight);
+	uint16_t numNotesLeft = getNumJingleNotes(L_HAPTIC, idx);
+	printf("numNotesLeft = %d\n", numNotesLeft);
+	struct Note* notesRight = getJingleNotes(R_HAPTIC, idx);
+	printf("notesRight = 0x%08x\n", notesRight);
+	struct Note* notesLeft = getJingleNotes(L_HAPTIC, idx);
+	printf("notesLeft = 0x%08x\n", notesLeft);
+
+	for (int idx = 0; idx < numNotesRight; idx++) {
+		if (!notesRight)
+			break;
+
+		printf("Note[%d] = 0x%04x (%d), 0x%04x (%d), 0x%04x (%d), "
+			"0x%02x\n", idx,
+			notesRight[idx].dutyCycle, notesRight[idx].dutyCycle, 
+			notesRight[idx].pulseFreq, notesRight[idx].pulseFreq, 
+			notesRight[idx].duration, notesRight[idx].duration,
+			notesRight[idx].envelope);
+	}
+	for (int idx = 0; idx < numNotesLeft; idx++) {
+		if (!notesLeft)
+			break;
+
+		printf("Note[%d] = 0x%04x (%d), 0x%04x (%d), 0x%04x (%d), "
+			"0x%02x\n", idx,
+			notesLeft[idx].dutyCycle, notesLeft[idx].dutyCycle,
+			notesLeft[idx].pulseFreq, notesLeft[idx].pulseFreq,
+			notesLeft[idx].duration, notesLeft[idx].duration,
+			notesLeft[idx].envelope);
+	}
+
+	return 0;
+}
+
+/**
+ * Play a Jingle directly from EEPROM Jingle Data. Notes are prefetched in 
+ *  chunks by TASK_JINGLE while they are played.
+ *
+ * \param idx Indicates which Jingle is being referred to. 
+ * 
+ * \return 0 on success.
+ */
+static int playJingleEEPROM(uint8_t idx) {
+	int retval = 0;
+
+	// Readers may still be in use by a Jingle that is playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -1;
+	}
+
+	NoteSrcFnc srcs[2] = {NULL, NULL};
+	void* ctxs[2] = {NULL, NULL};
+
+	// Keep TASK_JINGLE from prefetching into half setup readers
+	bool unlock = lockDeferredTasks();
+
+	if (jingleDataIsCompact()) {
+		uint16_t end = getJingleData16(JD2_DATA_END_ADDR);
+		for (int haptic = R_HAPTIC; haptic <= L_HAPTIC; haptic++) {
+			ctxs[haptic] = &jingleDecoders[haptic];
+			if (initJingleDecoderEEPROM(&jingleDecoders[haptic],
+				&jingleReaders[haptic], jingleDurs[haptic], 
+				getJingleStreamOffset(haptic, idx), end)) {
+				srcs[haptic] = jingleNoteSrc;
+			}
+		}
+	} else {
+		// Header is mirrored, but Note counts need to be read
+		uint16_t offset = getJingleOffset(idx);
+		uint16_t num_notes[2] = {0, 0};
+		if (!offset || eepromRead(JINGLE_DATA_EEPROM_OFFSET + offset,
+			num_notes, sizeof(num_notes))) {
+			retval = -2;
+		}
+
+		uint32_t start = offset + 2 * sizeof(uint16_t);
+		for (int haptic = R_HAPTIC; haptic <= L_HAPTIC && !retval; 
+			haptic++) {
+			uint32_t len = num_notes[haptic] * sizeof(Note);
+			ctxs[haptic] = &jingleReaders[haptic];
+			if (len && start + len <= JINGLE_DATA_MAX_BYTES) {
+				initJingleReader(&jingleReaders[haptic], start, 
+					start + len);
+				srcs[haptic] = eepromNoteSrc;
+			}
+			start += len;
+		}
+	}
+
+	if (unlock) {
+		unlockDeferredTasks();
+	}
+
+	if (retval) {
+		return retval;
+	}
+
+	if (!srcs[R_HAPTIC] && !srcs[L_HAPTIC]) {
+		return 0;
+	}
+
+	if (playHapticSrcStereo(srcs[R_HAPTIC], ctxs[R_HAPTIC], 
+		srcs[L_HAPTIC], ctxs[L_HAPTIC])) {
+		return -3;
+	}
+
+	return 0;
+}
+
+/**
+ * Play a specified Jingle using the haptics.
+ * 
+ * \param idx Indicates which Jingle is being referred to. 
+ * 
+ * \return 0 on success.
+ */
+int playJingle(uint8_t idx) {
+	if (idx >= getNumJingles())
+		return -1;
+
+	if (jingleDataLoc == JD_LOC_EEPROM)
+		return playJingleEEPROM(idx);
+
+	if (jingleDataIsCompact())
+		return playJingleV2(idx);
+
+	uint16_t offset = getJingleOffset(idx);
+	if (!offset)
+		return -1;
+
+	uint16_t numNotesRight = getNumJingleNotes(R_HAPTIC, idx);
+	uint16_t numNotesLeft = getNumJingleNotes(L_HAPTIC, idx);
+	struct Note* notesRight = getJingleNotes(R_HAPTIC, idx);
+	struct Note* notesLeft = getJingleNotes(L_HAPTIC, idx);
+
+	if (!notesRight)
+		numNotesRight = 0;
+	if (!notesLeft)
+		numNotesLeft = 0;
+
+	if (!numNotesRight && !numNotesLeft)
+		return 0;
+
+	// Start both haptics on a shared timeline so they stay in sync
+	if (playHapticStereo(notesRight, numNotesRight, notesLeft, 
+		numNotesLeft))
+		return -1;
+
+	return 0;
+}
+
+/**
+ * Load Jingle Data from EEPROM. This will attempt to replace Jingle Data with 
+ *  data from EEPROM. If EEPROM data is invalid, local Jingle Data will be
+ *  cleared. Only the header (and number of notes of each Jingle, to check 
+ *  the data) is copied to RAM, Jingles are played directly from EEPROM until
+ *  Jingle Data is changed.
+ * 
+ * \return 0 on success.
+ */
+static int loadJingleEEPROM(void) {
+	// Readers may still be in use by a Jingle that is playing
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -3;
+	}
+
+	selectJingleMirror();
+	memset(rawJingleData, 0, JINGLE_DATA_MAX_BYTES);
+
+	int retval = eepromRead(JINGLE_DATA_EEPROM_OFFSET, rawJingleData, 
+		JD2_HDR_BYTES);
+
+	// Jingle sizes are needed to check (non-compact) Jingle Data, so also
+	//  get number of notes of each Jingle from EEPROM
+	if (!retval && getMagicWord() == JD_MAGIC_WORD) {
+		for (int idx = 0; idx < getNumJingles() && 
+			idx < MAX_NUM_JINGLES; idx++) {
+			uint16_t offset = getJingleOffset(idx);
+			if (offset && offset + 2 * sizeof(uint16_t) <= 
+				JINGLE_DATA_MAX_BYTES && !(offset % sizeof(uint16_t))) {
+				retval = eepromRead(JINGLE_DATA_EEPROM_OFFSET + offset,
+					&rawJingleData[offset], 2 * sizeof(uint16_t));
+				if (retval) {
+					break;
+				}
+			}
+		}
+	}
+
+	if (retval) {
+		initJingleData();
+		return -1;
+	}
+
+	if (!jingleDataIsValid()) {
+		initJingleData();
+		return -2;
+	}
+
+	jingleDataLoc = JD_LOC_EEPROM;
+	numJingleBytesFree = 0;
+
+	return 0;
+}
+
+/**
+ * Save Jingle Data to EEPROM. This will write current Jingle Data to EEPROM. 
+ *  Note: This will PERSIST even after updating firmware and may affect how the
+ *  official firmware functions. Use \"clear\" to erase.
+ * 
+ * \return 0 on success.
+ */
+static int saveJingleEEPROM(void) {
+	// Already saved
+	if (jingleDataLoc == JD_LOC_EEPROM) {
+		return 0;
+	}
+
+	// Do not overwrite EEPROM while it may be streamed from
+	if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+		return -2;
+	}
+
+	if (useJingleMirror()) {
+		return -3;
+	}
+
+	// Make sure we report there are MAX_NUM_JINGLES in the data blob
+	//  as this is what Steam and the official FW are setup to expect.
+	//  If there are fewer than MAX_NUM_JINGLES the addition spots will
+	//  simply reference back to the last Jingle (this is ensured by 
+	//  addJingle(). Compact data is not used by official FW, so it is
+	//  saved as is
+	uint8_t num_jingles = getNumJingles();
+	if (!jingleDataIsCompact()) {
+		setNumJingles(MAX_NUM_JINGLES);
+	}
+
+	int retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET, rawJingleData, 
+		JINGLE_DATA_MAX_BYTES);
+
+	// Restore the number of Jingles back to original in case user wants to
+	//  continue to change data blob
+	setNumJingles(num_jingles);
+
+	// Now check if EEPROM write succeeded
+	if (retval) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Clear out Jingle Data saved to EEPROM. This will cause official firmware to
+ *   use default Jingle Data embedded in firmware.
+ * 
+ * \return 0 on success.
+ */
+static int clearJingleEEPROM(void) {
+	// Keep current Jingle Data around
+	if (useJingleMirror()) {
+		return -4;
+	}
+
+	uint16_t empty_word = 0;
+	// Clear out header bytes for Jingle Data blob
+	int retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET, &empty_word, 
+		sizeof(empty_word));
+	if (retval) {
+		return -1;
+	}
+	retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET+2, &empty_word, 
+		sizeof(empty_word));
+	if (retval) {
+		return -2;
+	}
+	retval = eepromWrite(JINGLE_DATA_EEPROM_OFFSET+4, &empty_word, 
+		sizeof(empty_word));
+	if (retval) {
+		return -3;
+	}
+
+	return 0;
+}
+
+/**
+ * Prints details to console regarding how to use the haptic command line 
+ *  function.
+ *
+ * \return None.
+ */
+void jingleCmdUsage(void) {
+	printf(
+		"usage: jingle play {jingleIdx}\n"
+		"       jingle print [{jingleIdx}]\n"
+		"       jingle clear [v2]\n"
+		"       jingle delete [{jingleIdx}]\n"
+		"       jingle replace {jingleIdx} {numRight} {numLeft}\n"
 		"       jingle add {numNotesRight} {numNotesLeft}\n"
-		"       jingle note {jingleIdx} {hapticId} {notdeIdx} {dutyCycle} {freq} {dur}\n"
+		"       jingle note {jingleIdx} {hapticId} {notdeIdx} {dutyCycle} {freq} {dur} [{env}]\n"
+		"       jingle add2 {numBytesRight} {numBytesLeft}\n"
+		"       jingle write {jingleIdx} {hapticId} {byteIdx} {hexBytes}\n"
+		"       jingle load {numBytes} {crc32}\n"
+		"       jingle pack\n"
 		"       jingle eeprom {cmd}\n"
 		"\n"
 		"play = play the jingle associated with the given jingleIdx\n"
 		"print = Print info on all the jingles, or details on the notes\n"
 		"       for a jingle associated with a given jingleIdx\n"
-		"delete = Delete last Jingle in Jingle Data\n"
+		"delete = Delete Jingle (last if jingleIdx is not given) and\n"
+		"	compact Jingle Data. Following Jingles move down one index\n"
 		"clear = Initialize the Jingle Data structure to have 0 Jingles\n"
+		"	v2 selects compact format (only understood by this FW)\n"
 		"add = Add a new jingle with the specified number of notes\n"
 		"	for each channel (i.e. haptic)\n"
 		"note = Change a particular note in a particular jingle\n"
 		"	See \"haptic\" command for parameter details\n"
+		"add2 = Add a new jingle to compact Jingle Data with streams\n"
+		"	of the specified number of bytes\n"
+		"write = Write hex encoded bytes to a compact jingle stream\n"
+		"replace = Resize and clear jingle in place. numRight and\n"
+		"	numLeft are notes (or bytes for compact Jingle Data).\n"
+		"	Follow with note (or write) to fill in jingle\n"
+		"load = Replace Jingle Data with raw binary blob. After\n"
+		"	\"Ready\" is printed, send numBytes of binary data with\n"
+		"	the given CRC-32 (as computed by zlib)\n"
+		"pack = Have identical jingles (or compact streams) share\n"
+		"	one copy of their data to free up space\n"
 		"eeprom = Allows access to EEPROM where custom Jingle Data\n"
 		"	can persist, even if firmware is updated.\n"
 		"	Below are descriptions of supported commands:\n"
 		" 	\"load\" Load Jingle Data from EEPROM. This will \n"
 		"	 attempt to replace Jingle Data with data from EEPROM.\n"
 		"	 If EEPROM data is invalid, local Jingle Data will be\n"
-		"	 cleared.\n"
+		"	 cleared. Jingles are then played directly from\n"
+		"	 EEPROM until Jingle Data is changed.\n"
 		"	\"save\"  Save Jingle Data to EEPROM. This will write\n"
 		"	 current Jingle Data to EEPROM. Note: This will PERSIST\n"
 		"	 even after updating firmware and may affect how the\n"
@@ -879,6 +2362,16 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 		return -1;
 	}
 
+	// Jingle Data needs to be in RAM to be changed or inspected
+	if (strcmp("play", argv[1]) && strcmp("clear", argv[1]) && 
+		strcmp("load", argv[1]) && strcmp("eeprom", argv[1])) {
+		retval = useJingleMirror();
+		if (retval) {
+			printf("Error reading Jingle Data (err = %d)\n", retval);
+			return -1;
+		}
+	}
+
 	if (!strcmp("play", argv[1])) {
 		if (argc != 3) {
 			jingleCmdUsage();
@@ -928,27 +2421,113 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 			return -1;
 		}
 	} else if (!strcmp("clear", argv[1])) {
-		if (argc != 2) {
-			jingleCmdUsage();
+		// Notes are read directly from Jingle Data while playing
+		if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+			printf("Cannot change Jingle Data while a Jingle is playing\n");
 			return -1;
 		}
 
-		initJingleData();
+		if (argc == 2) {
+			initJingleData();
+		} else if (argc == 3 && !strcmp("v2", argv[2])) {
+			initJingleDataV2();
+		} else {
+			jingleCmdUsage();
+			return -1;
+		}
 
 		printf("Jingle data cleared successfully.\n");
 	} else if (!strcmp("delete", argv[1])) {
-		if (argc != 2) {
+		if (argc != 2 && argc != 3) {
 			jingleCmdUsage();
 			return -1;
 		}
 
-		retval = delJingle();
+		if (!getNumJingles()) {
+			printf("No jingles to delete\n");
+			return -1;
+		}
+
+		jingle_idx = getNumJingles() - 1;
+		if (argc == 3) {
+			jingle_idx = strtol(argv[2], NULL, 0);
+			if (jingle_idx >= getNumJingles()) {
+				printf("Only %d jingles available\n", 
+					getNumJingles());
+				return -1;
+			}
+		}
+
+		retval = delJingle(jingle_idx);
 		if (retval) {
 			printf("Error deleting Jingle (err = %d)\n", retval);
 			return -1;
 		}
 
 		printf("Jingle deleted successfully.\n");
+	} else if (!strcmp("load", argv[1])) {
+		if (argc != 4) {
+			jingleCmdUsage();
+			return -1;
+		}
+
+		uint32_t num_bytes = strtoul(argv[2], NULL, 0);
+		uint32_t crc = strtoul(argv[3], NULL, 0);
+		if (num_bytes > JINGLE_DATA_MAX_BYTES) {
+			printf("numBytes must be in range 0 to %d\n", 
+				JINGLE_DATA_MAX_BYTES);
+			return -1;
+		}
+
+		retval = uploadJingleData(num_bytes, crc);
+		if (retval) {
+			printf("Error loading Jingle Data (err = %d)\n", retval);
+			return -1;
+		}
+
+		printf("Jingle data loaded successfully.\n");
+	} else if (!strcmp("replace", argv[1])) {
+		if (argc != 5) {
+			jingleCmdUsage();
+			return -1;
+		}
+
+		jingle_idx = strtol(argv[2], NULL, 0);
+		if (jingle_idx >= getNumJingles()) {
+			printf("Only %d jingles available\n", 
+				getNumJingles());
+			return -1;
+		}
+
+		uint32_t num_right = strtol(argv[3], NULL, 0);
+		uint32_t num_left = strtol(argv[4], NULL, 0);
+		if (num_right > JINGLE_DATA_MAX_BYTES || 
+			num_left > JINGLE_DATA_MAX_BYTES) {
+			printf("numRight and numLeft must be in range 0 to %d\n",
+				JINGLE_DATA_MAX_BYTES);
+			return -1;
+		}
+
+		retval = replaceJingle(jingle_idx, num_right, num_left);
+		if (retval) {
+			printf("Error replacing Jingle (err = %d)\n", retval);
+			return -1;
+		}
+
+		printf("Jingle %d replaced successfully.\n", jingle_idx);
+	} else if (!strcmp("pack", argv[1])) {
+		if (argc != 2) {
+			jingleCmdUsage();
+			return -1;
+		}
+
+		retval = packJingleData();
+		if (retval < 0) {
+			printf("Error packing Jingle Data (err = %d)\n", retval);
+			return -1;
+		}
+
+		printf("Jingle Data packed (%d bytes freed).\n", retval);
 	} else if (!strcmp("add", argv[1])) {
 		if (argc != 4) {
 			jingleCmdUsage();
@@ -974,8 +2553,97 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 		}
 
 		printf("Jingle %d added successfully.\n", getNumJingles()-1);
+	} else if (!strcmp("add2", argv[1])) {
+		if (argc != 4) {
+			jingleCmdUsage();
+			return -1;
+		}
+
+		uint32_t num_bytes_right = strtol(argv[2], NULL, 0);
+		uint32_t num_bytes_left = strtol(argv[3], NULL, 0);
+		if (num_bytes_right > JINGLE_DATA_MAX_BYTES || 
+			num_bytes_left > JINGLE_DATA_MAX_BYTES) {
+			printf("numBytes must be in range 0 to %d\n", 
+				JINGLE_DATA_MAX_BYTES);
+			return -1;
+		}
+
+		retval = addJingleV2(num_bytes_right, num_bytes_left);
+		if (retval) {
+			printf("Error adding Jingle (err = %d)\n", retval);
+			return -1;
+		}
+
+		printf("Jingle %d added successfully.\n", getNumJingles()-1);
+	} else if (!strcmp("write", argv[1])) {
+		if (argc != 6) {
+			jingleCmdUsage();
+			return -1;
+		}
+
+		jingle_idx = strtol(argv[2], NULL, 0);
+		if (jingle_idx >= getNumJingles()) {
+			printf("Only %d jingles available\n", 
+				getNumJingles());
+			return -1;
+		}
+
+		Haptic hapticId = L_HAPTIC;
+		if (!strcmp(argv[3], "left")) {
+			hapticId = L_HAPTIC;
+		} else if (!strcmp(argv[3], "right")) {
+			hapticId = R_HAPTIC;
+		} else {
+			printf("Invalid hapticId of \'%s\'\n", argv[3]);
+			return -1;
+		}
+
+		uint32_t byte_idx = strtol(argv[4], NULL, 0);
+		if (byte_idx >= JINGLE_DATA_MAX_BYTES) {
+			printf("Invalid byteIdx of %d\n", byte_idx);
+			return -1;
+		}
+
+		// Two hex characters per byte
+		uint8_t data[32];
+		uint32_t len = strlen(argv[5]) / 2;
+		if (len > sizeof(data) || strlen(argv[5]) % 2) {
+			printf("hexBytes must be an even number of at most %d "
+				"characters\n", 2 * sizeof(data));
+			return -1;
+		}
+		for (int idx = 0; idx < len; idx++) {
+			char hex_str[3] = {argv[5][2*idx], argv[5][2*idx+1], 0};
+			char* end = NULL;
+			data[idx] = strtol(hex_str, &end, 16);
+			if (*end) {
+				printf("Invalid hexBytes\n");
+				return -1;
+			}
+		}
+
+		// Notes are read directly from Jingle Data while playing
+		if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+			printf("Cannot change Jingle Data while a Jingle is playing\n");
+			return -1;
+		}
+
+		retval = unshareJingleRegion(2 * jingle_idx + hapticId);
+		if (retval) {
+			printf("No room to copy shared stream (err = %d)\n", retval);
+			return -1;
+		}
+
+		retval = writeJingleStream(hapticId, jingle_idx, byte_idx, data,
+			len);
+		if (retval) {
+			printf("Error writing stream (err = %d)\n", retval);
+			return -1;
+		}
+
+		printf("Stream updated successfully.\n");
 	} else if (!strcmp("note", argv[1])) {
-		if (argc != 8) {
+		if (argc != 8 && argc != 9) {
 			jingleCmdUsage();
 			return -1;
 		}
@@ -990,6 +2658,10 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 				getNumJingles());
 			return -1;
 		}
+		if (jingleDataIsCompact()) {
+			printf("Use write to change compact Jingle Data\n");
+			return -1;
+		}
 
 		Haptic hapticId = L_HAPTIC;
 		if (!strcmp(argv[3], "left")) {
@@ -1018,13 +2690,34 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 			return -1;
 		}
 
+		uint32_t envelope = 0;
+		if (argc == 9) {
+			envelope = strtol(argv[8], NULL, 0);
+			if (envelope > 255) {
+				printf("envelope must be in range 0 to 255\n");
+				return -1;
+			}
+		}
+
 		uint16_t num_notes = getNumJingleNotes(hapticId, jingle_idx);
 		if (note_idx >= num_notes) {
 			printf("Invalid noteIdx of %d. Only %d notes for given channel\n", 
 				note_idx, num_notes);
 			return -1;
 		}
-		
+
+		// Notes are read directly from Jingle Data while playing
+		if (!hapticSeqAvailable(R_HAPTIC) || !hapticSeqAvailable(L_HAPTIC)) {
+			printf("Cannot change Jingle Data while a Jingle is playing\n");
+			return -1;
+		}
+
+		retval = unshareJingleRegion(jingle_idx);
+		if (retval) {
+			printf("No room to copy shared jingle (err = %d)\n", retval);
+			return -1;
+		}
+
 		Note* notes = getJingleNotes(hapticId, jingle_idx);
 		if (!notes) {
 			printf("Error getting notes.\n");
@@ -1032,6 +2725,7 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 		}
 
 		notes[note_idx].dutyCycle = duty_cycle;
+		notes[note_idx].envelope = envelope;
 		notes[note_idx].pulseFreq = frequency;
 		notes[note_idx].duration = duration;
 
@@ -1077,3 +2771,12 @@ int jingleCmdFnc(int argc, const char* argv[]) {
 
 	return 0;
 }
+
+/**
+ * Setup for playing Jingles.
+ *
+ * \return None.
+ */
+void initJingles(void) {
+	registerTask(TASK_JINGLE, jingleTask, TASK_CTX_DEFERRED);
+}
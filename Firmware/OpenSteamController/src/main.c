@@ -43,6 +43,8 @@
 #include "console.h"
 #include "usb.h"
 #include "time.h"
+#include "sched.h"
+#include "watchdog.h"
 
 /**
  * "Entry point" for Steam Controller dev kit. Keep in mind that you are most
@@ -60,9 +62,9 @@ int main(void){
 	// Read magic number and hw version from EEPROM
 	retval = eepromRead(0, eeprom_data, sizeof(eeprom_data));
 	if (CMD_SUCCESS != retval) {
-		// Hard lock if we cannot read EEPROM
-		volatile int lock = 1;
-		while (lock) {}
+		// Hard lock if we cannot read EEPROM. Watchdog will reset chip
+		//  so read can be retried
+		watchdogLock(WDOG_MARK_EEPROM_LOCK);
 	}
 
 	stage2Init(eeprom_data[1]);
@@ -87,25 +89,18 @@ int main(void){
 	}
 	printf("\n");
 	*/
+#endif
 
-	// Main execution loop
-	while(1) {
-		// Check serial input device for new characters to process
-		handleConsoleInput();
-		// Sleep until next IRQ happens
-		__WFI();
-	}
-
-#elif (FIRMWARE_BEHAVIOR == SWITCH_WIRED_POWERA_FW)
-
-	// Main execution loop
-	while(1) {
-		// Update USB status packet sent to Switch
-		updateControllerStatusPacket();
-		// Sleep until next IRQ happens
-		__WFI();
-	}
+#if (USB_CDC_CONSOLE)
+	// Console input is handled as it is received via USB
+	initConsole();
 #endif
 
+	// Main execution loop. Everything else is driven by IRQs posting 
+	//  events to tasks (i.e. USB status packets sent to Switch are 
+	//  handled by a deferred task)
+	watchdogMark(WDOG_MARK_RUNNING);
+	runSched();
+
 	return 0 ;
 }
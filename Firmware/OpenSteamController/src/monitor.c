@@ -79,6 +79,13 @@ int monitorCmdFnc(int argc, const char* argv[]) {
 		printf("Monitoring Steam Controller. Time = 0x%08x. (Press any key to exit):\n", 
 			getUsTickCnt());
 
+		// Values below are used to index strings, so do not carry on 
+		//  with garbage if ADC is not responding
+		if (getAdcVal(ADC_CH6) == ADC_VAL_TIMEOUT) {
+			printf("Timed out waiting for ADC update\n");
+			return -1;
+		}
+
 		uint16_t adc_l_trig = getAdcVal(ADC_L_TRIG);
 		uint16_t adc_r_trig = getAdcVal(ADC_R_TRIG);
 
@@ -0,0 +1,237 @@
+/**
+ * \file sched.c
+ * \brief Run-to-completion task scheduler. Work is posted to tasks as event flags
+ *  (safe from any ISR) and tasks run either deferred (in PendSV, below all
+ *  other interrupts) or in thread mode (main loop).
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "sched.h"
+#include "watchdog.h"
+
+#include "lpc_types.h"
+#include "chip.h"
+
+#include <string.h>
+
+/**
+ * Scheduler details for a single task.
+ */
+typedef struct TaskEntry {
+	TaskFnc fnc; //!< Function to call when task has events. NULL if task 
+		//!< is not registered.
+	TaskCtx ctx; //!< Where task runs.
+	volatile uint32_t events; //!< Events posted since task last ran.
+} TaskEntry;
+
+static TaskEntry tasks[NUM_TASKS]; //!< All tasks.
+static volatile uint32_t readyTasks[NUM_TASK_CTXS]; //!< Bit per task that
+	//!< has events pending, for each context.
+static volatile bool deferredLocked; //!< Deferred tasks are held off while
+	//!< set (see lockDeferredTasks()).
+
+/**
+ * Disable interrupts, keeping track of whether they were already disabled so
+ *  that this can be called from any context.
+ *
+ * \return Value to pass to exitSchedCritical().
+ */
+inline static uint32_t enterSchedCritical(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+/**
+ * Restore interrupts to state before enterSchedCritical().
+ *
+ * \param primask Value returned by enterSchedCritical().
+ *
+ * \return None.
+ */
+inline static void exitSchedCritical(uint32_t primask) {
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Run all tasks in a context until none of them have events pending.
+ *
+ * \param ctx Context to run tasks for.
+ *
+ * \return None.
+ */
+static void runReadyTasks(TaskCtx ctx) {
+	while (1) {
+		uint32_t primask = enterSchedCritical();
+
+		uint32_t ready = readyTasks[ctx];
+		if (!ready) {
+			exitSchedCritical(primask);
+			return;
+		}
+
+		// Lowest numbered task first
+		int task = 0;
+		while (!(ready & (1 << task))) {
+			task++;
+		}
+
+		uint32_t events = tasks[task].events;
+		tasks[task].events = 0;
+		readyTasks[ctx] = ready & ~(1 << task);
+
+		exitSchedCritical(primask);
+
+		Task prev_task = watchdogSetTask(task);
+		tasks[task].fnc(events);
+		watchdogSetTask(prev_task);
+	}
+}
+
+/**
+ * Interrupt handler for PendSV. Runs all deferred tasks that have events.
+ *
+ * \return None.
+ */
+void PendSV_Handler(void) {
+	// Tasks stay ready and PendSV is set again by unlockDeferredTasks()
+	if (deferredLocked) {
+		return;
+	}
+
+	runReadyTasks(TASK_CTX_DEFERRED);
+}
+
+/**
+ * Initialization that needs to happen before any tasks are registered.
+ *
+ * \return None.
+ */
+void initSched(void) {
+	memset(tasks, 0, sizeof(tasks));
+	memset((void*)readyTasks, 0, sizeof(readyTasks));
+	deferredLocked = false;
+
+	// Deferred tasks must never hold off a real interrupt
+	NVIC_SetPriority(PendSV_IRQn, (1 << __NVIC_PRIO_BITS) - 1);
+}
+
+/**
+ * Register function to be run when events are posted to a task.
+ *
+ * \param task Task to register.
+ * \param fnc Function implementing task.
+ * \param ctx Where task is to run.
+ *
+ * \return None.
+ */
+void registerTask(Task task, TaskFnc fnc, TaskCtx ctx) {
+	uint32_t primask = enterSchedCritical();
+
+	tasks[task].fnc = fnc;
+	tasks[task].ctx = ctx;
+	tasks[task].events = 0;
+
+	exitSchedCritical(primask);
+}
+
+/**
+ * Post events to a task, which will cause it to run. Safe to call from any
+ *  context, including ISRs and other tasks. Events posted more than once 
+ *  before task runs are merged.
+ *
+ * \param task Task to post events to.
+ * \param events Event flags to set. Meaning is defined by task.
+ *
+ * \return None.
+ */
+void postTaskEvent(Task task, uint32_t events) {
+	if (!tasks[task].fnc) {
+		return;
+	}
+
+	uint32_t primask = enterSchedCritical();
+
+	tasks[task].events |= events;
+	readyTasks[tasks[task].ctx] |= 1 << task;
+
+	exitSchedCritical(primask);
+
+	if (tasks[task].ctx == TASK_CTX_DEFERRED) {
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+}
+
+/**
+ * Hold off deferred tasks from starting (i.e. while data shared with them is
+ *  being accessed). Deferred tasks that are already running are not affected.
+ *
+ * \return True if this call locked deferred tasks, false if they were already
+ *	locked (i.e. nested call, which must not call unlockDeferredTasks()).
+ */
+bool lockDeferredTasks(void) {
+	uint32_t primask = enterSchedCritical();
+
+	bool was_locked = deferredLocked;
+	deferredLocked = true;
+
+	exitSchedCritical(primask);
+
+	return !was_locked;
+}
+
+/**
+ * Allow deferred tasks to run again, running any that were posted while
+ *  locked.
+ *
+ * \return None.
+ */
+void unlockDeferredTasks(void) {
+	deferredLocked = false;
+
+	if (readyTasks[TASK_CTX_DEFERRED]) {
+		SCB->ICSR = SCB_ICSR_PENDSVSET_Msk;
+	}
+}
+
+/**
+ * Run thread tasks forever, sleeping whenever none have events.
+ *
+ * \return Never returns.
+ */
+void runSched(void) {
+	while (1) {
+		// Interrupts are disabled while checking for events so an event
+		//  posted right after the check still wakes WFI
+		__disable_irq();
+		if (!readyTasks[TASK_CTX_THREAD]) {
+			__WFI();
+		}
+		__enable_irq();
+
+		watchdogCheckIn(WDOG_CLIENT_THREAD);
+
+		runReadyTasks(TASK_CTX_THREAD);
+	}
+}
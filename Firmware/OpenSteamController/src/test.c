@@ -29,6 +29,8 @@
 #include "test.h"
 
 #include "usb.h"
+#include "time.h"
+#include "watchdog.h"
 
 #include <stdint.h>
 #include <stdlib.h>
@@ -95,14 +97,306 @@ int testPrintCmdFnc(int argc, const char* argv[]) {
 	return 0;
 }
 
-//TODO
+static const uint32_t TEST_PATTERN_SEED = 0x2545f491; //!< Seed for pattern
+	//!< used to check data integrity. Host scripts in Firmware/tests use the
+	//!< same seed.
+static const uint32_t TEST_USB_TIMEOUT_US = 1000000; //!< How long to wait for
+	//!< host before giving up on a test.
+static const uint32_t TEST_ECHO_BIN0_US = 125; //!< Upper edge of first round
+	//!< trip latency histogram bin. Each following bin is twice as wide.
+#define TEST_ECHO_NUM_BINS (9) //!< Number of round trip latency histogram 
+	//!< bins. Last bin holds everything larger.
+
+/**
+ * Generate next byte of pseudo random pattern used to check data integrity
+ *  (xorshift32). Any dropped, repeated or corrupted byte breaks the sequence.
+ *
+ * \param[inout] state Pattern state. Start with TEST_PATTERN_SEED.
+ *
+ * \return Next byte of pattern.
+ */
+static uint8_t nextTestByte(uint32_t* state) {
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+
+	return x & 0xff;
+}
+
+/**
+ * Calculate rate at which data was transferred.
+ *
+ * \param numBytes Number of bytes transferred.
+ * \param elapsedUs Microseconds it took.
+ *
+ * \return Bytes per second.
+ */
+static uint32_t getBytesPerSec(uint32_t numBytes, uint32_t elapsedUs) {
+	if (!elapsedUs) {
+		return 0;
+	}
+
+	return (uint64_t)numBytes * 1000000 / elapsedUs;
+}
+
+/**
+ * Receive pattern from host as fast as it can be sent and check that every 
+ *  byte arrived intact and in order. 
+ *
+ * \param numBytes Number of bytes host will send.
+ *
+ * \return 0 if all bytes were received correctly.
+ */
+static int testUsbRx(uint32_t numBytes) {
+	char buff[64];
+	uint32_t state = TEST_PATTERN_SEED;
+	uint32_t cnt = 0;
+	uint32_t num_errs = 0;
+	uint32_t first_err_idx = 0;
+	uint32_t start_cnt = 0;
+	uint32_t start_us = 0;
+
+	printf("Ready for %u bytes.\n", numBytes);
+	usb_flush();
+
+	while (cnt < numBytes) {
+		uint32_t len = numBytes - cnt;
+		if (len > sizeof(buff)) {
+			len = sizeof(buff);
+		}
+
+		uint32_t num_rcvd = usb_getb(buff, len, TEST_USB_TIMEOUT_US);
+		for (int idx = 0; idx < num_rcvd; idx++) {
+			if ((uint8_t)buff[idx] != nextTestByte(&state)) {
+				if (!num_errs) {
+					first_err_idx = cnt + idx;
+				}
+				num_errs++;
+			}
+		}
+
+		// Time from first data, so host reaction time does not count
+		if (!cnt) {
+			start_cnt = num_rcvd;
+			start_us = getUsTickCnt();
+		}
+		cnt += num_rcvd;
+
+		if (num_rcvd < len) {
+			break;
+		}
+
+		// Data can keep us busy without ever waiting
+		watchdogCheckIn(WDOG_CLIENT_THREAD);
+	}
+
+	uint32_t elapsed_us = getUsTickCnt() - start_us;
+
+	printf("Received %u/%u bytes in %u us (%u B/s). %u errors", cnt, 
+		numBytes, elapsed_us, getBytesPerSec(cnt - start_cnt, elapsed_us),
+		num_errs);
+	if (num_errs) {
+		printf(" (first at byte %u)", first_err_idx);
+	}
+	printf(".\n");
+
+	if (cnt != numBytes || num_errs) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Stream pattern to host as fast as USB allows. Host checks every byte 
+ *  arrived intact and in order.
+ *
+ * \param numBytes Number of bytes to send.
+ *
+ * \return 0 on success.
+ */
+static int testUsbTx(uint32_t numBytes) {
+	char buff[64];
+	uint32_t state = TEST_PATTERN_SEED;
+
+	printf("Sending %u bytes.\n", numBytes);
+	usb_flush();
+
+	uint32_t start_us = getUsTickCnt();
+
+	for (uint32_t cnt = 0; cnt < numBytes; cnt += sizeof(buff)) {
+		uint32_t len = numBytes - cnt;
+		if (len > sizeof(buff)) {
+			len = sizeof(buff);
+		}
+
+		for (int idx = 0; idx < len; idx++) {
+			buff[idx] = nextTestByte(&state);
+		}
+		usb_putb(buff, len);
+
+		// Host reading as fast as we send means we may never wait
+		watchdogCheckIn(WDOG_CLIENT_THREAD);
+	}
+	usb_flush();
+
+	uint32_t elapsed_us = getUsTickCnt() - start_us;
+
+	printf("Sent %u bytes in %u us (%u B/s).\n", numBytes, elapsed_us,
+		getBytesPerSec(numBytes, elapsed_us));
+
+	return 0;
+}
+
+/**
+ * Send pattern to host, which sends it straight back, and measure the round
+ *  trip time. 
+ *
+ * \param numPings Number of round trips.
+ * \param numBytes Number of bytes in each ping. At most one packet.
+ *
+ * \return 0 if all pings came back intact.
+ */
+static int testUsbEcho(uint32_t numPings, uint32_t numBytes) {
+	char tx_buff[64];
+	char rx_buff[64];
+	uint32_t state = TEST_PATTERN_SEED;
+	uint32_t hist[TEST_ECHO_NUM_BINS];
+	uint32_t num_done = 0;
+	uint32_t num_errs = 0;
+	uint32_t min_us = 0xFFFFFFFF;
+	uint32_t max_us = 0;
+	uint64_t total_us = 0;
+
+	if (!numBytes || numBytes > sizeof(tx_buff)) {
+		printf("numBytes must be in range 1 to %d\n", sizeof(tx_buff));
+		return -1;
+	}
+
+	memset(hist, 0, sizeof(hist));
+
+	printf("Echo %u pings of %u bytes.\n", numPings, numBytes);
+	usb_flush();
+
+	for (num_done = 0; num_done < numPings; num_done++) {
+		for (int idx = 0; idx < numBytes; idx++) {
+			tx_buff[idx] = nextTestByte(&state);
+		}
+
+		uint32_t start_us = getUsTickCnt();
+		usb_putb(tx_buff, numBytes);
+		usb_flush();
+		uint32_t num_rcvd = usb_getb(rx_buff, numBytes, 
+			TEST_USB_TIMEOUT_US);
+		uint32_t rtt_us = getUsTickCnt() - start_us;
+
+		if (num_rcvd != numBytes) {
+			break;
+		}
+		if (memcmp(tx_buff, rx_buff, numBytes)) {
+			num_errs++;
+		}
+
+		int bin = 0;
+		while (bin < TEST_ECHO_NUM_BINS - 1 && 
+			rtt_us >= TEST_ECHO_BIN0_US << bin) {
+			bin++;
+		}
+		hist[bin]++;
+
+		if (rtt_us < min_us) {
+			min_us = rtt_us;
+		}
+		if (rtt_us > max_us) {
+			max_us = rtt_us;
+		}
+		total_us += rtt_us;
+	}
+
+	printf("Echoed %u/%u pings. %u errors.\n", num_done, numPings, 
+		num_errs);
+	if (num_done) {
+		printf("Round trip us: min %u avg %u max %u\n", min_us,
+			(uint32_t)(total_us / num_done), max_us);
+		for (int bin = 0; bin < TEST_ECHO_NUM_BINS - 1; bin++) {
+			printf("  < %6u us: %u\n", TEST_ECHO_BIN0_US << bin, 
+				hist[bin]);
+		}
+		printf("  >=%6u us: %u\n", TEST_ECHO_BIN0_US << 
+			(TEST_ECHO_NUM_BINS - 2), hist[TEST_ECHO_NUM_BINS - 1]);
+	}
+
+	if (num_done != numPings || num_errs) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * Prints details to console regarding how to use the test command line
+ *  function.
+ *
+ * \return None.
+ */
 void testCmdUsage(void) {
 	printf(
-		"usage: test ??? (WIP)\n"
+		"usage: test usb tx {numBytes}\n"
+		"       test usb rx {numBytes}\n"
+		"       test usb echo {numPings} {numBytes}\n"
+		"\n"
+		"USB CDC benchmarks. See Firmware/tests/usb_cdc_test.py\n"
+		"usb tx = Send numBytes of test pattern as fast as possible\n"
+		"usb rx = After \"Ready\" is printed, receive numBytes of\n"
+		"	test pattern as fast as host sends it and check it\n"
+		"	arrived intact\n"
+		"usb echo = Send numPings pings of numBytes (max 64) which\n"
+		"	host echoes back. Prints round trip latency histogram\n"
 	);
 }
-//TODO
+
+/**
+ * Handle test command line function.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
+ */
 int testCmdFnc(int argc, const char* argv[]) { 
+	if (argc < 3 || strcmp("usb", argv[1])) {
+		testCmdUsage();
+		return -1;
+	}
+
+	if (!strcmp("rx", argv[2])) {
+		if (argc != 4) {
+			testCmdUsage();
+			return -1;
+		}
+
+		return testUsbRx(strtoul(argv[3], NULL, 0));
+	} else if (!strcmp("tx", argv[2])) {
+		if (argc != 4) {
+			testCmdUsage();
+			return -1;
+		}
+
+		return testUsbTx(strtoul(argv[3], NULL, 0));
+	} else if (!strcmp("echo", argv[2])) {
+		if (argc != 5) {
+			testCmdUsage();
+			return -1;
+		}
+
+		return testUsbEcho(strtoul(argv[3], NULL, 0), 
+			strtoul(argv[4], NULL, 0));
+	}
+
+	testCmdUsage();
 	return -1;
 }
 
@@ -28,8 +28,217 @@
  */
 
 #include "time.h"
+#include "watchdog.h"
 
-#include "haptic.h"
+#include "lpc_types.h"
+#include "chip.h"
+#include "timer_11xx.h"
+
+#include <stddef.h>
+
+static LPC_TIMER_T* timeTimer = LPC_TIMER32_1; //!< Free running timer that
+	//!< increments every microsecond. Used for all time services and software
+	//!< timers.
+
+static const uint8_t DEADLINE_MR = 0; //!< MR used to generate an interrupt at
+	//!< the earliest software timer deadline.
+
+#define WHEEL_SLOT_SHIFT (10) //!< Each timer wheel slot covers 2^10 us.
+#define NUM_WHEEL_SLOTS (16) //!< Number of timer wheel slots. Must be a power
+	//!< of two.
+
+static uint32_t usTickCntHi; //!< Upper 32 bits of 64-bit microsecond count.
+static uint32_t usTickCntLastLo; //!< Timer count at last getUsTickCnt64() 
+	//!< call. Used to detect timer wrap.
+static SwTimer wrapTimer; //!< Makes sure getUsTickCnt64() is called more 
+	//!< than once per timer wrap, so that no wrap is missed.
+static const uint32_t WRAP_CHECK_PERIOD_US = 1 << 30; //!< How often 
+	//!< wrapTimer fires. Well under the 2^32 us timer wrap.
+
+static SwTimer* timerWheel[NUM_WHEEL_SLOTS]; //!< Active software timers. A 
+	//!< timer goes in the slot selected by its deadline and each slot is 
+	//!< sorted by deadline, so only the head of each slot is ever checked for
+	//!< expiration. Deadlines further out than the wheel covers simply share
+	//!< slots with nearer ones.
+
+/**
+ * Disable interrupts, keeping track of whether they were already disabled so
+ *  that this can be called from any context.
+ *
+ * \return Value to pass to exitTimeCritical().
+ */
+inline static uint32_t enterTimeCritical(void) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	return primask;
+}
+
+/**
+ * Restore interrupts to state before enterTimeCritical().
+ *
+ * \param primask Value returned by enterTimeCritical().
+ *
+ * \return None.
+ */
+inline static void exitTimeCritical(uint32_t primask) {
+	__set_PRIMASK(primask);
+}
+
+/**
+ * \param deadline Absolute getUsTickCnt() value.
+ * \param now Current getUsTickCnt() value.
+ *
+ * \return True if deadline has been reached. Signed difference keeps this 
+ *	correct across timer wrap.
+ */
+inline static bool deadlineReached(uint32_t deadline, uint32_t now) {
+	return (int32_t)(now - deadline) >= 0;
+}
+
+/**
+ * \param deadline Absolute getUsTickCnt() value.
+ *
+ * \return Pointer to head of timer wheel slot list for deadline.
+ */
+inline static SwTimer** getWheelSlot(uint32_t deadline) {
+	return &timerWheel[(deadline >> WHEEL_SLOT_SHIFT) & 
+		(NUM_WHEEL_SLOTS - 1)];
+}
+
+/**
+ * Add timer to timer wheel. Must be called with interrupts disabled.
+ *
+ * \param[in] timer Timer with deadline already set.
+ *
+ * \return None.
+ */
+static void insertSwTimer(SwTimer* timer) {
+	SwTimer** link = getWheelSlot(timer->deadline);
+
+	// Timers with the same deadline expire in the order they were started
+	while (*link && (int32_t)((*link)->deadline - timer->deadline) <= 0) {
+		link = &(*link)->next;
+	}
+
+	timer->next = *link;
+	*link = timer;
+	timer->active = true;
+}
+
+/**
+ * Remove timer from timer wheel. Must be called with interrupts disabled.
+ *
+ * \param[in] timer Active timer.
+ *
+ * \return None.
+ */
+static void removeSwTimer(SwTimer* timer) {
+	SwTimer** link = getWheelSlot(timer->deadline);
+
+	while (*link && *link != timer) {
+		link = &(*link)->next;
+	}
+
+	if (*link) {
+		*link = timer->next;
+	}
+	timer->next = NULL;
+	timer->active = false;
+}
+
+/**
+ * Program match register for the earliest deadline in the timer wheel, or 
+ *  disable the interrupt if there are no active timers. Nothing fires between
+ *  deadlines. Must be called with interrupts disabled.
+ *
+ * \return None.
+ */
+static void programNextDeadline(void) {
+	uint32_t now = Chip_TIMER_ReadCount(timeTimer);
+	SwTimer* earliest = NULL;
+
+	for (int slot = 0; slot < NUM_WHEEL_SLOTS; slot++) {
+		SwTimer* head = timerWheel[slot];
+		if (head && (!earliest || (int32_t)(head->deadline - now) < 
+			(int32_t)(earliest->deadline - now))) {
+			earliest = head;
+		}
+	}
+
+	if (!earliest) {
+		Chip_TIMER_MatchDisableInt(timeTimer, DEADLINE_MR);
+		return;
+	}
+
+	timeTimer->MR[DEADLINE_MR] = earliest->deadline;
+	Chip_TIMER_MatchEnableInt(timeTimer, DEADLINE_MR);
+
+	// A deadline that has already passed will not match until the timer
+	//  wraps, so make sure IRQ fires for it now
+	if (deadlineReached(earliest->deadline, 
+		Chip_TIMER_ReadCount(timeTimer))) {
+		NVIC_SetPendingIRQ(TIMER_32_1_IRQn);
+	}
+}
+
+/**
+ * Interrupt handler for CT32B1. Expires all software timers whose deadline has
+ *  been reached and then programs the next deadline.
+ *
+ * \return None.
+ */
+void TIMER32_1_IRQHandler(void) {
+	Chip_TIMER_ClearMatch(timeTimer, DEADLINE_MR);
+
+	for (int slot = 0; slot < NUM_WHEEL_SLOTS; slot++) {
+		while (1) {
+			uint32_t primask = enterTimeCritical();
+			uint32_t now = Chip_TIMER_ReadCount(timeTimer);
+			SwTimer* timer = timerWheel[slot];
+			if (!timer || !deadlineReached(timer->deadline, now)) {
+				exitTimeCritical(primask);
+				break;
+			}
+
+			timerWheel[slot] = timer->next;
+			timer->next = NULL;
+			timer->active = false;
+			timer->expired = true;
+
+			// Periodic timers are put back before callback so that
+			//  callback is free to stop them
+			if (timer->period) {
+				timer->deadline += timer->period;
+				if (deadlineReached(timer->deadline, now)) {
+					// Fell behind, skip missed periods
+					timer->deadline = now + timer->period;
+				}
+				insertSwTimer(timer);
+			}
+			exitTimeCritical(primask);
+
+			if (timer->callback) {
+				timer->callback(timer->ctx);
+			}
+		}
+	}
+
+	uint32_t primask = enterTimeCritical();
+	programNextDeadline();
+	exitTimeCritical(primask);
+}
+
+/**
+ * Software timer callback that keeps 64-bit microsecond count from missing a
+ *  timer wrap when nothing else is asking for it.
+ *
+ * \param[in] ctx Not used.
+ *
+ * \return None.
+ */
+static void wrapTimerCallback(void* ctx) {
+	getUsTickCnt64();
+}
 
 /**
  * Any initialization related to time functions.
@@ -37,30 +246,260 @@
  * \return None.
  */
 void initTime(void) {
-	// Make sure haptics are initialized as we are using their time 
-	//  functions (for now at least)
-	initHaptics();
+	Chip_TIMER_Init(timeTimer);
+
+	// Set the timer to increment every microsecond
+	Chip_TIMER_PrescaleSet(timeTimer, SystemCoreClock/1000000-1);
+
+	// Below haptic timer, as software timer callbacks are not as time 
+	//  critical as haptic GPIO edges
+	NVIC_SetPriority(TIMER_32_1_IRQn, 1);
+	NVIC_ClearPendingIRQ(TIMER_32_1_IRQn);
+	NVIC_EnableIRQ(TIMER_32_1_IRQn);
+
+	Chip_TIMER_Enable(timeTimer);
+
+	initSwTimer(&wrapTimer, wrapTimerCallback, NULL);
+	startSwTimer(&wrapTimer, WRAP_CHECK_PERIOD_US, WRAP_CHECK_PERIOD_US);
 }
 
 /**
  * Sleep for the specific number of microseconds.
+ *
+ * When called from an ISR this spins on the timer count instead, as Timer IRQ
+ *  (which would mark expiration) may not be able to preempt the caller (i.e.
+ *  USB and SSP0 IRQs share its priority).
  * 
  * \param usec The number of microseconds to sleep for.
  * 
  * \return None.
  */
 void usleep(uint32_t usec) {
-	// Share timer used by haptics
-	usleepHaptic(usec);
+	if (__get_IPSR() != 0) {
+		uint32_t start = Chip_TIMER_ReadCount(timeTimer);
+		while (Chip_TIMER_ReadCount(timeTimer) - start < usec);
+		return;
+	}
+
+	// Timer is removed from wheel on expiration, so it is safe on the stack
+	SwTimer timer;
+	initSwTimer(&timer, NULL, NULL);
+	startSwTimer(&timer, usec, 0);
+
+	while (!timer.expired) {
+		__WFI();
+		watchdogCheckIn(WDOG_CLIENT_THREAD);
+	}
 }
 
 /**
  * Get the current value of a timer running with usec precision.
+ *
+ * Note: This wraps every 2^32 us (~71 minutes). Use getUsTickCnt64() for
+ *	timestamps that need to be compared over longer periods.
  * 
  * \return The count value for a timer configured where the count increments
  *	each usec. 
  */
 uint32_t getUsTickCnt(void) {
-	// Share timer used by haptics
-	return getUsTickCntHaptic();
+	return Chip_TIMER_ReadCount(timeTimer);
+}
+
+/**
+ * Get number of microseconds since time services were initialized. This does
+ *  not wrap (for ~584000 years) and is cheap enough to call from any ISR.
+ *
+ * \return 64-bit microsecond count.
+ */
+uint64_t getUsTickCnt64(void) {
+	// Interrupts are disabled so that the wrap check and count update
+	//  are atomic no matter which context calls this
+	uint32_t primask = enterTimeCritical();
+
+	uint32_t lo = Chip_TIMER_ReadCount(timeTimer);
+	if (lo < usTickCntLastLo) {
+		usTickCntHi++;
+	}
+	usTickCntLastLo = lo;
+	uint32_t hi = usTickCntHi;
+
+	exitTimeCritical(primask);
+
+	return ((uint64_t)hi << 32) | lo;
+}
+
+/**
+ * Wait until a condition is met, sleeping (via WFI) in between interrupts. 
+ *  The condition is expected to be changed by an ISR, so it is only checked
+ *  after each interrupt.
+ *
+ * When called from an ISR or task running in PendSV this spins instead of 
+ *  sleeping, as the interrupt that would wake WFI may not be able to preempt
+ *  the caller. The timeout is then checked against the timer count directly,
+ *  rather than relying on Timer IRQ, so it still works from ISRs at or above
+ *  Timer IRQ priority. cond still has to be changed by something that can 
+ *  preempt the caller, or it is only ever met by timing out.
+ *
+ * \param cond Function that returns true once condition is met.
+ * \param[in] ctx Passed to cond.
+ * \param timeoutUs Number of microseconds to wait before giving up. Must be 
+ *	less than 2^31 or WAIT_FOREVER.
+ *
+ * \return 0 if condition was met. -1 on timeout.
+ */
+int waitUntil(WaitCond cond, void* ctx, uint32_t timeoutUs) {
+	uint32_t start = Chip_TIMER_ReadCount(timeTimer);
+	bool timed = (timeoutUs != WAIT_FOREVER);
+	bool in_isr = (__get_IPSR() != 0);
+	int retval = 0;
+
+	// Timer only exists to make sure WFI wakes up for timeout
+	SwTimer timer;
+	if (timed && !in_isr) {
+		initSwTimer(&timer, NULL, NULL);
+		startSwTimer(&timer, timeoutUs, 0);
+	}
+
+	while (1) {
+		// Interrupts are disabled between checking condition and WFI so
+		//  that an interrupt that changes condition in between still 
+		//  wakes WFI. It then runs once interrupts are enabled again
+		uint32_t primask = enterTimeCritical();
+
+		if (cond(ctx)) {
+			exitTimeCritical(primask);
+			break;
+		}
+
+		if (timed && Chip_TIMER_ReadCount(timeTimer) - start >= 
+			timeoutUs) {
+			exitTimeCritical(primask);
+			retval = -1;
+			break;
+		}
+
+		if (!in_isr) {
+			__WFI();
+			watchdogCheckIn(WDOG_CLIENT_THREAD);
+		}
+
+		exitTimeCritical(primask);
+	}
+
+	if (timed && !in_isr) {
+		stopSwTimer(&timer);
+	}
+
+	return retval;
+}
+
+/**
+ * WaitCond for waitForFlag().
+ *
+ * \param[in] ctx Points to volatile bool flag.
+ *
+ * \return Value of flag.
+ */
+static bool flagSet(void* ctx) {
+	return *(volatile bool*)ctx;
+}
+
+/**
+ * Wait (see waitUntil()) for a flag to be set by an ISR.
+ *
+ * \param[in] flag Flag to wait on.
+ * \param timeoutUs Number of microseconds to wait before giving up, or 
+ *	WAIT_FOREVER.
+ *
+ * \return 0 if flag was set. -1 on timeout.
+ */
+int waitForFlag(volatile bool* flag, uint32_t timeoutUs) {
+	return waitUntil(flagSet, (void*)flag, timeoutUs);
+}
+
+/**
+ * Initialize a software timer. Must be called before any other software timer
+ *  function is used on timer.
+ *
+ * \param[out] timer Timer to initialize.
+ * \param callback Function to call from Timer IRQ when timer expires. May be
+ *	NULL if only the expired flag is needed (see swTimerExpired()).
+ * \param[in] ctx Passed to callback.
+ *
+ * \return None.
+ */
+void initSwTimer(SwTimer* timer, SwTimerCallback callback, void* ctx) {
+	timer->next = NULL;
+	timer->deadline = 0;
+	timer->period = 0;
+	timer->callback = callback;
+	timer->ctx = ctx;
+	timer->active = false;
+	timer->expired = false;
+}
+
+/**
+ * Start (or restart) a software timer. Safe to call from any context, 
+ *  including software timer callbacks.
+ *
+ * \param[in,out] timer Initialized timer. Must persist until it expires (if
+ *	one-shot) or is stopped.
+ * \param delayUs Number of microseconds until first expiration. Must be less
+ *	than 2^31.
+ * \param periodUs Number of microseconds between following expirations. 0 for
+ *	a one-shot timer.
+ *
+ * \return None.
+ */
+void startSwTimer(SwTimer* timer, uint32_t delayUs, uint32_t periodUs) {
+	uint32_t primask = enterTimeCritical();
+
+	if (timer->active) {
+		removeSwTimer(timer);
+	}
+
+	timer->deadline = Chip_TIMER_ReadCount(timeTimer) + delayUs;
+	timer->period = periodUs;
+	timer->expired = false;
+	insertSwTimer(timer);
+
+	programNextDeadline();
+
+	exitTimeCritical(primask);
+}
+
+/**
+ * Stop a software timer. The timer's callback will not be called after this 
+ *  returns (unless it is already executing). Safe to call from any context.
+ *
+ * \param[in,out] timer Initialized timer.
+ *
+ * \return None.
+ */
+void stopSwTimer(SwTimer* timer) {
+	uint32_t primask = enterTimeCritical();
+
+	if (timer->active) {
+		removeSwTimer(timer);
+		programNextDeadline();
+	}
+
+	exitTimeCritical(primask);
+}
+
+/**
+ * Check and clear expired flag of a software timer.
+ *
+ * \param[in,out] timer Initialized timer.
+ *
+ * \return True if timer has expired since it was started or this was last
+ *	called.
+ */
+bool swTimerExpired(SwTimer* timer) {
+	uint32_t primask = enterTimeCritical();
+	bool expired = timer->expired;
+	timer->expired = false;
+	exitTimeCritical(primask);
+
+	return expired;
 }
@@ -0,0 +1,205 @@
+/**
+ * \file trace.c
+ * \brief Cheap binary trace logging for hot paths and ISRs. Records hold only
+ *	a format string address, timestamp and a few arguments. Formatting is 
+ *	done on the host by Firmware/tests/trace_decode.py using the ELF.
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "trace.h"
+
+#include "time.h"
+#include "usb.h"
+
+#include "chip.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#if (TRACE_NUM_RECS & (TRACE_NUM_RECS - 1))
+#error "TRACE_NUM_RECS must be a power of two"
+#endif
+
+#define SYSTICK_MAX (0xFFFFFF) //!< SysTick is a 24-bit down counter.
+
+static const uint32_t TRACE_BENCH_RECS = 64; //!< Number of records logged
+	//!< by "trace bench".
+
+/**
+ * Single trace record. Dumped as is, one hex word per field.
+ */
+typedef struct TraceRec {
+	const char* fmt; //!< Format string. Address is looked up in ELF by host.
+	uint32_t timestamp; //!< getUsTickCnt() when record was logged.
+	uint32_t args[TRACE_MAX_ARGS]; //!< Arguments for fmt. Unused are 0.
+} TraceRec;
+
+#if (TRACE_NUM_RECS)
+static TraceRec traceRecs[TRACE_NUM_RECS]; //!< Ring of most recent records.
+#endif
+static volatile uint32_t traceWrIdx; //!< Free running count of records 
+	//!< logged. Masked to index traceRecs.
+static uint32_t traceRdIdx; //!< Free running index of next record to dump.
+
+/**
+ * Log a trace record, overwriting the oldest if the ring is full. Callable 
+ *  from any context. Use TRACE0()...TRACE3() rather than calling directly, so
+ *  that tracing can be compiled out.
+ *
+ * \param fmt printf style format string. Must stay valid for life of 
+ *	firmware (i.e. string literal), as only its address is logged.
+ * \param arg0 First argument for fmt.
+ * \param arg1 Second argument for fmt.
+ * \param arg2 Third argument for fmt.
+ *
+ * \return None.
+ */
+void traceRec(const char* fmt, uint32_t arg0, uint32_t arg1, uint32_t arg2) {
+#if (TRACE_NUM_RECS)
+	// Interrupts are only held off for a handful of stores, so this is 
+	//  cheaper than selectively masking lines via enterIrqMask()
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+
+	TraceRec* rec = &traceRecs[traceWrIdx++ & (TRACE_NUM_RECS - 1)];
+	rec->fmt = fmt;
+	rec->timestamp = getUsTickCnt();
+	rec->args[0] = arg0;
+	rec->args[1] = arg1;
+	rec->args[2] = arg2;
+
+	__set_PRIMASK(primask);
+#endif
+}
+
+/**
+ * Print records logged since last dump (or as many of them as are still in the
+ *  ring), oldest first, one record per line as hex words. 
+ *
+ * \return None.
+ */
+static void dumpTrace(void) {
+	uint32_t wr_idx = traceWrIdx;
+	uint32_t lost = 0;
+
+	if (wr_idx - traceRdIdx > TRACE_NUM_RECS) {
+		lost = wr_idx - traceRdIdx - TRACE_NUM_RECS;
+		traceRdIdx = wr_idx - TRACE_NUM_RECS;
+	}
+
+	printf("Trace dump: %u records (%u overwritten).\n", wr_idx - traceRdIdx,
+		lost);
+
+#if (TRACE_NUM_RECS)
+	for (; traceRdIdx != wr_idx; traceRdIdx++) {
+		TraceRec rec;
+
+		// Copy atomically and make sure record was not overwritten while 
+		//  previous ones were being printed
+		uint32_t primask = __get_PRIMASK();
+		__disable_irq();
+		memcpy(&rec, &traceRecs[traceRdIdx & (TRACE_NUM_RECS - 1)], 
+			sizeof(rec));
+		bool valid = traceWrIdx - traceRdIdx <= TRACE_NUM_RECS;
+		__set_PRIMASK(primask);
+
+		if (!valid) {
+			continue;
+		}
+
+		printf("%08x %08x %08x %08x %08x\n", (uint32_t)rec.fmt, 
+			rec.timestamp, rec.args[0], rec.args[1], rec.args[2]);
+	}
+#endif
+
+	printf("Trace dump end.\n");
+	usb_flush();
+}
+
+/**
+ * Log a burst of records to measure cost of logging.
+ *
+ * \return None.
+ */
+static void benchTrace(void) {
+	uint32_t start = SysTick->VAL;
+	for (uint32_t cnt = 0; cnt < TRACE_BENCH_RECS; cnt++) {
+		TRACE3("trace bench %u of %u (%u)", cnt, TRACE_BENCH_RECS, start);
+	}
+	uint32_t ticks = (start - SysTick->VAL) & SYSTICK_MAX;
+
+	printf("Logged %u records in %u clks (%u clks per record).\n", 
+		TRACE_BENCH_RECS, ticks, ticks / TRACE_BENCH_RECS);
+}
+
+/**
+ * Print command usage details to console.
+ *
+ * \return None.
+ */
+void traceCmdUsage(void) {
+	printf(
+		"usage: trace [dump|clear|bench]\n"
+		"\n"
+		"With no arguments print number of records logged via TRACE*().\n"
+		"dump = print records logged since last dump as hex words. Decode\n"
+		"\twith Firmware/tests/trace_decode.py and the matching ELF.\n"
+		"clear = discard all records logged so far.\n"
+		"bench = log some records and print cost of logging.\n"
+	);
+}
+
+/**
+ * Handle trace command line function.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
+ */
+int traceCmdFnc(int argc, const char* argv[]) {
+	if (argc == 1) {
+		uint32_t wr_idx = traceWrIdx;
+		printf("%u records logged. %u not yet dumped. Ring holds %u.\n",
+			wr_idx, wr_idx - traceRdIdx, TRACE_NUM_RECS);
+		return 0;
+	} else if (argc != 2) {
+		traceCmdUsage();
+		return -1;
+	}
+
+	if (!strcmp(argv[1], "dump")) {
+		dumpTrace();
+	} else if (!strcmp(argv[1], "clear")) {
+		traceRdIdx = traceWrIdx;
+	} else if (!strcmp(argv[1], "bench")) {
+		benchTrace();
+	} else {
+		traceCmdUsage();
+		return -1;
+	}
+
+	return 0;
+}
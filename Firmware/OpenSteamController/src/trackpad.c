@@ -33,6 +33,9 @@
 #include "time.h"
 #include "usb.h"
 #include "eeprom_access.h"
+#include "haptic_feedback.h"
+#include "watchdog.h"
+#include "irq_mask.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -112,6 +115,25 @@ static volatile int16_t tpadAdcDatas[2][NUM_ANYMEAS_ADCS]; //!< The ADC
 static volatile int tpadAdcIdxs[2]; //!< Tracks how tpadAdcDatas is being
 	//!< updated. If this is NUM_ANYMEAS_ADCS, it means tpadAdcDatas
 	//!< are all safe to be read.
+static volatile bool tpadCompsValid[2]; //!< Set once tpadAdcComps have been
+	//!< computed and X/Y locations can be calculated.
+static volatile uint16_t tpadXLocs[2] = {TPAD_MAX_X/2, TPAD_MAX_X/2}; //!< 
+	//!< X location calculated at the end of the last AnyMeas ADC update.
+static volatile uint16_t tpadYLocs[2] = {TPAD_MAX_Y/2, TPAD_MAX_Y/2}; //!<
+	//!< Y location calculated at the end of the last AnyMeas ADC update.
+static uint64_t tpadAdcTimestamps[2]; //!< getUsTickCnt64() value when last 
+	//!< AnyMeas ADC value of a frame was received.
+static volatile uint64_t tpadLocTimestamps[2]; //!< Capture time of tpadXLocs
+	//!< and tpadYLocs.
+static volatile bool tpadLocReady[2] = {true, true}; //!< Set by trackpad task
+	//!< once tpadXLocs and tpadYLocs reflect the last requested update.
+
+static const uint32_t TPAD_TIMEOUT_US = 50000; //!< How long to wait for an 
+	//!< AnyMeas update before assuming Trackpad ASIC is wedged.
+
+static Task tpadNotifyTasks[2] = {NUM_TASKS, NUM_TASKS}; //!< Task to post 
+	//!< to when a trackpad location is updated. NUM_TASKS for none.
+static uint32_t tpadNotifyEvents[2]; //!< Events to post to tpadNotifyTasks.
 
 
 #endif // ANYMEAS_EN
@@ -268,10 +290,10 @@ static void writeTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val) {
 	uint8_t tx_data[2];
 	uint8_t rx_data[2];
 
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
+	// Need to mask everything else that uses SPI bus so we do not get 
+	//  interrupted during SPI transaction and have multiple nCS pulled low
+	//  or corrupt message being sent
+	IrqMaskState irq_state = enterIrqMask(IRQ_MASK_TPAD);
 
 	if (R_TRACKPAD == trackpad) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
@@ -300,7 +322,7 @@ static void writeTpadReg(Trackpad trackpad, uint8_t addr, uint8_t val) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
 	}
 
-	__enable_irq();
+	exitIrqMask(irq_state);
 }
 
 /**
@@ -316,10 +338,10 @@ static uint8_t readTpadReg(Trackpad trackpad, uint8_t addr) {
 	uint8_t tx_data[4];
 	uint8_t rx_data[4];
 
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
+	// Need to mask everything else that uses SPI bus so we do not get 
+	//  interrupted during SPI transaction and have multiple nCS pulled low
+	//  or corrupt message being sent
+	IrqMaskState irq_state = enterIrqMask(IRQ_MASK_TPAD);
 
 	if (R_TRACKPAD == trackpad) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
@@ -351,7 +373,7 @@ static uint8_t readTpadReg(Trackpad trackpad, uint8_t addr) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
 	}
 
-	__enable_irq();
+	exitIrqMask(irq_state);
 
 	return rx_data[3];
 }
@@ -381,8 +403,10 @@ static void writeTpadExtRegs(Trackpad trackpad, uint16_t addr, uint8_t len,
 		writeTpadReg(trackpad, TPAD_ERA_CTRL_ADDR, 0x0A);
 
 		// Read ERA Control until it contains 0x00
+		WdogMarker prev_mark = watchdogMark(WDOG_MARK_TPAD_ERA);
 		while (readTpadReg(trackpad, TPAD_ERA_CTRL_ADDR)){
 		}
+		watchdogMark(prev_mark);
 	}
 }
 
@@ -441,9 +465,11 @@ static void setupTpad(Trackpad trackpad) {
 
 	usleep(50 * 1000);
 
+	watchdogMark(WDOG_MARK_TPAD_CC);
 	while (!(TPAD_STATUS1_CC_BIT & readTpadReg(trackpad, 
 		TPAD_STATUS1_ADDR))) {
 	}
+	watchdogMark(WDOG_MARK_TPAD_SETUP);
 
 	clearTpadFlags(trackpad);
 
@@ -490,10 +516,10 @@ void getAbsDataAndClr(Trackpad trackpad, volatile TrackpadAbsData* absData) {
 	uint8_t tx_data[11];
 	uint8_t rx_data[11];
 
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
+	// Need to mask everything else that uses SPI bus so we do not get 
+	//  interrupted during SPI transaction and have multiple nCS pulled low
+	//  or corrupt message being sent
+	IrqMaskState irq_state = enterIrqMask(IRQ_MASK_TPAD);
 
 	if (R_TRACKPAD == trackpad) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
@@ -532,7 +558,7 @@ void getAbsDataAndClr(Trackpad trackpad, volatile TrackpadAbsData* absData) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
 	}
 
-	__enable_irq();
+	exitIrqMask(irq_state);
 
 	absData->xPos = ((0x0F & rx_data[7]) << 8) | rx_data[5];
 	absData->yPos = ((0xF0 & rx_data[7]) << 4) | rx_data[6];
@@ -570,10 +596,10 @@ static int16_t getTpadAdcAndClr(Trackpad trackpad) {
 	uint8_t tx_data[7];
 	uint8_t rx_data[7];
 
-	// Need to disable IRQs so we do not get interrupted during SPI
-	//  transaction and have multiple nCS pulled low or corrupt message
-	//  being sent
-	__disable_irq();
+	// Need to mask everything else that uses SPI bus so we do not get 
+	//  interrupted during SPI transaction and have multiple nCS pulled low
+	//  or corrupt message being sent
+	IrqMaskState irq_state = enterIrqMask(IRQ_MASK_TPAD);
 
 	if (R_TRACKPAD == trackpad) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_R_TRACKPAD_CS_N, false);
@@ -608,7 +634,7 @@ static int16_t getTpadAdcAndClr(Trackpad trackpad) {
 		Chip_GPIO_WritePortBit(LPC_GPIO, GPIO_L_TRACKPAD_CS_N, true);
 	}
 
-	__enable_irq();
+	exitIrqMask(irq_state);
 
 	// Concatenate TPAD_MEASRESULT_HI_ADDR and TPAD_MEASRESULT_HI_ADDR into 
 	//  a single 16-bit word
@@ -837,6 +863,7 @@ static int32_t takeTpadAdcMeas(Trackpad trackpad, uint32_t toggle,
  * \return None.
  */
 void trackpadLocUpdate(Trackpad trackpad) {
+	tpadLocReady[trackpad] = false;
 	tpadAdcIdxs[trackpad] = 0;
 
 	// Start by requesting measurements for X axis location
@@ -849,9 +876,8 @@ void trackpadLocUpdate(Trackpad trackpad) {
 }
 
 /**
- * Convert the last updated AnyMeas ADC values to X/Y location. If update to
- *  AnyMeas ADC values has been requested (i.e. via trackpadLocUpdate()), this
- *  function will wait until data has been updated.
+ * Convert the AnyMeas ADC values to X/Y location. This must only be called
+ *  once all AnyMeas ADC values have been updated.
  * 
  * \param trackpad Specifies which Trackpad to communicate with. 
  * \param[out] xLoc X location. 0-1200. 0 is left side of Trackpad. 1200/2 will
@@ -859,18 +885,14 @@ void trackpadLocUpdate(Trackpad trackpad) {
  * \param[out] yLoc y location. 0-700. 0 is bottom side of Trackpad. 700/2 will
  *	be returned if finger is not down.
  *
- * \return None.
+ * \return True if a finger was detected as down.
  */
-void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
+static bool calcTpadXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
 
 	// Set defaults in case finger is not down
 	*xLoc = 1200/2;
 	*yLoc = 700/2;
 
-	// Wait for AnyMeas ADCs related to X position to be updated
-	while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_X_ADCS) {
-	}
-
 	// Calculate xLoc
 	int32_t adc_vals_x[12];
 
@@ -1125,13 +1147,9 @@ void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
 		}
 	}
 
-	// Wait for AnyMeas ADCs related to Y position to be updated
-	while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_ADCS) {
-	}
-
 	// Early exit if no finger down detected in X position calculation
 	if (x_pos < 0) {
-		return;
+		return false;
 	}
 
 	// Calculate yLoc
@@ -1283,9 +1301,118 @@ void trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
 	if (x_pos > 0 && y_pos > 0)  {
 		*xLoc = x_pos;
 		*yLoc = y_pos;
+		return true;
+	}
+
+	return false;
+}
+
+/**
+ * Get the X/Y location calculated from the last updated AnyMeas ADC values. If 
+ *  update to AnyMeas ADC values has been requested (i.e. via 
+ *  trackpadLocUpdate()), this function will wait until data has been updated.
+ *
+ * Note: Location is calculated by TASK_TPAD, which runs in PendSV and so 
+ *  cannot preempt an ISR or deferred task. Only thread context waits. From
+ *  handler mode the last location is returned right away (i.e. wait for the
+ *  trackpad update notification before calling this from a task).
+ * 
+ * \param trackpad Specifies which Trackpad to communicate with. 
+ * \param[out] xLoc X location. 0-1200. 0 is left side of Trackpad. 1200/2 will
+ *	be returned if finger is not down.
+ * \param[out] yLoc y location. 0-700. 0 is bottom side of Trackpad. 700/2 will
+ *	be returned if finger is not down.
+ *
+ * \return 0 on success. -1 if update did not complete in time, in which case
+ *	the previous location is returned.
+ */
+int trackpadGetLastXY(Trackpad trackpad, uint16_t* xLoc, uint16_t* yLoc) {
+	// Wait for AnyMeas ADCs to be updated (and converted to X/Y location)
+	int retval = 0;
+	if (__get_IPSR()) {
+		retval = tpadLocReady[trackpad] ? 0 : -1;
+	} else {
+		retval = waitForFlag(&tpadLocReady[trackpad], TPAD_TIMEOUT_US);
+	}
+
+	*xLoc = tpadXLocs[trackpad];
+	*yLoc = tpadYLocs[trackpad];
+
+	return retval;
+}
+
+/**
+ * Get the capture time of the location returned by trackpadGetLastXY(). If
+ *  update to AnyMeas ADC values has been requested (i.e. via 
+ *  trackpadLocUpdate()), this function will wait until data has been updated.
+ *  Only waits in thread context (see trackpadGetLastXY()).
+ * 
+ * \param trackpad Specifies which Trackpad to communicate with. 
+ *
+ * \return getUsTickCnt64() value when the last AnyMeas ADC value of the frame
+ *	was received. Capture time of previous frame if update did not complete in
+ *	time.
+ */
+uint64_t trackpadGetLastTimestamp(Trackpad trackpad) {
+	if (!__get_IPSR()) {
+		waitForFlag(&tpadLocReady[trackpad], TPAD_TIMEOUT_US);
+	}
+
+	return tpadLocTimestamps[trackpad];
+}
+
+/**
+ * Deferred task that converts AnyMeas ADC values to X/Y location once ISR has
+ *  gathered all of them. This keeps the long conversion out of the ISR.
+ *
+ * \param events Bit per Trackpad (i.e. 1 << R_TRACKPAD) that has new data.
+ *
+ * \return None.
+ */
+static void tpadTask(uint32_t events) {
+	for (int trackpad = R_TRACKPAD; trackpad <= L_TRACKPAD; trackpad++) {
+		if (!(events & (1 << trackpad))) {
+			continue;
+		}
+
+		// Locations cannot be calculated until calibration is complete
+		if (tpadCompsValid[trackpad]) {
+			uint16_t x_loc = 0;
+			uint16_t y_loc = 0;
+			bool finger_down = calcTpadXY(trackpad, &x_loc, &y_loc);
+
+			tpadXLocs[trackpad] = x_loc;
+			tpadYLocs[trackpad] = y_loc;
+
+			hapticFeedbackTpadUpdate(trackpad, finger_down, x_loc, 
+				y_loc);
+		}
+		tpadLocTimestamps[trackpad] = tpadAdcTimestamps[trackpad];
+
+		tpadLocReady[trackpad] = true;
+
+		if (tpadNotifyTasks[trackpad] != NUM_TASKS) {
+			postTaskEvent(tpadNotifyTasks[trackpad], 
+				tpadNotifyEvents[trackpad]);
+		}
 	}
 }
 
+/**
+ * Define task to be notified each time a requested location update (i.e. via
+ *  trackpadLocUpdate()) completes.
+ *
+ * \param trackpad Specifies which Trackpad to get notifications for. 
+ * \param task Task to post to. NUM_TASKS to disable notification.
+ * \param events Events to post to task.
+ *
+ * \return None.
+ */
+void setTrackpadUpdateNotify(Trackpad trackpad, Task task, uint32_t events) {
+	tpadNotifyEvents[trackpad] = events;
+	tpadNotifyTasks[trackpad] = task;
+}
+
 /**
  * Setup Trackpad ASIC (i.e. configure registers, calibration, setup ISR).
  * 
@@ -1299,8 +1426,10 @@ static void setupTpad(Trackpad trackpad) {
 
 	usleep(50 * 1000);
 
+	watchdogMark(WDOG_MARK_TPAD_CC);
 	while (!(TPAD_STATUS1_CC_BIT & readTpadReg(trackpad, TPAD_STATUS1_ADDR))) {
 	}
+	watchdogMark(WDOG_MARK_TPAD_SETUP);
 
 	clearTpadFlags(trackpad);
 
@@ -1575,9 +1704,11 @@ static void setupTpad(Trackpad trackpad) {
 		// Request X and Y AnyMeas ADC measurements
 		trackpadLocUpdate(trackpad);
 
-		// Wait for AnyMeas ADCs related to X position to be updated
-		while (tpadAdcIdxs[trackpad] < NUM_ANYMEAS_ADCS) {
-			__WFI();
+		// Wait for AnyMeas ADCs related to X position to be updated.
+		//  Leave trackpad uncalibrated (i.e. no X/Y locations) 
+		//  rather than hang if ASIC is not responding
+		if (waitForFlag(&tpadLocReady[trackpad], TPAD_TIMEOUT_US)) {
+			return;
 		}
 
 		for (int comp_idx = 0; comp_idx < NUM_ANYMEAS_ADCS; comp_idx++) {
@@ -1589,6 +1720,8 @@ static void setupTpad(Trackpad trackpad) {
 		tpadAdcComps[trackpad][comp_idx] = comp_accums[comp_idx] 
 			/ NUM_COMP_AVGS;
 	}
+
+	tpadCompsValid[trackpad] = true;
 }
 
 
@@ -1605,6 +1738,10 @@ void initTrackpad(void) {
 	//  we don't use SSP0 interrupts...)
 	NVIC_SetPriority(SSP0_IRQn, 1);
 
+#if (ANYMEAS_EN)
+	registerTask(TASK_TPAD, tpadTask, TASK_CTX_DEFERRED);
+#endif // ANYMEAS_EN
+
 	// Setup SSP0 pins
 	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_SCK0, IOCON_FUNC1);
 	Chip_IOCON_PinMuxSet(LPC_IOCON, GPIO_SSP0_MISO0, IOCON_FUNC1);
@@ -1642,8 +1779,10 @@ void initTrackpad(void) {
 	writeTpadReg(L_TRACKPAD, TPAD_SYSCFG1_ADDR, 
 		TPAD_SYSCFG1_SHUTDOWN_BIT);
 
+	WdogMarker prev_mark = watchdogMark(WDOG_MARK_TPAD_SETUP);
 	setupTpad(R_TRACKPAD);
 	setupTpad(L_TRACKPAD);
+	watchdogMark(prev_mark);
 }
 
 
@@ -1672,6 +1811,13 @@ void getNextTpadAdcValIsr(Trackpad trackpad) {
 		// Start the measurement
 		writeTpadReg(trackpad, TPAD_SYSCFG1_ADDR, 
 			TPAD_SYSCFG1_ANYMEASEN_BIT | TPAD_SYSCFG1_TRACKDIS_BIT);
+	} else if (tpad_adc_idx == NUM_ANYMEAS_ADCS) {
+		tpadAdcTimestamps[trackpad] = getUsTickCnt64();
+
+		// Calculate location as soon as all data is in (but outside of
+		//  ISR) so that haptic feedback follows finger with as little 
+		//  latency as possible
+		postTaskEvent(TASK_TPAD, 1 << trackpad);
 	}
 
 	tpadAdcIdxs[trackpad] = tpad_adc_idx;
@@ -1731,11 +1877,15 @@ void trackpadCmdUsage(void) {
 		"       trackpad getRaw\n"
 		"       trackpad readReg left/right addr\n"
 		"       trackpad writeReg left/right addr val\n"
+		"       trackpad feedback [on/off] [tickDist]\n"
 		"\n"
 		"monitor: Monitor X/Y position calculated for each Trackpad\n"
 		"getRaw: print single set of raw ADC readings and compensation\n" 
 		"	data (ideal for inserting into simulations)\n"
 		"readReg/writeReg: Access Trackpad ASIC Regiters\n"
+		"feedback: Print or change haptic ticks generated as finger\n"
+		"	moves across Trackpad. tickDist is distance (in X/Y\n"
+		"	location units) finger travels between ticks\n"
 #endif
 	);
 }
@@ -1918,6 +2068,35 @@ int trackpadCmdFnc(int argc, const char* argv[]) {
 			val, addr, trackpad == R_TRACKPAD ? "right":"left");
 		
 		writeTpadReg(trackpad, addr, val);
+	} else if (!strcmp("feedback", argv[1])) {
+		if (argc > 4) {
+			trackpadCmdUsage();
+			return -1;
+		}
+		bool enable = getTpadHapticFeedbackEn();
+		uint32_t tick_dist = getTpadHapticFeedbackTickDist();
+		if (argc >= 3) {
+			if (!strcmp("on", argv[2])) {
+				enable = true;
+			} else if (!strcmp("off", argv[2])) {
+				enable = false;
+			} else {
+				trackpadCmdUsage();
+				return -1;
+			}
+		}
+		if (argc == 4) {
+			tick_dist = strtol(argv[3], NULL, 0);
+			if (!tick_dist || tick_dist > TPAD_MAX_X) {
+				printf("tickDist must be in range 1 to %d\n",
+					TPAD_MAX_X);
+				return -1;
+			}
+		}
+		setTpadHapticFeedback(enable, tick_dist);
+
+		printf("Trackpad haptic feedback is %s (tickDist = %d)\n",
+			enable ? "on" : "off", tick_dist);
 	} else {
 		trackpadCmdUsage();
 		return -1;
@@ -38,6 +38,11 @@
 #include "buttons.h"
 #include "adc_read.h"
 #include "trackpad.h"
+#include "haptic.h"
+#include "sched.h"
+#include "time.h"
+#include "usb_cdc.h"
+#include "irq_mask.h"
 
 //TODO: straighten out weird circular includes? We cannot include usbd/usbd_core.h, even though that's what we want at this point...
 //#include "usbd/usbd_core.h"
@@ -45,20 +50,10 @@
 
 #include "chip.h"
 
-#include "led_ctrl.h"
-
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
-#if (__REDLIB_INTERFACE_VERSION__ >= 20000)
-/* We are using new Redlib_v2 semihosting interface */
-	#define WRITEFUNC __sys_write
-	#define READFUNC __sys_readc
-#else
-/* We are using original Redlib semihosting interface */
-	#define WRITEFUNC __write
-	#define READFUNC __readc
-#endif
 
 const USBD_API_T *g_pUsbApi; //!< Through a series of non-ideal associations
 	//!< this is used to access boot ROM code for USB functions. See
@@ -90,58 +85,173 @@ void USB_IRQHandler(void)
 }
 
 
-#if (FIRMWARE_BEHAVIOR == DEV_BOARD_FW)
+//TODO: better comments
+/* Find the address of interface descriptor for given class type. */
+USB_INTERFACE_DESCRIPTOR *find_IntfDesc(const uint8_t *pDesc, uint32_t intfClass)
+{
+	USB_COMMON_DESCRIPTOR *pD;
+	USB_INTERFACE_DESCRIPTOR *pIntfDesc = 0;
+	uint32_t next_desc_adr;
 
-// Structure containing Virtual Comm port control data.
-typedef struct {
-	USBD_HANDLE_T usbHandle; //!< Handle to USB device stack 
-	USBD_HANDLE_T cdcHandle; //!< Handle to Communications Device Class controller
-
-	uint8_t* rxFifo; //!< Buffer treated as a FIFO which stores character
-		//!< data that has been received via USB CDC UART
-	volatile uint32_t rxWrapIdx; //!< Defines where rxFifo wraps around. 
-		//!< This index and anything beyond it in rxFifo does not have 
-		//!< valid data to read.  We need this because ReadEP can return
-		//!< up to USB_MAX_PACKET_SZ bytes, but we don't know ahead of 
-		//!< time how many we are actually getting.  This allows us to 
-		//!< maximize memory usage, while not overflowing rxFifo.
-	volatile uint32_t rxRdIdx; //!< Defines where next character is read
-		//!< from in rxFifo. If rxRdIdx == rxWrIdx FIFO is empty.
-	volatile uint32_t rxWrIdx; //!< Defines where next character(s) are to
-		//!< to be stored when received from USB CDC UART.
-	uint32_t rxStalled; //!< Flag that we did not have enough room for 
-		//!< incoming data in rxFifo and did not call ReadEP. We will
-		//!< need to call ReadEP to get the buffered data and have 
-		//!< interrupts start working again once room opens in txFIFO.
-		//!< Note that even though we do not call ReadEP, incoming 
-		//!< USB packets may be dropped and into data lost. Still
-		//!< looking for solutions to fix this.
-
-	volatile int txBusy; //!< Indicates transmission is in progress. This 
-		//!< does not guarantee that txFifo will be drained (use 
-		//!< usb_flush() for this).
-	uint8_t* txFifo; //!< Buffer treated as a FIFO which stores character
-		//!< data to be transmitted via USB CDC UART
-	uint32_t txRdIdx; //!< The index of where the next read sample
-		//!< exists in txFifo
-	uint32_t txWrIdx; //!< The index of where the next write 
-		//!< sample will be put in txFifo
-	uint32_t txSent; //!< Number of bytes WriteEP reports it last 
-		//!< sent.
-} UsbUartData;
-
-static const uint32_t USB_MAX_PACKET_SZ = USB_FS_MAX_BULK_PACKET; //!< Maximum 
-	//!< number of bytes in packet that can be sent or received via USB.
-
-static const uint32_t USB_UART_TXFIFO_SZ = 256; //!< Number of bytes in txFifo.
-	//!< This must be a power of 2!
-static const uint32_t USB_UART_TXFIFO_THRESH = 128; //!< Determines when
-	//!< transmission of txFifo data starts automatically.
-
-static const uint32_t USB_UART_RXFIFO_SZ = 256; //!< Number of bytes in rxFifo.
-
-static UsbUartData usbUartData; //!< Virtual Comm port control data 
-	//!< instance. 
+	pD = (USB_COMMON_DESCRIPTOR *) pDesc;
+	next_desc_adr = (uint32_t) pDesc;
+
+	while (pD->bLength) {
+		/* is it interface descriptor */
+		if (pD->bDescriptorType == USB_INTERFACE_DESCRIPTOR_TYPE) {
+
+			pIntfDesc = (USB_INTERFACE_DESCRIPTOR *) pD;
+			/* did we find the right interface descriptor */
+			if (pIntfDesc->bInterfaceClass == intfClass) {
+				break;
+			}
+		}
+		pIntfDesc = 0;
+		next_desc_adr = (uint32_t) pD + pD->bLength;
+		pD = (USB_COMMON_DESCRIPTOR *) next_desc_adr;
+	}
+
+	return pIntfDesc;
+}
+
+/**
+ * Queue a packet on an EP via USB ROM API. Must be used instead of calling 
+ *  WriteEP directly from anywhere but USB IRQ.
+ *
+ * WriteEP and ReadEP update the EP command/status list and EP buffer state 
+ *  that the ROM ISR (USBD_API->hw->ISR(), run by USB0 IRQ) also updates when
+ *  it handles transfer completions, and the ROM functions are not reentrant.
+ *  The only other caller is USB0 IRQ itself, so masking just that line (as 
+ *  is done by NXP's LPCOpen CDC examples) is enough and leaves haptic, ADC,
+ *  trackpad and timer IRQs running.
+ *
+ * \param hUsb Handle to USB stack.
+ * \param epNum EP address.
+ * \param[in] data Packet data.
+ * \param len Number of bytes in data.
+ *
+ * \return Number of bytes queued.
+ */
+uint32_t usbEpWrite(USBD_HANDLE_T hUsb, uint32_t epNum, uint8_t* data, 
+	uint32_t len) {
+	IrqMaskState irq_state = enterIrqMask(IRQ_MASK_USB);
+	uint32_t sent = USBD_API->hw->WriteEP(hUsb, epNum, data, len);
+	exitIrqMask(irq_state);
+
+	return sent;
+}
+
+/**
+ * Read a packet from an EP via USB ROM API and rearm it. Must be used instead
+ *  of calling ReadEP directly from anywhere but USB IRQ (see usbEpWrite()).
+ *
+ * \param hUsb Handle to USB stack.
+ * \param epNum EP address.
+ * \param[out] data Buffer for USB_FS_MAX_BULK_PACKET bytes.
+ *
+ * \return Number of bytes read.
+ */
+uint32_t usbEpRead(USBD_HANDLE_T hUsb, uint32_t epNum, uint8_t* data) {
+	IrqMaskState irq_state = enterIrqMask(IRQ_MASK_USB);
+	uint32_t rcvd = USBD_API->hw->ReadEP(hUsb, epNum, data);
+	exitIrqMask(irq_state);
+
+	return rcvd;
+}
+
+/**
+ * CDC ACM function descriptors (IAD, communication class interface and data
+ *  class interface) that make up the virtual comm port. Shared by all 
+ *  configurations that have a console.
+ *
+ * \param iStr Index of string descriptor naming the function.
+ */
+#define USB_CDC_DESCS(iStr) \
+	/* Interface association descriptor IAD*/ \
+	USB_INTERFACE_ASSOC_DESC_SIZE, /* bLength */ \
+	USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE, /* bDescriptorType */ \
+	USB_CDC_CIF_NUM, /* bFirstInterface */ \
+	0x02, /* bInterfaceCount */ \
+	CDC_COMMUNICATION_INTERFACE_CLASS, /* bFunctionClass */ \
+	CDC_ABSTRACT_CONTROL_MODEL, /* bFunctionSubClass */ \
+	0x00, /* bFunctionProtocol */ \
+	iStr, /* iFunction */ \
+ \
+	/* Communication class interface, Alternate Setting 0 */ \
+	USB_INTERFACE_DESC_SIZE, /* bLength */ \
+	USB_INTERFACE_DESCRIPTOR_TYPE, /* bDescriptorType */ \
+	USB_CDC_CIF_NUM, /* bInterfaceNumber: Number of Interface */ \
+	0x00, /* bAlternateSetting: Alternate setting */ \
+	0x01, /* bNumEndpoints: One endpoint used */ \
+	CDC_COMMUNICATION_INTERFACE_CLASS, /* bInterfaceClass: Communication Interface Class */ \
+	CDC_ABSTRACT_CONTROL_MODEL, /* bInterfaceSubClass: Abstract Control Model */ \
+	0x00, /* bInterfaceProtocol: no protocol used */ \
+	iStr, /* iInterface: */ \
+	/* Header Functional Descriptor*/ \
+	0x05, /* bLength: CDC header Descriptor size */ \
+	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */ \
+	CDC_HEADER, /* bDescriptorSubtype: Header Func Desc */ \
+	WBVAL(CDC_V1_10), /* bcdCDC 1.10 */ \
+	/* Call Management Functional Descriptor*/ \
+	0x05, /* bFunctionLength */ \
+	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */ \
+	CDC_CALL_MANAGEMENT, /* bDescriptorSubtype: Call Management Func Desc */ \
+	0x01, /* bmCapabilities: device handles call management */ \
+	USB_CDC_DIF_NUM, /* bDataInterface: CDC data IF ID */ \
+	/* Abstract Control Management Functional Descriptor*/ \
+	0x04, /* bFunctionLength */ \
+	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */ \
+	CDC_ABSTRACT_CONTROL_MANAGEMENT, /* bDescriptorSubtype: Abstract Control Management desc */ \
+	0x02, /* bmCapabilities: SET_LINE_CODING, GET_LINE_CODING, SET_CONTROL_LINE_STATE supported */ \
+	/* Union Functional Descriptor*/ \
+	0x05, /* bFunctionLength */ \
+	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */ \
+	CDC_UNION, /* bDescriptorSubtype: Union func desc */ \
+	USB_CDC_CIF_NUM, /* bMasterInterface: Communication class interface is master */ \
+	USB_CDC_DIF_NUM, /* bSlaveInterface0: Data class interface is slave 0 */ \
+	/* Endpoint, Interrupt In */ \
+	USB_ENDPOINT_DESC_SIZE, /* bLength */ \
+	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */ \
+	USB_CDC_INT_EP, /* bEndpointAddress */ \
+	USB_ENDPOINT_TYPE_INTERRUPT, /* bmAttributes */ \
+	WBVAL(0x0010), /* wMaxPacketSize */ \
+	0x02, /* 2ms */ /* bInterval */ \
+ \
+	/* Data class interface, Alternate Setting 0 */ \
+	USB_INTERFACE_DESC_SIZE, /* bLength */ \
+	USB_INTERFACE_DESCRIPTOR_TYPE, /* bDescriptorType */ \
+	USB_CDC_DIF_NUM, /* bInterfaceNumber: Number of Interface */ \
+	0x00, /* bAlternateSetting: no alternate setting */ \
+	0x02, /* bNumEndpoints: two endpoints used */ \
+	CDC_DATA_INTERFACE_CLASS, /* bInterfaceClass: Data Interface Class */ \
+	0x00, /* bInterfaceSubClass: no subclass available */ \
+	0x00, /* bInterfaceProtocol: no protocol used */ \
+	iStr, /* iInterface: */ \
+	/* Endpoint, EP Bulk Out */ \
+	USB_ENDPOINT_DESC_SIZE, /* bLength */ \
+	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */ \
+	USB_CDC_OUT_EP,	 /* bEndpointAddress */ \
+	USB_ENDPOINT_TYPE_BULK, /* bmAttributes */ \
+	WBVAL(USB_FS_MAX_BULK_PACKET), /* wMaxPacketSize */ \
+	0x00, /* bInterval: ignore for Bulk transfer */ \
+	/* Endpoint, EP Bulk In */ \
+	USB_ENDPOINT_DESC_SIZE, /* bLength */ \
+	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */ \
+	USB_CDC_IN_EP, /* bEndpointAddress */ \
+	USB_ENDPOINT_TYPE_BULK, /* bmAttributes */ \
+	WBVAL(USB_FS_MAX_BULK_PACKET), /* wMaxPacketSize */ \
+	0x00 /* bInterval: ignore for Bulk transfer */
+
+#define USB_CDC_DESCS_SIZE ( \
+	USB_INTERFACE_ASSOC_DESC_SIZE   +	/* interface association descriptor */ \
+	USB_INTERFACE_DESC_SIZE         +	/* communication control interface */ \
+	0x0013                          +	/* CDC functions */ \
+	1 * USB_ENDPOINT_DESC_SIZE      +	/* interrupt endpoint */ \
+	USB_INTERFACE_DESC_SIZE         +	/* communication data interface */ \
+	2 * USB_ENDPOINT_DESC_SIZE		/* bulk endpoints */ \
+	) //!< Number of bytes in USB_CDC_DESCS().
+
+#if (FIRMWARE_BEHAVIOR == DEV_BOARD_FW)
 
 /**
  * USB Standard Device Descriptor
@@ -173,13 +283,7 @@ ALIGNED(4) uint8_t USB_FsConfigDescriptor[] = {
 	USB_CONFIGURATION_DESCRIPTOR_TYPE, /* bDescriptorType */
 	WBVAL( /* wTotalLength */
 		USB_CONFIGURATION_DESC_SIZE     +
-		USB_INTERFACE_ASSOC_DESC_SIZE   +	/* interface association descriptor */
-		USB_INTERFACE_DESC_SIZE         +	/* communication control interface */
-		0x0013                          +	/* CDC functions */
-		1 * USB_ENDPOINT_DESC_SIZE      +	/* interrupt endpoint */
-		USB_INTERFACE_DESC_SIZE         +	/* communication data interface */
-		2 * USB_ENDPOINT_DESC_SIZE      +	/* bulk endpoints */
-		0
+		USB_CDC_DESCS_SIZE
 		),
 	0x02, /* bNumInterfaces */
 	0x01, /* bConfigurationValue */
@@ -187,80 +291,7 @@ ALIGNED(4) uint8_t USB_FsConfigDescriptor[] = {
 	USB_CONFIG_SELF_POWERED, /* bmAttributes  */
 	USB_CONFIG_POWER_MA(500), /* bMaxPower */
 
-	/* Interface association descriptor IAD*/
-	USB_INTERFACE_ASSOC_DESC_SIZE, /* bLength */
-	USB_INTERFACE_ASSOCIATION_DESCRIPTOR_TYPE, /* bDescriptorType */
-	USB_CDC_CIF_NUM, /* bFirstInterface */
-	0x02, /* bInterfaceCount */
-	CDC_COMMUNICATION_INTERFACE_CLASS, /* bFunctionClass */
-	CDC_ABSTRACT_CONTROL_MODEL, /* bFunctionSubClass */
-	0x00, /* bFunctionProtocol */
-	0x04, /* iFunction */
-
-	/* Interface 0, Alternate Setting 0, Communication class interface descriptor */
-	USB_INTERFACE_DESC_SIZE, /* bLength */
-	USB_INTERFACE_DESCRIPTOR_TYPE, /* bDescriptorType */
-	USB_CDC_CIF_NUM, /* bInterfaceNumber: Number of Interface */
-	0x00, /* bAlternateSetting: Alternate setting */
-	0x01, /* bNumEndpoints: One endpoint used */
-	CDC_COMMUNICATION_INTERFACE_CLASS, /* bInterfaceClass: Communication Interface Class */
-	CDC_ABSTRACT_CONTROL_MODEL, /* bInterfaceSubClass: Abstract Control Model */
-	0x00, /* bInterfaceProtocol: no protocol used */
-	0x04, /* iInterface: */
-	/* Header Functional Descriptor*/
-	0x05, /* bLength: CDC header Descriptor size */
-	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */
-	CDC_HEADER, /* bDescriptorSubtype: Header Func Desc */
-	WBVAL(CDC_V1_10), /* bcdCDC 1.10 */
-	/* Call Management Functional Descriptor*/
-	0x05, /* bFunctionLength */
-	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */
-	CDC_CALL_MANAGEMENT, /* bDescriptorSubtype: Call Management Func Desc */
-	0x01, /* bmCapabilities: device handles call management */
-	USB_CDC_DIF_NUM, /* bDataInterface: CDC data IF ID */
-	/* Abstract Control Management Functional Descriptor*/
-	0x04, /* bFunctionLength */
-	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */
-	CDC_ABSTRACT_CONTROL_MANAGEMENT, /* bDescriptorSubtype: Abstract Control Management desc */
-	0x02, /* bmCapabilities: SET_LINE_CODING, GET_LINE_CODING, SET_CONTROL_LINE_STATE supported */
-	/* Union Functional Descriptor*/
-	0x05, /* bFunctionLength */
-	CDC_CS_INTERFACE, /* bDescriptorType: CS_INTERFACE */
-	CDC_UNION, /* bDescriptorSubtype: Union func desc */
-	USB_CDC_CIF_NUM, /* bMasterInterface: Communication class interface is master */
-	USB_CDC_DIF_NUM, /* bSlaveInterface0: Data class interface is slave 0 */
-	/* Endpoint 1 Descriptor*/
-	USB_ENDPOINT_DESC_SIZE, /* bLength */
-	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */
-	USB_CDC_INT_EP, /* bEndpointAddress */
-	USB_ENDPOINT_TYPE_INTERRUPT, /* bmAttributes */
-	WBVAL(0x0010), /* wMaxPacketSize */
-	0x02, /* 2ms */ /* bInterval */
-
-	/* Interface 1, Alternate Setting 0, Data class interface descriptor*/
-	USB_INTERFACE_DESC_SIZE, /* bLength */
-	USB_INTERFACE_DESCRIPTOR_TYPE, /* bDescriptorType */
-	USB_CDC_DIF_NUM, /* bInterfaceNumber: Number of Interface */
-	0x00, /* bAlternateSetting: no alternate setting */
-	0x02, /* bNumEndpoints: two endpoints used */
-	CDC_DATA_INTERFACE_CLASS, /* bInterfaceClass: Data Interface Class */
-	0x00, /* bInterfaceSubClass: no subclass available */
-	0x00, /* bInterfaceProtocol: no protocol used */
-	0x04, /* iInterface: */
-	/* Endpoint, EP Bulk Out */
-	USB_ENDPOINT_DESC_SIZE, /* bLength */
-	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */
-	USB_CDC_OUT_EP,	 /* bEndpointAddress */
-	USB_ENDPOINT_TYPE_BULK, /* bmAttributes */
-	WBVAL(USB_FS_MAX_BULK_PACKET), /* wMaxPacketSize */
-	0x00, /* bInterval: ignore for Bulk transfer */
-	/* Endpoint, EP Bulk In */
-	USB_ENDPOINT_DESC_SIZE, /* bLength */
-	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */
-	USB_CDC_IN_EP, /* bEndpointAddress */
-	USB_ENDPOINT_TYPE_BULK, /* bmAttributes */
-	WBVAL(USB_FS_MAX_BULK_PACKET), /* wMaxPacketSize */
-	0x00, /* bInterval: ignore for Bulk transfer */
+	USB_CDC_DESCS(0x04),
 	/* Terminator */
 	0 /* bLength */
 };
@@ -325,514 +356,6 @@ ALIGNED(4) const uint8_t USB_StringDescriptor[] = {
 	'M', 0,
 };
 
-/**
- * \param[in] uartData Contains details on Virtual Comm to transmit via.
- *
- * \return The number of bytes in txFifo ready to be sent.
- */
-static uint32_t usbTxFifoNumBytes(const UsbUartData* uartData) {
-	if (uartData->txWrIdx >= uartData->txRdIdx) {
-		return uartData->txWrIdx - uartData->txRdIdx;
-	}
-
-	return 1 + uartData->txRdIdx + USB_UART_TXFIFO_SZ - uartData->txWrIdx;
-}
-
-/**
- * Start a (series of) transmission(s) via USB with as much txFifo data as
- *  possible. This will do nothing if a transmission is already in progress
- *  or txFIFO is empty.
- *
- * \param[inout] uartData Contains details on Virtual Comm to transmit via.
- *
- * \return None.
- */
-static void usbUartTxStart(UsbUartData* uartData) {
-	// Make sure we are not already busy with a transmit
-	if (uartData->txBusy) {
-		return;
-	}
-
-	// Mark that we are busy now
-	uartData->txBusy = 1;
-
-	// Check if there is any data to send
-	uint32_t bytes_to_send = usbTxFifoNumBytes(uartData);
-
-	// Make sure there is no wrap around in send request
-	if (bytes_to_send + uartData->txRdIdx >= USB_UART_TXFIFO_SZ) {
-		bytes_to_send = USB_UART_TXFIFO_SZ - uartData->txRdIdx;
-	}
-
-	// Make sure we actually have data to send
-	if (!bytes_to_send) {
-		uartData->txBusy = 0;
-		return;
-	}
-
-	// Seems we can enter an error state (i.e. interrupt does not fire or
-	//  keeps firing continuously) if we tell WriteEP() that it should send
-	//  number of bytes larger than what is specified for wMaxPacketSize
-	if (bytes_to_send > USB_MAX_PACKET_SZ) {
-		bytes_to_send = USB_MAX_PACKET_SZ;
-	}
-
-	// Apparently IRQs need to be disabled around call to WriteEP. If they
-	//  are not and other interrupts are active of (higher priority)
-	//  (i.e. ADC interrupts) we can get repeated prints or dropped data... 
-	//  Not sure why. Maybe related to built in CDC UART support?
-	__disable_irq();
-
-	// Send the data to the USB EP (the interrupt handler will adjust rxIdx)
-	if (USB_IsConfigured(uartData->usbHandle)) {
-		uartData->txSent = USBD_API->hw->WriteEP(uartData->usbHandle, 
-			USB_CDC_IN_EP, &uartData->txFifo[uartData->txRdIdx], 
-			bytes_to_send);
-	}
-
-	__enable_irq();
-
-	// Just in case something went wrong
-	if (!uartData->txSent) {
-		uartData->txBusy = 0;
-	}
-}
-
-/**
- * Queue character to be transmitted via USB CDC UART. This does not guarantee
- *  character will be sent upon function return (use usb_flush() to guarantee).
- *
- * \param character Character to write out via virtual UART.
- * 
- * \return Character queued. Function will stall until character is queued.
- */
-int usb_putc(int character) {
-	uint32_t next_wr_idx = 0;
-	// Wait until FIFO is not full
-	// Note: this is a wasteful "full" calculation as there is still
-	//  one byte left in the FIFO, however, this makes calculating the
-	//  number of bytes in the FIFO simpler.
-	do {
-		next_wr_idx = (usbUartData.txWrIdx + 1) % USB_UART_TXFIFO_SZ;
-	} while (next_wr_idx == usbUartData.txRdIdx);
-
-	// Put new character info FIFO
-	usbUartData.txFifo[usbUartData.txWrIdx] = character;
-	usbUartData.txWrIdx = next_wr_idx;
-
-	// Check if transmit should be initiated
-	if (usbUartData.txBusy) {
-		// Transmit is already taking place. New character may or may
-		//  not make it out
-		return character;
-	}
-
-	// Request starting a new (series of) transmission(s) if the FIFO has
-	//  filled up adequately
-	if (usbTxFifoNumBytes(&usbUartData) >= USB_UART_TXFIFO_THRESH) {
-		usbUartTxStart(&usbUartData);
-	}
-
-	return character;
-}
-
-/**
- * Queue the data in the buffer for output via USB CDC UART. Useful for cases
- *  in which we want to only print some characters of a string, or print from
- *  a buffer that is not necessarily null terminated.
- *
- * \param[in] buff Buffer storing data to write out via virtual serial.
- * \param len Numbers of chars in buff.
- * 
- * \return None.
- */
-void usb_putb(const char* buff, uint32_t len) {
-	for (int idx = 0; idx < len; idx++){
-		usb_putc(buff[idx]);
-	}
-}
-
-/**
- * Make sure any character currently in the transmit FIFO are transmitted via
- *  USB.
- *
- * \return 0 on success. Function will stall until flushing of data in transmit
- *  FIFO is initiated.
- */
-int usb_flush(void) {
-	// Wait for any ongoing transmissions to finish
-	while (usbUartData.txBusy);
-
-	// Start a new transmission that will make sure all data currently in
-	//  txFifo is sent
-	usbUartTxStart(&usbUartData);
-
-	return 0;
-}
-
-/**
- * Called by bottom level of printf routine within RedLib C library to print
- *  characters. 
- * 
- * \parma iFileHandle Ignored.
- * \param[in] pcBuffer Stores characters to be printed.
- * \parma iLength Number of characters in pcBuffer.
- * 
- * \return Number of characters queued for printing.
- */
-int WRITEFUNC(int iFileHandle, char *pcBuffer, int iLength) {
-	for (int idx = 0; idx < iLength; idx++) {
-		usb_putc(pcBuffer[idx]);
-		// Need to add carriage return and flush after each newline
-		if (pcBuffer[idx] == '\n') {
-			usb_putc('\r');
-			usb_flush();
-		}
-	}
-
-	return iLength;
-}
-
-/**
- * Receive data from the USB CDC UART. This is called when we already know
- *  that data is waiting for us and ReadEP needs to be called.
- *
- * \param[in] uartData Contains details on Virtual Comm to receive from.
- * 
- * \return None.
- */
-static void rcvUartData(UsbUartData* uartData) {
-	if (uartData->rxRdIdx <= uartData->rxWrIdx) {
-		// Check if there is enough room until end of buffer to 
-		//  contain max number of bytes we could receive
-		if (uartData->rxWrIdx + USB_MAX_PACKET_SZ >= 
-			USB_UART_TXFIFO_SZ) {
-
-			// At this point we know rxWrIdx needs to wrap to 0:
-
-			// If rxRdIdx is 0 this would look like FIFO is empty, 
-			//  so stall until reads occur
-			if (uartData->rxRdIdx == 0) {
-				// Mark as stalled we so try again next getc()
-				uartData->rxStalled = 1;
-				return;
-			}
-
-			// If FIFO is empty we also need to move rxRdIdx so
-			//  that garbage samples are not read
-			if (uartData->rxRdIdx == uartData->rxWrIdx) {
-				uartData->rxRdIdx = 0;
-			}
-			uartData->rxWrapIdx = uartData->rxWrIdx;
-			uartData->rxWrIdx = 0;
-		}
-	} 
-
-	if (uartData->rxRdIdx > uartData->rxWrIdx) {
-		// Check if this write could overflow read pointer
-		if (uartData->rxWrIdx + USB_MAX_PACKET_SZ >= 
-			uartData->rxRdIdx) {
-
-			// Mark as stalled we so try again next getc()
-			uartData->rxStalled = 1;
-			return;
-		}
-	}
-
-	uint32_t bytes_rcvd = USBD_API->hw->ReadEP(usbHandle, 
-		USB_CDC_OUT_EP, 
-		&uartData->rxFifo[uartData->rxWrIdx]);
-
-	uartData->rxWrIdx += bytes_rcvd;
-
-	if (uartData->rxWrIdx >= uartData->rxWrapIdx) {
-		// Update wrap index if necessary
-		uartData->rxWrapIdx = uartData->rxWrIdx + 1;
-	}
-}
-
-/**
- * Check if there is a character in the USB CDC UART RX FIFO.
- * 
- * \return 0 if no character is available.
- */
-int usb_tstc(void) {
-	return usbUartData.rxRdIdx != usbUartData.rxWrIdx;
-}
-
-/**
- * Get a character from the USB CDC UART RX FIFO. This will not return until
- *  a character is received via USB.
- * 
- * \return The next character in the USB CDC UART RX FIFO. Will not return 
- *  until character is available.
- */
-int usb_getc(void) {
-	// Wait until there is a character
-	while (!usb_tstc());
-
-	char c = usbUartData.rxFifo[usbUartData.rxRdIdx];
-
-	usbUartData.rxRdIdx++;
-
-	if (usbUartData.rxRdIdx >= usbUartData.rxWrapIdx) {
-		usbUartData.rxRdIdx = 0;
-	}
-
-	// If we stalled previously, try to receive that pending data and 
-	//  startup receive callback
-	if (usbUartData.rxStalled) {
-		usbUartData.rxStalled = 0;
-		rcvUartData(&usbUartData);
-	}
-
-	return c;
-}
-
-/**
- * Called by bottom level of scanf routine within RedLib C library to read
- *  a character. 
- *
- * \return The next character in the USB CDC UART RX FIFO. Will not return 
- *  until character is available.
- */
-int READFUNC(void) {
-	return usb_getc();
-}
-
-/**
- * USB CDC UART bulk EP_IN and EP_OUT endpoints handler 
- *
- * \param[in] usbHandle Handle to USB device stack.
- * \param[inout] data Pointer to USB UART data structure.
- * \param event Provides information on transfer event that occurred to trigger
- *	handler call.
- *
- * \return LPC_OK on success.
- */
-static ErrorCode_t usbUartBulkHandler(USBD_HANDLE_T usbHandle, void* data, 
-	uint32_t event) {
-	UsbUartData* usb_uart_data = (UsbUartData*)data;
-
-	switch (event) {
-	// A transfer from us to the USB host that we queued has completed
-	case USB_EVT_IN:
-		// Update read index
-		usb_uart_data->txRdIdx = (usb_uart_data->txRdIdx + 
-			usb_uart_data->txSent) % USB_UART_TXFIFO_SZ;
-		usb_uart_data->txSent = 0;
-		usb_uart_data->txBusy = 0;
-
-		// Attempt to start another transmission
-		usbUartTxStart(usb_uart_data);
-		break;
-
-	// We received a transfer from the USB host. 
-	case USB_EVT_OUT:
-		rcvUartData(usb_uart_data);
-		break;
-
-	case ERR_USBD_STALL:
-		setLedIntensity(0);
-		break;
-
-	default:
-		break;
-	}
-
-	return LPC_OK;
-}
-
-//TODO: better comments
-/* Find the address of interface descriptor for given class type. */
-USB_INTERFACE_DESCRIPTOR *find_IntfDesc(const uint8_t *pDesc, uint32_t intfClass)
-{
-	USB_COMMON_DESCRIPTOR *pD;
-	USB_INTERFACE_DESCRIPTOR *pIntfDesc = 0;
-	uint32_t next_desc_adr;
-
-	pD = (USB_COMMON_DESCRIPTOR *) pDesc;
-	next_desc_adr = (uint32_t) pDesc;
-
-	while (pD->bLength) {
-		/* is it interface descriptor */
-		if (pD->bDescriptorType == USB_INTERFACE_DESCRIPTOR_TYPE) {
-
-			pIntfDesc = (USB_INTERFACE_DESCRIPTOR *) pD;
-			/* did we find the right interface descriptor */
-			if (pIntfDesc->bInterfaceClass == intfClass) {
-				break;
-			}
-		}
-		pIntfDesc = 0;
-		next_desc_adr = (uint32_t) pD + pD->bLength;
-		pD = (USB_COMMON_DESCRIPTOR *) next_desc_adr;
-	}
-
-	return pIntfDesc;
-}
-
-//TODO: better comments
-/* Set line coding call back routine */
-static ErrorCode_t usbUartSetLineCode(USBD_HANDLE_T hCDC, CDC_LINE_CODING *line_coding)
-{
-	uint32_t config_data = 0;
-
-	switch (line_coding->bDataBits) {
-	case 5:
-		config_data |= UART_LCR_WLEN5;
-		break;
-
-	case 6:
-		config_data |= UART_LCR_WLEN6;
-		break;
-
-	case 7:
-		config_data |= UART_LCR_WLEN7;
-		break;
-
-	case 8:
-	default:
-		config_data |= UART_LCR_WLEN8;
-		break;
-	}
-
-	switch (line_coding->bCharFormat) {
-	case 1:	/* 1.5 Stop Bits */
-		/* In the UART hardware 1.5 stop bits is only supported when using 5
-		 * data bits. If data bits is set to 5 and stop bits is set to 2 then
-		 * 1.5 stop bits is assumed. Because of this 2 stop bits is not support
-		 * when using 5 data bits.
-		 */
-		if (line_coding->bDataBits == 5) {
-			config_data |= UART_LCR_SBS_2BIT;
-		}
-		else {
-			return ERR_USBD_UNHANDLED;
-		}
-		break;
-
-	case 2:	/* 2 Stop Bits */
-		/* In the UART hardware if data bits is set to 5 and stop bits is set to 2 then
-		 * 1.5 stop bits is assumed. Because of this 2 stop bits is
-		 * not support when using 5 data bits.
-		 */
-		if (line_coding->bDataBits != 5) {
-			config_data |= UART_LCR_SBS_2BIT;
-		}
-		else {
-			return ERR_USBD_UNHANDLED;
-		}
-		break;
-
-	default:
-	case 0:	/* 1 Stop Bit */
-		config_data |= UART_LCR_SBS_1BIT;
-		break;
-	}
-
-	switch (line_coding->bParityType) {
-	case 1:
-		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_ODD);
-		break;
-
-	case 2:
-		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_EVEN);
-		break;
-
-	case 3:
-		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_F_1);
-		break;
-
-	case 4:
-		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_F_0);
-		break;
-
-	default:
-	case 0:
-		config_data |= UART_LCR_PARITY_DIS;
-		break;
-	}
-
-	// TODO: Should this still be here...?
-	if (line_coding->dwDTERate < 3125000) {
-		Chip_UART_SetBaud(LPC_USART, line_coding->dwDTERate);
-	}
-	Chip_UART_ConfigData(LPC_USART, config_data);
-
-	return LPC_OK;
-}
-
-/**
- * Intialize EP on USB to act as virtual UART.
- *
- * \param[in] usbHandle Handle to USB device stack.
- * \param[in] usbDescs Points to various descriptors for the USB device, to 
- *	provide details for EPs on the bus.
- * \param[inout] usbParams Parameters related to the USB stack (i.e. memory
- *	to be used by EPs)
- *
- * \return LPC_OK on success.
- */
-static ErrorCode_t usbUartInit(USBD_HANDLE_T usbHandle, 
-	const USB_CORE_DESCS_T *usbDescs, USBD_API_INIT_PARAM_T *usbParams)
-{
-	USBD_CDC_INIT_PARAM_T cdc_param;
-	ErrorCode_t ret = LPC_OK;
-	uint32_t ep_indx;
-	USB_CDC_CTRL_T *pCDC;
-
-	/* Store USB stack handle for future use. */
-	usbUartData.usbHandle = usbHandle;
-	/* Initi CDC params */
-	memset((void *) &cdc_param, 0, sizeof(USBD_CDC_INIT_PARAM_T));
-	cdc_param.mem_base = usbParams->mem_base;
-	cdc_param.mem_size = usbParams->mem_size;
-	cdc_param.cif_intf_desc = (uint8_t*)find_IntfDesc(
-		usbDescs->high_speed_desc, CDC_COMMUNICATION_INTERFACE_CLASS);
-	cdc_param.dif_intf_desc = (uint8_t*)find_IntfDesc(
-		usbDescs->high_speed_desc, CDC_DATA_INTERFACE_CLASS);
-	cdc_param.SetLineCode = usbUartSetLineCode;
-
-	/* Init CDC interface */
-	ret = USBD_API->cdc->init(usbHandle, &cdc_param, &usbUartData.cdcHandle);
-
-	if (ret == LPC_OK) {
-		// Allocate buffer for transmit FIFO
-		usbUartData.txFifo = (uint8_t *) cdc_param.mem_base;
-		cdc_param.mem_base += USB_UART_TXFIFO_SZ;
-		cdc_param.mem_size -= USB_UART_TXFIFO_SZ;
-
-		// Allocate buffer for receive FIFO
-		usbUartData.rxFifo = (uint8_t *) cdc_param.mem_base;
-		cdc_param.mem_base += USB_UART_RXFIFO_SZ;
-		cdc_param.mem_size -= USB_UART_RXFIFO_SZ;
-		usbUartData.rxWrapIdx = USB_UART_RXFIFO_SZ;
-
-		/* register endpoint interrupt handler */
-		ep_indx = (((USB_CDC_IN_EP & 0x0F) << 1) + 1);
-		ret = USBD_API->core->RegisterEpHandler(usbHandle, ep_indx, 
-			usbUartBulkHandler, &usbUartData);
-
-		if (ret == LPC_OK) {
-			/* register endpoint interrupt handler */
-			ep_indx = ((USB_CDC_OUT_EP & 0x0F) << 1);
-			ret = USBD_API->core->RegisterEpHandler(usbHandle, 
-				ep_indx, usbUartBulkHandler, &usbUartData);
-			/* Set the line coding values as per UART Settings */
-			pCDC = (USB_CDC_CTRL_T *) usbUartData.cdcHandle;
-			pCDC->line_coding.dwDTERate = 115200;
-			pCDC->line_coding.bDataBits = 8;
-		}
-
-		/* update mem_base and size variables for cascading calls. */
-		usbParams->mem_base = cdc_param.mem_base;
-		usbParams->mem_size = cdc_param.mem_size;
-	}
-
-	return ret;
-}
-
 /**
  * Configure USB interface. This allows for USB to communicate to act as a 
  *  virtual comm port.
@@ -890,7 +413,7 @@ int usbConfig(void){
 		- usb_param.mem_size);
 
 	/* Init UCOM - USB to UART bridge interface */
-	errCode = usbUartInit(usbHandle, &usb_desc, &usb_param);
+	errCode = usbCdcInit(usbHandle, &usb_desc, &usb_param);
 	if (errCode != LPC_OK) {
 		return -1;
 	}
@@ -955,6 +478,14 @@ const uint8_t PowerAReportDescriptor[] = {
 		0x95, 0x01, // 95 01 
 		0x81, 0x03, // 81 03 
 
+		// Not part of Power A descriptor. Vendor defined Output Report 
+		//  (same as used by other wired Switch controllers) so we can 
+		//  receive rumble data (see handleRumbleReport())
+		0x06, 0x00, 0xff, // 06 00 ff
+		0x0a, 0x21, 0x26, // 0a 21 26
+		0x95, 0x08, // 95 08
+		0x91, 0x02, // 91 02
+
 	HID_EndCollection, // c0
 };
 
@@ -967,9 +498,15 @@ ALIGNED(4) const uint8_t USB_DeviceDescriptor[] = {
 	USB_DEVICE_DESC_SIZE, /* bLength */
 	USB_DEVICE_DESCRIPTOR_TYPE, /* bDescriptorType */
 	WBVAL(0x0200), /* bcdUSB : 2.00*/
+#if (USB_COMPOSITE_CDC)
+	0xEF, /* bDeviceClass : Miscellaneous (IAD is used for CDC) */
+	0x02, /* bDeviceSubClass */
+	0x01, /* bDeviceProtocol */
+#else
 	0x00, /* bDeviceClass */
 	0x00, /* bDeviceSubClass */
 	0x00, /* bDeviceProtocol */
+#endif
 	USB_MAX_PACKET0, /* bMaxPacketSize0 */
 	WBVAL(0x20d6), /* idVendor */
 	WBVAL(0xa711), /* idProduct */
@@ -994,9 +531,10 @@ ALIGNED(4) uint8_t USB_FsConfigDescriptor[] = {
 		USB_INTERFACE_DESC_SIZE       +
 		HID_DESC_SIZE                 +
 		USB_ENDPOINT_DESC_SIZE        +
-		USB_ENDPOINT_DESC_SIZE
+		USB_ENDPOINT_DESC_SIZE        +
+		(USB_COMPOSITE_CDC ? USB_CDC_DESCS_SIZE : 0)
 		),
-	0x01, /* bNumInterfaces */
+	1 + (USB_COMPOSITE_CDC ? 2 : 0), /* bNumInterfaces */
 	0x01, /* bConfigurationValue */
 	0x00, /* iConfiguration */
 	USB_CONFIG_BUS_POWERED | USB_CONFIG_REMOTE_WAKEUP, /* bmAttributes */
@@ -1005,7 +543,7 @@ ALIGNED(4) uint8_t USB_FsConfigDescriptor[] = {
 	/* Interface 0, Alternate Setting 0, HID Class */
 	USB_INTERFACE_DESC_SIZE, /* bLength */
 	USB_INTERFACE_DESCRIPTOR_TYPE, /* bDescriptorType */
-	0x00, /* bInterfaceNumber */
+	USB_HID_IF_NUM, /* bInterfaceNumber */
 	0x00, /* bAlternateSetting */
 	0x02, /* bNumEndpoints */
 	USB_DEVICE_CLASS_HUMAN_INTERFACE, /* bInterfaceClass */
@@ -1022,21 +560,27 @@ ALIGNED(4) uint8_t USB_FsConfigDescriptor[] = {
 	HID_REPORT_DESCRIPTOR_TYPE, /* bDescriptorType */
 	WBVAL(sizeof(PowerAReportDescriptor)), /* wDescriptorLength */
 
-	/* Endpoint, HID Interrupt In */
+	/* Endpoint, HID Interrupt Out */
 	USB_ENDPOINT_DESC_SIZE, /* bLength */
 	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */
 	HID_EP_OUT, /* bEndpointAddress */
 	USB_ENDPOINT_TYPE_INTERRUPT, /* bmAttributes */
 	WBVAL(0x0040), /* wMaxPacketSize */
-	8, /* bInterval */
+	HID_REPORT_INTERVAL_MS, /* bInterval */
 
-	/* Endpoint, HID Interrupt Out */
+	/* Endpoint, HID Interrupt In */
 	USB_ENDPOINT_DESC_SIZE, /* bLength */
 	USB_ENDPOINT_DESCRIPTOR_TYPE, /* bDescriptorType */
 	HID_EP_IN, /* bEndpointAddress */
 	USB_ENDPOINT_TYPE_INTERRUPT, /* bmAttributes */
 	WBVAL(0x0040), /* wMaxPacketSize */
-	8, /* bInterval */
+	HID_REPORT_INTERVAL_MS, /* bInterval */
+
+#if (USB_COMPOSITE_CDC)
+	// Console for observing and controlling a running controller. Placed
+	//  after HID so HID stays interface 0
+	USB_CDC_DESCS(0x05),
+#endif
 	/* Terminator */
 	0 /* bLength */
 };
@@ -1145,6 +689,15 @@ const uint8_t USB_StringDescriptor[] = {
 	'H', 0,
 	'I', 0,
 	'D', 0,
+#if (USB_COMPOSITE_CDC)
+	/* Index 0x05: CDC Interfaces */
+	(4 * 2 + 2), /* bLength (4 Char + Type + length) */
+	USB_STRING_DESCRIPTOR_TYPE, /* bDescriptorType */
+	'V', 0,
+	'C', 0,
+	'O', 0,
+	'M', 0,
+#endif
 };
 
 // Defines how Direction Pad inputs are encoded in Power A Status Report Packet
@@ -1196,17 +749,69 @@ typedef struct {
 	uint8_t rsvd3;
 } ControllreStatusReport;
 
+/**
+ * Statistics on how evenly reports reach the host and how old the input data
+ *  in them is.
+ */
+typedef struct ReportStats {
+	uint32_t cnt; //!< Number of reports host has taken.
+	uint32_t overruns; //!< Number of report periods skipped because 
+		//!< sampling for the previous one had not finished.
+	uint32_t lastTxUs; //!< getUsTickCnt() when last report was taken.
+	uint32_t minIntervalUs; //!< Shortest time between reports being taken.
+	uint32_t maxIntervalUs; //!< Longest time between reports being taken.
+	uint64_t sumIntervalUs; //!< For average time between reports.
+	uint32_t maxAgeUs; //!< Longest time from start of sampling until host 
+		//!< took the report.
+	uint64_t sumAgeUs; //!< For average data age.
+	uint32_t maxSampleUs; //!< Longest time taken to sample all inputs. 
+		//!< Lead (see reportLead command) should be a bit more than this.
+} ReportStats;
+
 // Combines data related to how we communicate controller state to Nin Switch
 typedef struct {
 	USBD_HANDLE_T hUsb; // Handle to USB stack. 
-	ControllreStatusReport statusReport; // Last report data. Defines
-		// states of inputs on controller.
+	ControllreStatusReport reports[2]; // Report data. Defines states of
+		// inputs on controller. One is built while the other is read.
+	volatile uint8_t latestReport; // Index into reports of last complete
+		// report. Only changed once a report is fully built.
 	volatile uint8_t txBusy; // Flag indicating whether a report is pending
 		// in endpoint queue.
+	bool sampling; // Flag indicating input sampling for next report has
+		// been started.
+	uint32_t samplesPending; // REPORT_EVT_*_DONE events still to be 
+		// received before sampling is complete.
+	bool reportReady; // Flag indicating latest report has been built, 
+		// but not yet queued as endpoint was busy.
+	uint32_t sampleStartUs; // getUsTickCnt() when sampling in progress
+		// was started.
+	uint32_t reportStartUs; // sampleStartUs of data in latest report.
+	uint32_t txStartUs; // sampleStartUs of report queued in endpoint.
+	SwTimer timer; // Delays start of sampling from SOF by part of a frame.
+	uint32_t framesToPoll; // SOFs until frame host is expected to poll for
+		// next report. 0 if not known yet.
+	uint32_t leadFrames; // Number of SOFs before poll frame at which 
+		// timer is started. See setReportLead().
+	uint32_t leadDelayUs; // Delay of timer from SOF to start sampling.
+	uint32_t leadUs; // Time before poll frame starts to start sampling.
+	ReportStats stats; // See reportStats command.
 } ControllerUsbData;
 
 static ControllerUsbData controllerUsbData;
 
+static const uint32_t REPORT_PERIOD_US = HID_REPORT_INTERVAL_MS * 1000; //!< 
+	//!< How often inputs are sampled and a new report is built. Matches
+	//!< rate at which host polls for reports.
+
+#define REPORT_EVT_START (1 << 0) //!< USB configured. Start sending reports.
+#define REPORT_EVT_TX_DONE (1 << 1) //!< Last report was sent to host.
+#define REPORT_EVT_ADC_DONE (1 << 2) //!< ADC update complete.
+#define REPORT_EVT_TPAD_R_DONE (1 << 3) //!< Right trackpad update complete.
+#define REPORT_EVT_TPAD_L_DONE (1 << 4) //!< Left trackpad update complete.
+#define REPORT_EVT_SAMPLES_DONE (REPORT_EVT_ADC_DONE | REPORT_EVT_TPAD_R_DONE \
+	| REPORT_EVT_TPAD_L_DONE) //!< All events that make up input sampling.
+#define REPORT_EVT_TICK (1 << 5) //!< Time to start sampling for next report.
+
 /**
  * Function for converting raw analog X or Y value to analog X or Y value in
  *   range expected by Power A USB control packet. 
@@ -1263,38 +868,45 @@ static uint8_t convToPowerAJoyPos(uint32_t rawVal, uint32_t centerWidth,
  *  Switch. These report(s) give status information on the controller (i.e. 
  *  what buttons are being pressed, what position is the analog stick in).
  *
+ * The report is built in the buffer not currently being handed out, and only
+ *  made the latest once complete. So GET_REPORT, which may interrupt this at
+ *  any point, never sees a half built report.
+ *
+ * Note: ADC and trackpad updates must be complete before this is called.
+ *
  * \return None.
  */
 static void updateReports(void) {
-	// Start long conversions run via IRQs
-	updateAdcVals();
-	trackpadLocUpdate(L_TRACKPAD);
-	trackpadLocUpdate(R_TRACKPAD);
+	// Capture all buttons at once so report reflects a single instant
+	ButtonSnapshot btns;
+	getButtonSnapshot(&btns);
 
 	// Associate Steam Controller buttons to Switch Controller buttons:
-	controllerUsbData.statusReport.rightTrigger = getRightTriggerState();
-	controllerUsbData.statusReport.leftTrigger = getLeftTriggerState();
-	controllerUsbData.statusReport.rightBumper = getRightBumperState();
-	controllerUsbData.statusReport.leftBumper = getLeftBumperState();
-
-	controllerUsbData.statusReport.xButton = getYButtonState();
-	controllerUsbData.statusReport.aButton = getBButtonState();
-	controllerUsbData.statusReport.bButton = getAButtonState();
-	controllerUsbData.statusReport.yButton = getXButtonState();
-
-	controllerUsbData.statusReport.snapshotButton = getLeftGripState();
-	controllerUsbData.statusReport.homeButton = getSteamButtonState();
-
-	controllerUsbData.statusReport.rightAnalogClick = getRightTrackpadClickState();
-	controllerUsbData.statusReport.leftAnalogClick = getJoyClickState();
-	controllerUsbData.statusReport.plusButton = getFrontRightButtonState();
-	controllerUsbData.statusReport.minusButton = getFrontLeftButtonState();
+	uint8_t build_idx = !controllerUsbData.latestReport;
+	ControllreStatusReport* report = &controllerUsbData.reports[build_idx];
+	report->rightTrigger = BUTTON_PRESSED(&btns, BTN_R_TRIGGER);
+	report->leftTrigger = BUTTON_PRESSED(&btns, BTN_L_TRIGGER);
+	report->rightBumper = BUTTON_PRESSED(&btns, BTN_R_BUMPER);
+	report->leftBumper = BUTTON_PRESSED(&btns, BTN_L_BUMPER);
+
+	report->xButton = BUTTON_PRESSED(&btns, BTN_Y);
+	report->aButton = BUTTON_PRESSED(&btns, BTN_B);
+	report->bButton = BUTTON_PRESSED(&btns, BTN_A);
+	report->yButton = BUTTON_PRESSED(&btns, BTN_X);
+
+	report->snapshotButton = BUTTON_PRESSED(&btns, BTN_L_GRIP);
+	report->homeButton = BUTTON_PRESSED(&btns, BTN_STEAM);
+
+	report->rightAnalogClick = BUTTON_PRESSED(&btns, BTN_R_TPAD_CLICK);
+	report->leftAnalogClick = BUTTON_PRESSED(&btns, BTN_JOY_CLICK);
+	report->plusButton = BUTTON_PRESSED(&btns, BTN_FRONT_R);
+	report->minusButton = BUTTON_PRESSED(&btns, BTN_FRONT_L);
 
 	// Analog Joystick is Left Analog:
-	controllerUsbData.statusReport.leftAnalogX = convToPowerAJoyPos(
+	report->leftAnalogX = convToPowerAJoyPos(
 		JOYSTICK_MAX_X-getAdcVal(ADC_JOYSTICK_X), 128, JOYSTICK_MAX_X/2,
 		JOYSTICK_MAX_X);
-	controllerUsbData.statusReport.leftAnalogY = convToPowerAJoyPos(
+	report->leftAnalogY = convToPowerAJoyPos(
 		JOYSTICK_MAX_Y-getAdcVal(ADC_JOYSTICK_Y), 128, JOYSTICK_MAX_Y/2,
 		JOYSTICK_MAX_Y);
 
@@ -1302,49 +914,125 @@ static void updateReports(void) {
 	uint16_t tpad_y = 0;
 
 	// Default to neutral position
-	controllerUsbData.statusReport.dPad = DPAD_NEUTRAL;
+	report->dPad = DPAD_NEUTRAL;
 
 	// Have Left Trackpad act as DPAD:
 	// Only check (and convert) finger position to DPAD location on click
-	if (getLeftTrackpadClickState()) {
+	if (BUTTON_PRESSED(&btns, BTN_L_TPAD_CLICK)) {
 
 		trackpadGetLastXY(L_TRACKPAD, &tpad_x, &tpad_y);
 
 		if (tpad_x > TPAD_MAX_X * 3/8 && tpad_x < TPAD_MAX_X * 5/8) {
 			if (tpad_y > TPAD_MAX_Y * 3/8 && tpad_y < TPAD_MAX_Y * 5/8) {
-				controllerUsbData.statusReport.dPad = DPAD_NEUTRAL;
+				report->dPad = DPAD_NEUTRAL;
 			} else if (tpad_y <= TPAD_MAX_Y * 3/8) {
-				controllerUsbData.statusReport.dPad = DPAD_DOWN;
+				report->dPad = DPAD_DOWN;
 			} else {
-				controllerUsbData.statusReport.dPad = DPAD_UP;
+				report->dPad = DPAD_UP;
 			}
 		} else if (tpad_x <= TPAD_MAX_X * 3/8) {
 			// Put more emphasis into cardinal directions
 			if (tpad_y > TPAD_MAX_Y * 2/8 && tpad_y < TPAD_MAX_Y * 6/8) {
-				controllerUsbData.statusReport.dPad = DPAD_LEFT;
+				report->dPad = DPAD_LEFT;
 			} else if (tpad_y <= TPAD_MAX_Y * 2/8) {
-				controllerUsbData.statusReport.dPad = DPAD_DOWN_LEFT;
+				report->dPad = DPAD_DOWN_LEFT;
 			} else {
-				controllerUsbData.statusReport.dPad = DPAD_UP_LEFT;
+				report->dPad = DPAD_UP_LEFT;
 			}
 		} else {
 			// Put more emphasis into cardinal directions
 			if (tpad_y > TPAD_MAX_Y * 2/8 && tpad_y < TPAD_MAX_Y * 6/8) {
-				controllerUsbData.statusReport.dPad = DPAD_RIGHT;
+				report->dPad = DPAD_RIGHT;
 			} else if (tpad_y <= TPAD_MAX_Y * 2/8) {
-				controllerUsbData.statusReport.dPad = DPAD_DOWN_RIGHT;
+				report->dPad = DPAD_DOWN_RIGHT;
 			} else {
-				controllerUsbData.statusReport.dPad = DPAD_UP_RIGHT;
+				report->dPad = DPAD_UP_RIGHT;
 			}
 		}
 	}
 
 	// Have Right Trackpad act as Right Analog:
 	trackpadGetLastXY(R_TRACKPAD, &tpad_x, &tpad_y);
-	controllerUsbData.statusReport.rightAnalogX = convToPowerAJoyPos(tpad_x, 
+	report->rightAnalogX = convToPowerAJoyPos(tpad_x, 
 		0, TPAD_MAX_X/2, TPAD_MAX_X);
-	controllerUsbData.statusReport.rightAnalogY = convToPowerAJoyPos(
+	report->rightAnalogY = convToPowerAJoyPos(
 		 TPAD_MAX_Y - tpad_y, 0, TPAD_MAX_Y/2, TPAD_MAX_Y);
+
+	// Single byte write, so readers see either old or new report
+	controllerUsbData.latestReport = build_idx;
+}
+
+/**
+ * Convert one side of HD Rumble data (as sent by Switch to its controllers) 
+ *  to haptic pulse parameters. HD Rumble encodes a high and a low frequency
+ *  band, each with their own amplitude. Haptics can only generate a single
+ *  frequency, so the band with the larger amplitude is used.
+ *
+ * \param[in] data 4 bytes of HD Rumble data.
+ * \param[out] freq Frequency to pulse haptic at in Hz.
+ * \param[out] dutyCycle Duty cycle for haptic pulses. 0 means no rumble.
+ *
+ * \return None.
+ */
+static void convHdRumble(const uint8_t* data, uint16_t* freq, 
+	uint8_t* dutyCycle) {
+	// 2^(idx/32) in Q10 format. Used to decode exponential frequency code
+	static const uint16_t EXP2_Q10[32] = {
+		1024, 1046, 1069, 1093, 1117, 1141, 1166, 1192, 
+		1218, 1244, 1272, 1300, 1328, 1357, 1387, 1417, 
+		1448, 1480, 1512, 1545, 1579, 1614, 1649, 1685, 
+		1722, 1760, 1798, 1838, 1878, 1919, 1961, 2004
+	};
+
+	// Byte 0 and bit 0 of Byte 1 are the high band frequency code, 
+	//  remainder of Byte 1 is the high band amplitude
+	uint32_t hf_code = ((((data[1] & 0x01) << 8) | data[0]) >> 2) + 0x60;
+	uint32_t hf_amp = (data[1] & 0xfe) >> 1;
+	// Byte 2 bits 6:0 are the low band frequency code, bit 7 of Byte 2 
+	//  and Byte 3 are the low band amplitude (offset by 0x40)
+	uint32_t lf_code = (data[2] & 0x7f) + 0x40;
+	uint32_t lf_amp = (((data[2] & 0x80) << 1) | data[3]);
+	lf_amp = lf_amp > 0x40 ? (lf_amp - 0x40) * 2 : 0;
+
+	uint32_t code = hf_code;
+	uint32_t amp = hf_amp;
+	if (lf_amp > hf_amp) {
+		code = lf_code;
+		amp = lf_amp;
+	}
+
+	// Amplitude code of 100 is maximum the Switch uses
+	if (amp > 100) {
+		amp = 100;
+	}
+
+	// freq = 10 * 2^(code/32)
+	*freq = ((10 * EXP2_Q10[code & 0x1f]) << (code >> 5)) >> 10;
+	*dutyCycle = (amp * 255) / 100;
+}
+
+/**
+ * Handle an Output Report from host. Output Report contains HD Rumble data 
+ *  for left and right sides, which is converted and handed off to haptics.
+ *
+ * \param[in] data Output Report data.
+ * \param len Number of bytes in data.
+ *
+ * \return None.
+ */
+static void handleRumbleReport(const uint8_t* data, uint32_t len) {
+	if (len < 8) {
+		return;
+	}
+
+	uint16_t freq = 0;
+	uint8_t duty_cycle = 0;
+
+	convHdRumble(&data[0], &freq, &duty_cycle);
+	setHapticRumble(L_HAPTIC, freq, duty_cycle);
+
+	convHdRumble(&data[4], &freq, &duty_cycle);
+	setHapticRumble(R_HAPTIC, freq, duty_cycle);
 }
 
 /**
@@ -1356,8 +1044,13 @@ static ErrorCode_t ControllerGetReport(USBD_HANDLE_T hHid,
 	// ReportID = SetupPacket.wValue.WB.L
 	switch (pSetup->wValue.WB.H) {
 	case HID_REPORT_INPUT:
-		updateReports();
-		*pBuffer = (uint8_t*)&controllerUsbData.statusReport;
+		// Sampling inputs takes too long for a control request, so
+		//  hand back the last complete report built by report task. 
+		//  Report fits in a single EP0 packet, which is copied out 
+		//  before we return from this interrupt, so the next build 
+		//  cannot overwrite it while it is being sent
+		*pBuffer = (uint8_t*)
+			&controllerUsbData.reports[controllerUsbData.latestReport];
 		*plength = sizeof(ControllreStatusReport);
 		break;
 
@@ -1382,8 +1075,11 @@ static ErrorCode_t ControllerSetReport(USBD_HANDLE_T hHid,
 
 	// ReportID = SetupPacket.wValue.WB.L;
 	switch (pSetup->wValue.WB.H) {
+	case HID_REPORT_OUTPUT:
+		handleRumbleReport(*pBuffer, length);
+		break;
+
 	case HID_REPORT_INPUT: /* Not Supported */
-	case HID_REPORT_OUTPUT: /* Not Supported */
 	case HID_REPORT_FEATURE: /* Not Supported */
 		return ERR_USBD_STALL;
 	}
@@ -1400,14 +1096,244 @@ static ErrorCode_t ControllerEpInHandler(USBD_HANDLE_T hUsb, void *data,
 	switch (event) {
 	case USB_EVT_IN:
 		// USB_EVT_IN occurs when HW completes sending IN packet. So 
-		//  clear the busy flag for main loop to queue next packet.
-		controllerUsbData.txBusy = 0;
+		//  let report task know it can queue next packet.
+		// The host polls every bInterval frames, so this also tells
+		//  us which frame it will poll in next
+		controllerUsbData.framesToPoll = HID_REPORT_INTERVAL_MS;
+		postTaskEvent(TASK_REPORT, REPORT_EVT_TX_DONE);
 		break;
 	}
 
 	return LPC_OK;
 }
 
+/**
+ * HID interrupt OUT endpoint handler 
+ */
+static ErrorCode_t ControllerEpOutHandler(USBD_HANDLE_T hUsb, void *data, 
+	uint32_t event) {
+
+	uint8_t report[USB_FS_MAX_BULK_PACKET];
+
+	switch (event) {
+	case USB_EVT_OUT:
+		handleRumbleReport(report, 
+			USBD_API->hw->ReadEP(hUsb, HID_EP_OUT, report));
+		break;
+	}
+
+	return LPC_OK;
+}
+
+/**
+ * USB Start of Frame Event Callback. Called at start of every 1ms frame. Once
+ *  we know which frames the host polls for reports in, sampling is started
+ *  leadUs before the start of the poll frame so that a fresh report is queued
+ *  just before the host asks for it.
+ */
+static ErrorCode_t ControllerSofEvent(USBD_HANDLE_T hUsb) {
+	ControllerUsbData* data = &controllerUsbData;
+
+	if (!data->framesToPoll) {
+		return LPC_OK;
+	}
+
+	if (!--data->framesToPoll) {
+		data->framesToPoll = HID_REPORT_INTERVAL_MS;
+	}
+
+	if (data->framesToPoll == data->leadFrames) {
+		if (data->leadDelayUs) {
+			startSwTimer(&data->timer, data->leadDelayUs, 0);
+		} else {
+			postTaskEvent(TASK_REPORT, REPORT_EVT_TICK);
+		}
+	}
+
+	return LPC_OK;
+}
+
+/**
+ * USB Configure Event Callback. Called once host has configured device, at
+ *  which point reports can start being sent.
+ */
+static ErrorCode_t ControllerConfigureEvent(USBD_HANDLE_T hUsb) {
+	postTaskEvent(TASK_REPORT, REPORT_EVT_START);
+
+	return LPC_OK;
+}
+
+/**
+ * SwTimer callback that starts sampling of inputs for reports part way
+ *  through a frame.
+ *
+ * \param[in] ctx Not used.
+ *
+ * \return None.
+ */
+static void reportTimerTick(void* ctx) {
+	postTaskEvent(TASK_REPORT, REPORT_EVT_TICK);
+}
+
+/**
+ * Set how long before the start of the frame the host polls in that input
+ *  sampling is started.
+ *
+ * \param leadUs Lead in us. Clamped to 1 to REPORT_PERIOD_US.
+ *
+ * \return None.
+ */
+static void setReportLead(uint32_t leadUs) {
+	ControllerUsbData* data = &controllerUsbData;
+
+	if (leadUs < 1) {
+		leadUs = 1;
+	} else if (leadUs > REPORT_PERIOD_US) {
+		leadUs = REPORT_PERIOD_US;
+	}
+
+	// Start timer in SOF that is whole frames before the poll frame, and
+	//  have it fire for the remainder
+	uint32_t lead_frames = (leadUs + 999) / 1000;
+
+	IrqMaskState mask_state = enterIrqMask(IRQ_MASK_USB);
+	data->leadUs = leadUs;
+	data->leadFrames = lead_frames;
+	data->leadDelayUs = lead_frames * 1000 - leadUs;
+	exitIrqMask(mask_state);
+}
+
+/**
+ * Reset report statistics.
+ *
+ * \return None.
+ */
+static void resetReportStats(void) {
+	ReportStats* stats = &controllerUsbData.stats;
+
+	memset(stats, 0, sizeof(*stats));
+	stats->minIntervalUs = UINT32_MAX;
+}
+
+/**
+ * Update statistics once host has taken a report.
+ *
+ * \param nowUs getUsTickCnt() at time report was taken.
+ *
+ * \return None.
+ */
+static void updateReportStats(uint32_t nowUs) {
+	ControllerUsbData* data = &controllerUsbData;
+	ReportStats* stats = &data->stats;
+
+	uint32_t age = nowUs - data->txStartUs;
+	stats->sumAgeUs += age;
+	if (age > stats->maxAgeUs) {
+		stats->maxAgeUs = age;
+	}
+
+	// No interval for the first report
+	if (stats->cnt++) {
+		uint32_t interval = nowUs - stats->lastTxUs;
+		stats->sumIntervalUs += interval;
+		if (interval < stats->minIntervalUs) {
+			stats->minIntervalUs = interval;
+		}
+		if (interval > stats->maxIntervalUs) {
+			stats->maxIntervalUs = interval;
+		}
+	}
+	stats->lastTxUs = nowUs;
+}
+
+/**
+ * Task that builds and queues reports to be sent to the Switch. Sampling of
+ *  all inputs is kicked off from the USB start of frame interrupt leadUs 
+ *  before the frame the host will next poll in (see ControllerSofEvent()), so
+ *  the report is built and queued just before the host asks for it. The
+ *  first report after configuration is sampled right away, as the host's 
+ *  polling phase is only learned once it takes a report. If the host has not
+ *  taken the previous report yet, the new one is queued as soon as it does,
+ *  and is replaced if another one is built first. Nothing here blocks, so 
+ *  other tasks progress while inputs are being sampled.
+ *
+ * \param events REPORT_EVT_* flags.
+ *
+ * \return None.
+ */
+static void reportTask(uint32_t events) {
+	ControllerUsbData* data = &controllerUsbData;
+	uint32_t now = getUsTickCnt();
+
+	if (!USB_IsConfigured(data->hUsb)) {
+		// Reset state if we get disconnected. Reports start again on
+		//  next configure event
+		data->framesToPoll = 0;
+		stopSwTimer(&data->timer);
+		data->txBusy = 0;
+		data->sampling = false;
+		data->samplesPending = 0;
+		data->reportReady = false;
+		return;
+	}
+
+	if (events & REPORT_EVT_START) {
+		data->txBusy = 0;
+		data->reportReady = false;
+		data->stats.lastTxUs = now;
+		events |= REPORT_EVT_TICK;
+	}
+
+	if (events & REPORT_EVT_TX_DONE) {
+		data->txBusy = 0;
+		updateReportStats(now);
+	}
+
+	if (events & REPORT_EVT_TICK) {
+		if (data->sampling) {
+			// Conversions take longer than lead or a period. Let them 
+			//  finish
+			data->stats.overruns++;
+		} else {
+			// Start long conversions run via IRQs
+			data->sampling = true;
+			data->samplesPending = REPORT_EVT_SAMPLES_DONE;
+			data->sampleStartUs = now;
+			updateAdcVals();
+			trackpadLocUpdate(L_TRACKPAD);
+			trackpadLocUpdate(R_TRACKPAD);
+		}
+	}
+
+	data->samplesPending &= ~(events & REPORT_EVT_SAMPLES_DONE);
+
+	if (data->sampling && !data->samplesPending) {
+		data->sampling = false;
+
+		uint32_t sample_us = now - data->sampleStartUs;
+		if (sample_us > data->stats.maxSampleUs) {
+			data->stats.maxSampleUs = sample_us;
+		}
+
+		// Update report based on board state. WriteEP copies report 
+		//  into USB RAM, so this does not disturb one already queued
+		updateReports();
+		data->reportReady = true;
+		data->reportStartUs = data->sampleStartUs;
+	}
+
+	if (data->reportReady && !data->txBusy) {
+		data->reportReady = false;
+
+		// Send report data
+		data->txBusy = 1;
+		data->txStartUs = data->reportStartUs;
+		usbEpWrite(data->hUsb, HID_EP_IN, 
+			(uint8_t*)&data->reports[data->latestReport], 
+			sizeof(ControllreStatusReport));
+	}
+}
+
 /**
  * HID Controller interface init routine 
  */
@@ -1436,6 +1362,7 @@ static ErrorCode_t ControllerInit(USBD_HANDLE_T hUsb,
 	hid_param.HID_GetReport = ControllerGetReport;
 	hid_param.HID_SetReport = ControllerSetReport;
 	hid_param.HID_EpIn_Hdlr = ControllerEpInHandler;
+	hid_param.HID_EpOut_Hdlr = ControllerEpOutHandler;
 
 	// Init reports_data
 	reports_data[0].len = PowerAReportDescSize;
@@ -1480,9 +1407,11 @@ int usbConfig(void){
 	    to avoid data corruption. Corruption of padding memory doesn’t affect the
 	    stack/program behaviour.
 	 */
-	usb_param.max_num_ep = 2 + 1;
+	usb_param.max_num_ep = (USB_COMPOSITE_CDC ? 4 : 3) + 1;
 	usb_param.mem_base = USB_STACK_MEM_BASE;
 	usb_param.mem_size = USB_STACK_MEM_SIZE;
+	usb_param.USB_Configure_Event = ControllerConfigureEvent;
+	usb_param.USB_SOF_Event = ControllerSofEvent;
 
 	/* Set the USB descriptors */
 	desc.device_desc = (uint8_t *) USB_DeviceDescriptor;
@@ -1496,6 +1425,14 @@ int usbConfig(void){
 	desc.full_speed_desc = USB_FsConfigDescriptor;
 	desc.device_qualifier = 0;
 
+	registerTask(TASK_REPORT, reportTask, TASK_CTX_DEFERRED);
+	initSwTimer(&controllerUsbData.timer, reportTimerTick, NULL);
+	setReportLead(HID_REPORT_LEAD_US);
+	resetReportStats();
+	setAdcUpdateNotify(TASK_REPORT, REPORT_EVT_ADC_DONE);
+	setTrackpadUpdateNotify(R_TRACKPAD, TASK_REPORT, REPORT_EVT_TPAD_R_DONE);
+	setTrackpadUpdateNotify(L_TRACKPAD, TASK_REPORT, REPORT_EVT_TPAD_L_DONE);
+
 	/* USB Initialization */
 	errCode = USBD_API->hw->Init(&usbHandle, &desc, &usb_param);
 	if (LPC_OK != errCode){
@@ -1516,6 +1453,17 @@ int usbConfig(void){
 		return -1;
 	}
 
+#if (USB_COMPOSITE_CDC)
+	// CDC is set up after HID, so HID gets first pick of USB RAM
+	errCode = usbCdcInit(usbHandle, &desc, &usb_param);
+	if (errCode != LPC_OK) {
+		return -1;
+	}
+#endif
+
+	// Sampling is paced off start of frame
+	USBD_API->hw->EnableEvent(usbHandle, 0, USB_EVT_SOF, 1);
+
 	/*  enable USB interrupts */
 	NVIC_EnableIRQ(USB0_IRQn);
 	/* now connect */
@@ -1525,61 +1473,101 @@ int usbConfig(void){
 }
 
 /**
- * If applicable get all the latest state information for the controller and
- *  send an updated status packet to the Switch via USB.
- * 
+ * Print command usage details to console.
+ *
  * \return None.
  */
-void updateControllerStatusPacket(void) {
-	// check device is configured before sending report.
-	if (USB_IsConfigured(controllerUsbData.hUsb)) {
-		if (controllerUsbData.txBusy == 0) {
-			// Update report based on board state
-			updateReports();
-
-			// Send report data
-			controllerUsbData.txBusy = 1;
-			USBD_API->hw->WriteEP(controllerUsbData.hUsb, HID_EP_IN, 
-				(uint8_t*)&controllerUsbData.statusReport, 
-				sizeof(ControllreStatusReport));
-		}
-	} else {
-		// Reset busy flag if we get disconnected
-		controllerUsbData.txBusy = 0;
-	}
+void reportStatsCmdUsage(void) {
+	printf(
+		"usage: reportStats [reset]\n"
+		"\n"
+		"Print how evenly reports have been taken by the host and how old\n"
+		" the input data in them was, or reset the statistics.\n"
+	);
 }
 
 /**
- * Not used in this build configuration.
+ * Print or reset report timing statistics.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
  */
-int usb_flush(void) {
-	return 0;
-}
+int reportStatsCmdFnc(int argc, const char* argv[]) {
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset"))) {
+		reportStatsCmdUsage();
+		return -1;
+	}
+
+	// Keep reportTask from updating stats part way through, so that they 
+	//  are consistent with each other
+	ReportStats stats;
+	bool unlock = lockDeferredTasks();
+	if (argc == 2) {
+		resetReportStats();
+	} else {
+		stats = controllerUsbData.stats;
+	}
+	if (unlock) {
+		unlockDeferredTasks();
+	}
+
+	if (argc == 2) {
+		return 0;
+	}
+
+	printf("Period: %u us. Reports: %u. Overruns: %u.\n", REPORT_PERIOD_US,
+		stats.cnt, stats.overruns);
+	if (stats.cnt > 1) {
+		printf("Interval us: min %u avg %u max %u\n", 
+			stats.minIntervalUs, 
+			(uint32_t)(stats.sumIntervalUs / (stats.cnt - 1)),
+			stats.maxIntervalUs);
+	}
+	if (stats.cnt) {
+		printf("Data age us: avg %u max %u\n", 
+			(uint32_t)(stats.sumAgeUs / stats.cnt), stats.maxAgeUs);
+	}
+	printf("Sampling us: max %u\n", stats.maxSampleUs);
 
-/**
- * Not used in this build configuration.
- */
-int usb_putc(int character) {
 	return 0;
 }
 
 /**
- * Not used in this build configuration.
+ * Print command usage details to console.
+ *
+ * \return None.
  */
-void usb_putb(const char* buff, uint32_t len) {
+void reportLeadCmdUsage(void) {
+	printf(
+		"usage: reportLead [us]\n"
+		"\n"
+		"Print or set how long before the frame the host polls for a report in\n"
+		" that input sampling is started. Should be a little more than max\n"
+		" sampling time shown by reportStats. Limited to 1 to %u us.\n",
+		REPORT_PERIOD_US
+	);
 }
 
 /**
- * Not used in this build configuration.
+ * Print or set lead of input sampling ahead of host polling for reports.
+ *
+ * \param argc Number of arguments (i.e. size of argv)
+ * \param argv Command line entry broken into array argument strings.
+ *
+ * \return 0 on success.
  */
-int usb_tstc(void) {
-	return 0;
-}
+int reportLeadCmdFnc(int argc, const char* argv[]) {
+	if (argc == 2) {
+		setReportLead(strtoul(argv[1], NULL, 0));
+	} else if (argc != 1) {
+		reportLeadCmdUsage();
+		return -1;
+	}
+
+	printf("Lead: %u us\n", controllerUsbData.leadUs);
 
-/**
- * Not used in this build configuration.
- */
-int usb_getc(void) {
 	return 0;
 }
 #endif
@@ -0,0 +1,879 @@
+/**
+ * \file usb_cdc.c
+ * \brief This encapsulates the USB CDC ACM interface that acts as a virtual
+ *  UART for the console. The source here is a mix of example code from the
+ *  nxp_lpcxpresso_11u37_usbd_rom_cdc_uart example and originally created 
+ *  source. I am including only NXP's license for simplcity. 
+ *
+ * @note
+ * Copyright(C) NXP Semiconductors, 2013 and Gregory Gluszek 2017 (modifications)
+ * All rights reserved.
+ *
+ * @par
+ * Software that is described herein is for illustrative purposes only
+ * which provides customers with programming information regarding the
+ * LPC products.  This software is supplied "AS IS" without any warranties of
+ * any kind, and NXP Semiconductors and its licensor disclaim any and
+ * all warranties, express or implied, including all implied warranties of
+ * merchantability, fitness for a particular purpose and non-infringement of
+ * intellectual property rights.  NXP Semiconductors assumes no responsibility
+ * or liability for the use of the software, conveys no license or rights under any
+ * patent, copyright, mask work right, or any other intellectual property rights in
+ * or to any products. NXP Semiconductors reserves the right to make changes
+ * in the software without notification. NXP Semiconductors also makes no
+ * representation or warranty that such application will be suitable for the
+ * specified use without further testing or modification.
+ *
+ * @par
+ * Permission to use, copy, modify, and distribute this software and its
+ * documentation is hereby granted, under NXP Semiconductors' and its
+ * licensor's relevant copyrights in the software, without fee, provided that it
+ * is used in conjunction with NXP Semiconductors microcontrollers.  This
+ * copyright, permission, and disclaimer notice must appear in all copies of
+ * this code.
+ */
+
+#include "usb_cdc.h"
+
+#include "usb.h"
+#include "sched.h"
+#include "time.h"
+#include "led_ctrl.h"
+#include "irq_mask.h"
+
+#include "chip.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#if (__REDLIB_INTERFACE_VERSION__ >= 20000)
+/* We are using new Redlib_v2 semihosting interface */
+	#define WRITEFUNC __sys_write
+	#define READFUNC __sys_readc
+#else
+/* We are using original Redlib semihosting interface */
+	#define WRITEFUNC __write
+	#define READFUNC __readc
+#endif
+
+#if (USB_CDC_CONSOLE)
+
+#define USB_UART_RX_NUM_SLOTS (4) //!< Number of packets rxFifo can hold. 
+	//!< This must be a power of 2!
+
+// Structure containing Virtual Comm port control data.
+typedef struct {
+	USBD_HANDLE_T usbHandle; //!< Handle to USB device stack 
+	USBD_HANDLE_T cdcHandle; //!< Handle to Communications Device Class controller
+
+	uint8_t* rxFifo; //!< Buffer split into USB_UART_RX_NUM_SLOTS packet
+		//!< slots which store data received via USB CDC UART. A whole 
+		//!< slot is used per packet, as ReadEP can return up to 
+		//!< USB_MAX_PACKET_SZ bytes and we don't know ahead of time how 
+		//!< many we are actually getting.
+	uint8_t rxLens[USB_UART_RX_NUM_SLOTS]; //!< Number of bytes received in
+		//!< each slot.
+	volatile uint32_t rxWrSlot; //!< Free running count of packets 
+		//!< received. Masked to get slot next packet is stored in.
+	volatile uint32_t rxRdSlot; //!< Free running count of packets fully
+		//!< read. Masked to get slot next character is read from. If 
+		//!< rxRdSlot == rxWrSlot FIFO is empty.
+	uint32_t rxRdIdx; //!< Defines where next character is read from in 
+		//!< slot rxRdSlot.
+	volatile bool rxStalled; //!< Flag that we did not have a free slot for
+		//!< incoming packet and did not call ReadEP. OUT EP is only 
+		//!< rearmed by ReadEP, so host is NAKed (and keeps retrying) 
+		//!< until a slot frees up and ReadEP is called. No data is lost.
+
+	volatile int txBusy; //!< Indicates transmission is in progress. This 
+		//!< does not guarantee that txFifo will be drained (use 
+		//!< usb_flush() for this).
+	uint8_t* txFifo; //!< Buffer treated as a ring which stores character
+		//!< data to be transmitted via USB CDC UART
+	uint8_t* txPacket; //!< Buffer for a packet that wraps around end of 
+		//!< txFifo. 
+	volatile uint32_t txRdIdx; //!< Free running count of bytes sent. Masked
+		//!< to get where the next byte to send exists in txFifo.
+	volatile uint32_t txWrIdx; //!< Free running count of bytes queued. 
+		//!< Masked to get where next byte will be put in txFifo.
+	volatile uint32_t txFlushIdx; //!< txWrIdx when usb_flush() was last 
+		//!< called. Bytes before this are sent even if they do not fill
+		//!< a packet.
+	uint32_t txSent; //!< Number of bytes WriteEP reports it last 
+		//!< sent.
+	SwTimer txFlushTimer; //!< Flushes bytes that have not filled a packet
+		//!< after USB_UART_FLUSH_DELAY_US.
+	volatile bool dtr; //!< Host has set DTR via SET_CONTROL_LINE_STATE 
+		//!< (i.e. a terminal has the port open).
+} UsbUartData;
+
+static const uint32_t USB_MAX_PACKET_SZ = USB_FS_MAX_BULK_PACKET; //!< Maximum 
+	//!< number of bytes in packet that can be sent or received via USB.
+
+static const uint32_t USB_UART_TXFIFO_SZ = 256; //!< Number of bytes in txFifo.
+	//!< This must be a power of 2!
+static const uint32_t USB_UART_FLUSH_DELAY_US = 1000; //!< How long bytes can 
+	//!< wait in txFifo for more to fill a packet before being sent anyway.
+
+static const uint32_t USB_UART_RXFIFO_SZ = USB_UART_RX_NUM_SLOTS *
+	USB_FS_MAX_BULK_PACKET; //!< Number of bytes in rxFifo.
+static const uint32_t USB_UART_TX_TIMEOUT_US = 100000; //!< How long to wait
+	//!< for room in txFifo or a transmission to finish before giving up 
+	//!< (i.e. host has port open, but is not reading).
+
+#define CDC_CTRL_LINE_DTR (1 << 0) //!< DTR bit of SET_CONTROL_LINE_STATE 
+	//!< wValue.
+
+static UsbUartData usbUartData; //!< Virtual Comm port control data 
+	//!< instance. 
+
+// All EP accesses happen in usbCdcTask(). The USB IRQ, txFlushTimer and 
+//  thread only post these events to it. This way there is a single owner of
+//  EP and index state, so USB IRQ is only masked for the duration of ROM EP
+//  calls (see usbEpWrite()), and console traffic is always handled after 
+//  TASK_REPORT. In a
+//  USB_COMPOSITE_CDC build this keeps the console from ever delaying HID 
+//  reports.
+#define CDC_EVT_RX (1 << 0) //!< Packet received, or slot freed for a packet 
+	//!< the host is being NAKed for.
+#define CDC_EVT_TX (1 << 1) //!< Data queued or flushed. Start sending.
+#define CDC_EVT_TX_DONE (1 << 2) //!< Last packet was sent to host.
+#define CDC_EVT_TX_FLUSH (1 << 3) //!< txFlushTimer expired.
+
+/**
+ * \param[in] uartData Contains details on Virtual Comm to transmit via.
+ *
+ * \return The number of bytes in txFifo ready to be sent.
+ */
+static uint32_t usbTxFifoNumBytes(const UsbUartData* uartData) {
+	return uartData->txWrIdx - uartData->txRdIdx;
+}
+
+/**
+ * \param[in] uartData Contains details on Virtual Comm.
+ *
+ * \return True if host is configured and has the port open (DTR set), so 
+ *  it is worth waiting for room in txFifo.
+ */
+static bool usbHostListening(const UsbUartData* uartData) {
+	return uartData->dtr && USB_IsConfigured(uartData->usbHandle);
+}
+
+/**
+ * Start a transmission of the next packet of txFifo data. Only full packets
+ *  are sent, unless usb_flush() was called for the data. This will do nothing
+ *  if a transmission is already in progress or there is not enough data. 
+ *  Completion of a transmission starts the next one (see CDC_EVT_TX_DONE).
+ *  Only called from usbCdcTask().
+ *
+ * \param[inout] uartData Contains details on Virtual Comm to transmit via.
+ *
+ * \return None.
+ */
+static void usbUartTxStart(UsbUartData* uartData) {
+	uint32_t bytes_to_send = usbTxFifoNumBytes(uartData);
+	bool flush = (int32_t)(uartData->txFlushIdx - uartData->txRdIdx) > 0;
+
+	// Make sure we are not already busy and actually have data to send
+	if (uartData->txBusy || !bytes_to_send || 
+		(bytes_to_send < USB_MAX_PACKET_SZ && !flush) ||
+		!USB_IsConfigured(uartData->usbHandle)) {
+		return;
+	}
+
+	// Seems we can enter an error state (i.e. interrupt does not fire or
+	//  keeps firing continuously) if we tell WriteEP() that it should send
+	//  number of bytes larger than what is specified for wMaxPacketSize
+	if (bytes_to_send > USB_MAX_PACKET_SZ) {
+		bytes_to_send = USB_MAX_PACKET_SZ;
+	}
+
+	// Packets are sent straight from txFifo, except when they wrap around
+	//  the end of it
+	uint32_t rd_idx = uartData->txRdIdx & (USB_UART_TXFIFO_SZ - 1);
+	uint8_t* packet = &uartData->txFifo[rd_idx];
+	uint32_t contig_bytes = USB_UART_TXFIFO_SZ - rd_idx;
+	if (bytes_to_send > contig_bytes) {
+		memcpy(uartData->txPacket, packet, contig_bytes);
+		memcpy(&uartData->txPacket[contig_bytes], uartData->txFifo, 
+			bytes_to_send - contig_bytes);
+		packet = uartData->txPacket;
+	}
+
+	// Send the data to the USB EP (CDC_EVT_TX_DONE will adjust txRdIdx)
+	uartData->txSent = usbEpWrite(uartData->usbHandle, USB_CDC_IN_EP, 
+		packet, bytes_to_send);
+
+	// Just in case something went wrong
+	uartData->txBusy = uartData->txSent != 0;
+}
+
+/**
+ * SwTimer callback to send bytes that have waited too long for a packet to
+ *  fill up.
+ *
+ * \param[in] ctx Not used.
+ *
+ * \return None.
+ */
+static void usbTxFlushTimeout(void* ctx) {
+	postTaskEvent(TASK_USB_CDC, CDC_EVT_TX_FLUSH);
+}
+
+/**
+ * WaitCond that is met once there is room in txFifo.
+ *
+ * \param[in] ctx Contains details on Virtual Comm.
+ *
+ * \return True if txFifo is not full.
+ */
+static bool usbTxFifoNotFull(void* ctx) {
+	return usbTxFifoNumBytes((const UsbUartData*)ctx) < USB_UART_TXFIFO_SZ;
+}
+
+/**
+ * WaitCond that is met once there is room in txFifo, or host closes the port
+ *  and there is no longer any point in waiting for it.
+ *
+ * \param[in] ctx Contains details on Virtual Comm.
+ *
+ * \return True if txFifo is not full or host stopped listening.
+ */
+static bool usbTxCanQueue(void* ctx) {
+	return usbTxFifoNotFull(ctx) || !usbHostListening((const UsbUartData*)ctx);
+}
+
+/**
+ * Drop oldest bytes queued in txFifo to make room for newer ones. Used while
+ *  no host has the port open, so that output never blocks and the most 
+ *  recent output is what gets sent.
+ *
+ * \param[inout] uartData Contains details on Virtual Comm.
+ * \param numBytes Number of bytes to make room for.
+ *
+ * \return Number of bytes dropped.
+ */
+static uint32_t usbTxDropOldest(UsbUartData* uartData, uint32_t numBytes) {
+	// usbCdcTask() owns txRdIdx and txSent, so keep it from running while
+	//  we move things around
+	bool unlock = lockDeferredTasks();
+
+	// Bytes of a packet in flight are still in use until it completes 
+	//  (txSent is 0 otherwise), so drop the ones queued after it
+	uint32_t start = uartData->txRdIdx + uartData->txSent;
+	uint32_t dropped = uartData->txWrIdx - start;
+	if (dropped > numBytes) {
+		dropped = numBytes;
+	}
+
+	if (start == uartData->txRdIdx) {
+		uartData->txRdIdx += dropped;
+	} else {
+		// Close gap by moving bytes that are kept back over dropped ones
+		for (uint32_t idx = start + dropped; idx != uartData->txWrIdx; 
+			idx++) {
+			uartData->txFifo[(idx - dropped) & (USB_UART_TXFIFO_SZ - 1)] =
+				uartData->txFifo[idx & (USB_UART_TXFIFO_SZ - 1)];
+		}
+		uartData->txWrIdx -= dropped;
+
+		int32_t flush_bytes = uartData->txFlushIdx - start;
+		if (flush_bytes > (int32_t)dropped) {
+			uartData->txFlushIdx -= dropped;
+		} else if (flush_bytes > 0) {
+			uartData->txFlushIdx = start;
+		}
+	}
+
+	if (unlock) {
+		unlockDeferredTasks();
+	}
+
+	return dropped;
+}
+
+/**
+ * Copy a block of data into txFifo. A transmission is started as soon as a 
+ *  packet fills up. Anything left over is sent within 
+ *  USB_UART_FLUSH_DELAY_US, or on usb_flush().
+ *
+ * If txFifo is full, this waits for room only while a host is listening (see
+ *  usbHostListening()). Otherwise the oldest bytes are overwritten, so 
+ *  console output never stalls the caller when no terminal is attached.
+ *
+ * \param[in] buff Data to queue.
+ * \param len Number of bytes in buff.
+ *
+ * \return Number of bytes queued. Less than len if txFifo stayed full for 
+ *	USB_UART_TX_TIMEOUT_US, in which case remaining bytes are dropped.
+ */
+static uint32_t usbTxEnqueue(const char* buff, uint32_t len) {
+	uint32_t cnt = 0;
+
+	while (cnt < len) {
+		// Only sleep when FIFO is full, as setting up timeout is more
+		//  work than queuing data
+		if (!usbTxFifoNotFull(&usbUartData)) {
+			if (usbHostListening(&usbUartData) && waitUntil(
+				usbTxCanQueue, &usbUartData, USB_UART_TX_TIMEOUT_US)) {
+				break;
+			}
+			if (!usbHostListening(&usbUartData) && 
+				!usbTxDropOldest(&usbUartData, len - cnt)) {
+				break;
+			}
+		}
+
+		uint32_t wr_idx = usbUartData.txWrIdx & (USB_UART_TXFIFO_SZ - 1);
+		uint32_t num_bytes = len - cnt;
+		uint32_t room = USB_UART_TXFIFO_SZ - usbTxFifoNumBytes(&usbUartData);
+		if (num_bytes > room) {
+			num_bytes = room;
+		}
+		if (num_bytes > USB_UART_TXFIFO_SZ - wr_idx) {
+			num_bytes = USB_UART_TXFIFO_SZ - wr_idx;
+		}
+
+		memcpy(&usbUartData.txFifo[wr_idx], &buff[cnt], num_bytes);
+		usbUartData.txWrIdx += num_bytes;
+		cnt += num_bytes;
+
+		if (!usbUartData.txBusy && 
+			usbTxFifoNumBytes(&usbUartData) >= USB_MAX_PACKET_SZ) {
+			postTaskEvent(TASK_USB_CDC, CDC_EVT_TX);
+		}
+	}
+
+	if (!usbUartData.txFlushTimer.active) {
+		startSwTimer(&usbUartData.txFlushTimer, USB_UART_FLUSH_DELAY_US, 0);
+	}
+
+	return cnt;
+}
+
+/**
+ * Queue character to be transmitted via USB CDC UART. This does not guarantee
+ *  character will be sent upon function return (use usb_flush() to guarantee).
+ *
+ * \param character Character to write out via virtual UART.
+ * 
+ * \return Character queued. EOF if txFifo stayed full for 
+ *	USB_UART_TX_TIMEOUT_US, in which case character is dropped.
+ */
+int usb_putc(int character) {
+	char c = character;
+
+	if (!usbTxEnqueue(&c, 1)) {
+		return EOF;
+	}
+
+	return character;
+}
+
+/**
+ * Queue the data in the buffer for output via USB CDC UART. Useful for cases
+ *  in which we want to only print some characters of a string, or print from
+ *  a buffer that is not necessarily null terminated.
+ *
+ * \param[in] buff Buffer storing data to write out via virtual serial.
+ * \param len Numbers of chars in buff.
+ * 
+ * \return None.
+ */
+void usb_putb(const char* buff, uint32_t len) {
+	usbTxEnqueue(buff, len);
+}
+
+/**
+ * Make sure any character currently in the transmit FIFO are transmitted via
+ *  USB, even if they do not fill a packet.
+ *
+ * \return 0 on success. Function does not wait, data goes out back to back 
+ *  as each packet completes.
+ */
+int usb_flush(void) {
+	usbUartData.txFlushIdx = usbUartData.txWrIdx;
+	postTaskEvent(TASK_USB_CDC, CDC_EVT_TX);
+
+	return 0;
+}
+
+/**
+ * Called by bottom level of printf routine within RedLib C library to print
+ *  characters. 
+ * 
+ * \parma iFileHandle Ignored.
+ * \param[in] pcBuffer Stores characters to be printed.
+ * \parma iLength Number of characters in pcBuffer.
+ * 
+ * \return Number of characters queued for printing.
+ */
+int WRITEFUNC(int iFileHandle, char *pcBuffer, int iLength) {
+	int start_idx = 0;
+
+	for (int idx = 0; idx < iLength; idx++) {
+		// Need to add carriage return after each newline
+		if (pcBuffer[idx] == '\n') {
+			usbTxEnqueue(&pcBuffer[start_idx], idx + 1 - start_idx);
+			usbTxEnqueue("\r", 1);
+			start_idx = idx + 1;
+#if (USB_LINE_FLUSH)
+			usb_flush();
+#endif
+		}
+	}
+
+	usbTxEnqueue(&pcBuffer[start_idx], iLength - start_idx);
+
+	return iLength;
+}
+
+/**
+ * Receive data from the USB CDC UART. This is called when we already know
+ *  that data is waiting for us and ReadEP needs to be called. Only called 
+ *  from usbCdcTask().
+ *
+ * \param[in] uartData Contains details on Virtual Comm to receive from.
+ * 
+ * \return None.
+ */
+static void rcvUartData(UsbUartData* uartData) {
+	// Leave packet in EP (i.e. NAK host) until there is a slot for it
+	if (uartData->rxWrSlot - uartData->rxRdSlot >= USB_UART_RX_NUM_SLOTS) {
+		uartData->rxStalled = true;
+		return;
+	}
+
+	uint32_t slot = uartData->rxWrSlot & (USB_UART_RX_NUM_SLOTS - 1);
+	uint32_t bytes_rcvd = usbEpRead(uartData->usbHandle, USB_CDC_OUT_EP, 
+		&uartData->rxFifo[slot * USB_MAX_PACKET_SZ]);
+	uartData->rxStalled = false;
+
+	// Zero length packets rearm EP, but do not need a slot
+	if (bytes_rcvd) {
+		uartData->rxLens[slot] = bytes_rcvd;
+		uartData->rxWrSlot++;
+	}
+}
+
+/**
+ * Check if there is a character in the USB CDC UART RX FIFO.
+ * 
+ * \return 0 if no character is available.
+ */
+int usb_tstc(void) {
+	return usbUartData.rxRdSlot != usbUartData.rxWrSlot;
+}
+
+/**
+ * WaitCond that is met once there is a character in rxFifo.
+ *
+ * \param[in] ctx Not used.
+ *
+ * \return True if rxFifo is not empty.
+ */
+static bool usbRxFifoNotEmpty(void* ctx) {
+	return usb_tstc();
+}
+
+/**
+ * Copy as many characters as are available (up to len) out of rxFifo. Frees
+ *  slots as they are emptied, receiving any packet the host was NAKed for.
+ *
+ * \param[out] buff Buffer to store received data in.
+ * \param len Maximum number of bytes to read.
+ *
+ * \return Number of bytes read.
+ */
+static uint32_t usbRxDequeue(char* buff, uint32_t len) {
+	uint32_t cnt = 0;
+
+	while (cnt < len && usb_tstc()) {
+		uint32_t slot = usbUartData.rxRdSlot & (USB_UART_RX_NUM_SLOTS - 1);
+		uint32_t num_bytes = usbUartData.rxLens[slot] - usbUartData.rxRdIdx;
+		if (num_bytes > len - cnt) {
+			num_bytes = len - cnt;
+		}
+
+		memcpy(&buff[cnt], &usbUartData.rxFifo[slot * USB_MAX_PACKET_SZ +
+			usbUartData.rxRdIdx], num_bytes);
+		cnt += num_bytes;
+		usbUartData.rxRdIdx += num_bytes;
+
+		if (usbUartData.rxRdIdx < usbUartData.rxLens[slot]) {
+			break;
+		}
+
+		// Slot is empty, hand it back
+		usbUartData.rxRdIdx = 0;
+		usbUartData.rxRdSlot++;
+
+		// If we stalled previously, have the pending packet received
+		if (usbUartData.rxStalled) {
+			postTaskEvent(TASK_USB_CDC, CDC_EVT_RX);
+		}
+	}
+
+	return cnt;
+}
+
+/**
+ * Get a character from the USB CDC UART RX FIFO. This will not return until
+ *  a character is received via USB.
+ * 
+ * \return The next character in the USB CDC UART RX FIFO. Will not return 
+ *  until character is available.
+ */
+int usb_getc(void) {
+	char c = 0;
+
+	// Wait (sleeping) until there is a character
+	waitUntil(usbRxFifoNotEmpty, NULL, WAIT_FOREVER);
+
+	usbRxDequeue(&c, 1);
+
+	return c;
+}
+
+/**
+ * Get a block of (possibly binary) data from the USB CDC UART RX FIFO. Data 
+ *  read this way bypasses console handling.
+ *
+ * \param[out] buff Buffer to store received data in.
+ * \param len Number of bytes to read.
+ * \param timeoutUs Maximum time to wait for each packet to arrive. 
+ *
+ * \return Number of bytes read. Less than len on timeout.
+ */
+uint32_t usb_getb(char* buff, uint32_t len, uint32_t timeoutUs) {
+	uint32_t cnt = 0;
+
+	while (cnt < len) {
+		// Only sleep when FIFO is empty, as setting up timeout is more
+		//  work than taking a packet
+		if (!usb_tstc() && 
+			waitUntil(usbRxFifoNotEmpty, NULL, timeoutUs)) {
+			break;
+		}
+		cnt += usbRxDequeue(&buff[cnt], len - cnt);
+	}
+
+	return cnt;
+}
+
+/**
+ * Called by bottom level of scanf routine within RedLib C library to read
+ *  a character. 
+ *
+ * \return The next character in the USB CDC UART RX FIFO. Will not return 
+ *  until character is available.
+ */
+int READFUNC(void) {
+	return usb_getc();
+}
+
+/**
+ * Task that owns the USB CDC UART EPs. Receives packets into rxFifo and sends
+ *  packets from txFifo.
+ *
+ * \param events CDC_EVT_* flags.
+ *
+ * \return None.
+ */
+static void usbCdcTask(uint32_t events) {
+	UsbUartData* uart_data = &usbUartData;
+
+	// Host has to open port again after being reconfigured
+	if (!USB_IsConfigured(uart_data->usbHandle)) {
+		uart_data->dtr = false;
+	}
+
+	if (events & CDC_EVT_TX_DONE) {
+		uart_data->txRdIdx += uart_data->txSent;
+		uart_data->txSent = 0;
+		uart_data->txBusy = 0;
+	}
+
+	if (events & CDC_EVT_TX_FLUSH) {
+		uart_data->txFlushIdx = uart_data->txWrIdx;
+	}
+
+	// Send next packet right away, without waiting on thread
+	usbUartTxStart(uart_data);
+
+	if (events & CDC_EVT_RX) {
+		uint32_t wr_slot = uart_data->rxWrSlot;
+		rcvUartData(uart_data);
+		if (wr_slot != uart_data->rxWrSlot) {
+			postTaskEvent(TASK_CONSOLE, 1);
+		}
+	}
+}
+
+/**
+ * USB CDC UART bulk EP_IN and EP_OUT endpoints handler. Only lets 
+ *  usbCdcTask() know what happened.
+ *
+ * \param[in] usbHandle Handle to USB device stack.
+ * \param[in] data Not used.
+ * \param event Provides information on transfer event that occurred to trigger
+ *	handler call.
+ *
+ * \return LPC_OK on success.
+ */
+static ErrorCode_t usbUartBulkHandler(USBD_HANDLE_T usbHandle, void* data, 
+	uint32_t event) {
+	switch (event) {
+	// A transfer from us to the USB host that we queued has completed
+	case USB_EVT_IN:
+		postTaskEvent(TASK_USB_CDC, CDC_EVT_TX_DONE);
+		break;
+
+	// We received a transfer from the USB host. 
+	case USB_EVT_OUT:
+		postTaskEvent(TASK_USB_CDC, CDC_EVT_RX);
+		break;
+
+	case ERR_USBD_STALL:
+		setLedIntensity(0);
+		break;
+
+	default:
+		break;
+	}
+
+	return LPC_OK;
+}
+
+/**
+ * USB CDC SET_CONTROL_LINE_STATE request callback. Tracks DTR, which a host
+ *  sets while a terminal has the port open, to decide whether console output
+ *  is worth waiting on (see usbTxEnqueue()).
+ *
+ * \param[in] hCDC Handle to CDC controller.
+ * \param state Control signal bitmap (see CDC_CTRL_LINE_DTR).
+ *
+ * \return LPC_OK on success.
+ */
+static ErrorCode_t usbUartSetCtrlLineState(USBD_HANDLE_T hCDC, uint16_t state)
+{
+	usbUartData.dtr = (state & CDC_CTRL_LINE_DTR) != 0;
+
+	return LPC_OK;
+}
+
+//TODO: better comments
+/* Set line coding call back routine */
+static ErrorCode_t usbUartSetLineCode(USBD_HANDLE_T hCDC, CDC_LINE_CODING *line_coding)
+{
+	uint32_t config_data = 0;
+
+	switch (line_coding->bDataBits) {
+	case 5:
+		config_data |= UART_LCR_WLEN5;
+		break;
+
+	case 6:
+		config_data |= UART_LCR_WLEN6;
+		break;
+
+	case 7:
+		config_data |= UART_LCR_WLEN7;
+		break;
+
+	case 8:
+	default:
+		config_data |= UART_LCR_WLEN8;
+		break;
+	}
+
+	switch (line_coding->bCharFormat) {
+	case 1:	/* 1.5 Stop Bits */
+		/* In the UART hardware 1.5 stop bits is only supported when using 5
+		 * data bits. If data bits is set to 5 and stop bits is set to 2 then
+		 * 1.5 stop bits is assumed. Because of this 2 stop bits is not support
+		 * when using 5 data bits.
+		 */
+		if (line_coding->bDataBits == 5) {
+			config_data |= UART_LCR_SBS_2BIT;
+		}
+		else {
+			return ERR_USBD_UNHANDLED;
+		}
+		break;
+
+	case 2:	/* 2 Stop Bits */
+		/* In the UART hardware if data bits is set to 5 and stop bits is set to 2 then
+		 * 1.5 stop bits is assumed. Because of this 2 stop bits is
+		 * not support when using 5 data bits.
+		 */
+		if (line_coding->bDataBits != 5) {
+			config_data |= UART_LCR_SBS_2BIT;
+		}
+		else {
+			return ERR_USBD_UNHANDLED;
+		}
+		break;
+
+	default:
+	case 0:	/* 1 Stop Bit */
+		config_data |= UART_LCR_SBS_1BIT;
+		break;
+	}
+
+	switch (line_coding->bParityType) {
+	case 1:
+		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_ODD);
+		break;
+
+	case 2:
+		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_EVEN);
+		break;
+
+	case 3:
+		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_F_1);
+		break;
+
+	case 4:
+		config_data |= (UART_LCR_PARITY_EN | UART_LCR_PARITY_F_0);
+		break;
+
+	default:
+	case 0:
+		config_data |= UART_LCR_PARITY_DIS;
+		break;
+	}
+
+	// TODO: Should this still be here...?
+	if (line_coding->dwDTERate < 3125000) {
+		Chip_UART_SetBaud(LPC_USART, line_coding->dwDTERate);
+	}
+	Chip_UART_ConfigData(LPC_USART, config_data);
+
+	return LPC_OK;
+}
+
+/**
+ * Intialize EP on USB to act as virtual UART. Must be called after all 
+ *  interfaces that come before CDC in usbDescs have been initialized, as it
+ *  takes USB memory from usbParams.
+ *
+ * \param[in] usbHandle Handle to USB device stack.
+ * \param[in] usbDescs Points to various descriptors for the USB device, to 
+ *	provide details for EPs on the bus.
+ * \param[inout] usbParams Parameters related to the USB stack (i.e. memory
+ *	to be used by EPs)
+ *
+ * \return LPC_OK on success.
+ */
+ErrorCode_t usbCdcInit(USBD_HANDLE_T usbHandle, 
+	const USB_CORE_DESCS_T *usbDescs, USBD_API_INIT_PARAM_T *usbParams)
+{
+	USBD_CDC_INIT_PARAM_T cdc_param;
+	ErrorCode_t ret = LPC_OK;
+	uint32_t ep_indx;
+	USB_CDC_CTRL_T *pCDC;
+
+	/* Store USB stack handle for future use. */
+	usbUartData.usbHandle = usbHandle;
+	registerTask(TASK_USB_CDC, usbCdcTask, TASK_CTX_DEFERRED);
+	/* Initi CDC params */
+	memset((void *) &cdc_param, 0, sizeof(USBD_CDC_INIT_PARAM_T));
+	cdc_param.mem_base = usbParams->mem_base;
+	cdc_param.mem_size = usbParams->mem_size;
+	cdc_param.cif_intf_desc = (uint8_t*)find_IntfDesc(
+		usbDescs->high_speed_desc, CDC_COMMUNICATION_INTERFACE_CLASS);
+	cdc_param.dif_intf_desc = (uint8_t*)find_IntfDesc(
+		usbDescs->high_speed_desc, CDC_DATA_INTERFACE_CLASS);
+	cdc_param.SetLineCode = usbUartSetLineCode;
+	cdc_param.SetCtrlLineState = usbUartSetCtrlLineState;
+
+	/* Init CDC interface */
+	ret = USBD_API->cdc->init(usbHandle, &cdc_param, &usbUartData.cdcHandle);
+
+	if (ret == LPC_OK) {
+		// Allocate buffer for transmit FIFO
+		usbUartData.txFifo = (uint8_t *) cdc_param.mem_base;
+		cdc_param.mem_base += USB_UART_TXFIFO_SZ;
+		cdc_param.mem_size -= USB_UART_TXFIFO_SZ;
+
+		// Allocate buffer for packets that wrap around end of txFifo
+		usbUartData.txPacket = (uint8_t *) cdc_param.mem_base;
+		cdc_param.mem_base += USB_MAX_PACKET_SZ;
+		cdc_param.mem_size -= USB_MAX_PACKET_SZ;
+		initSwTimer(&usbUartData.txFlushTimer, usbTxFlushTimeout, 
+			NULL);
+
+		// Allocate buffer for receive FIFO
+		usbUartData.rxFifo = (uint8_t *) cdc_param.mem_base;
+		cdc_param.mem_base += USB_UART_RXFIFO_SZ;
+		cdc_param.mem_size -= USB_UART_RXFIFO_SZ;
+
+		/* register endpoint interrupt handler */
+		ep_indx = (((USB_CDC_IN_EP & 0x0F) << 1) + 1);
+		ret = USBD_API->core->RegisterEpHandler(usbHandle, ep_indx, 
+			usbUartBulkHandler, &usbUartData);
+
+		if (ret == LPC_OK) {
+			/* register endpoint interrupt handler */
+			ep_indx = ((USB_CDC_OUT_EP & 0x0F) << 1);
+			ret = USBD_API->core->RegisterEpHandler(usbHandle, 
+				ep_indx, usbUartBulkHandler, &usbUartData);
+			/* Set the line coding values as per UART Settings */
+			pCDC = (USB_CDC_CTRL_T *) usbUartData.cdcHandle;
+			pCDC->line_coding.dwDTERate = 115200;
+			pCDC->line_coding.bDataBits = 8;
+		}
+
+		/* update mem_base and size variables for cascading calls. */
+		usbParams->mem_base = cdc_param.mem_base;
+		usbParams->mem_size = cdc_param.mem_size;
+	}
+
+	return ret;
+}
+
+#else
+
+/**
+ * Not used in this build configuration.
+ */
+int usb_flush(void) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+int usb_putc(int character) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+void usb_putb(const char* buff, uint32_t len) {
+}
+
+/**
+ * Not used in this build configuration.
+ */
+int usb_tstc(void) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+int usb_getc(void) {
+	return 0;
+}
+
+/**
+ * Not used in this build configuration.
+ */
+uint32_t usb_getb(char* buff, uint32_t len, uint32_t timeoutUs) {
+	return 0;
+}
+
+#endif
@@ -0,0 +1,250 @@
+/**
+ * \file watchdog.c
+ * \brief Supervises system with Windowed Watchdog Timer, resetting the chip if
+ *  any part of the system stops checking in (i.e. stuck ISR or busy loop).
+ *
+ * MIT License
+ *
+ * Copyright (c) 2019 Gregory Gluszek
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include "watchdog.h"
+
+#include "time.h"
+
+#include "chip.h"
+
+#include <cr_section_macros.h>
+
+#include <stdio.h>
+
+#define WDOG_CLK_HZ (12000000 / 4) //!< WWDT counts IRC with fixed divide by 4.
+#define WDOG_TIMEOUT_MS 1000 //!< Time without feed until chip is reset.
+#define WDOG_FEED_PERIOD_US (250 * 1000) //!< How often all clients are checked
+	//!< and watchdog is fed if they have all checked in.
+
+#define WDOG_REC_MAGIC 0x57444F47 //!< Marks wdogRec as valid ("WDOG").
+
+/**
+ * Record of what system was doing. Lives in RAM that is not initialized at
+ *  startup so that it survives a watchdog reset.
+ */
+typedef struct WdogRecord {
+	uint32_t magic; //!< WDOG_REC_MAGIC if rest of record is valid.
+	volatile uint8_t task; //!< Task that was running. NUM_TASKS for none.
+	volatile uint8_t marker; //!< Last WdogMarker recorded.
+	uint16_t wdtResets; //!< Number of watchdog resets since power on.
+} WdogRecord;
+
+__NOINIT_DEF static WdogRecord wdogRec; //!< Record of what system is doing.
+
+static WdogRecord prevRec; //!< Copy of wdogRec from before last reset.
+static uint32_t resetCause; //!< SYSCTL_RST_* flags read at startup.
+
+static volatile uint32_t checkIns; //!< Bit per WdogClient that has checked
+	//!< in since watchdog was last fed.
+static SwTimer feedTimer; //!< Periodically feeds watchdog.
+
+static const char* const taskNames[] = {
+	"ADC", "TPAD", "REPORT", "USB_CDC", "CONSOLE", "WDOG", "JINGLE"
+}; //!< Printable name for each Task. Must be in Task order.
+_Static_assert(sizeof(taskNames) / sizeof(taskNames[0]) == NUM_TASKS,
+	"taskNames must have an entry for each Task");
+
+static const char* const markerNames[NUM_WDOG_MARKERS] = {
+	"NONE", "INIT", "RUNNING", "EEPROM_LOCK", "HW_VER_LOCK", "TPAD_SETUP",
+	"TPAD_CC", "TPAD_ERA"
+}; //!< Printable name for each WdogMarker.
+
+/**
+ * Configure and start watchdog (if it is not already running). Once started
+ *  it cannot be stopped.
+ *
+ * \return None.
+ */
+static void startWdt(void) {
+	if (LPC_WWDT->MOD & WWDT_WDMOD_WDEN) {
+		return;
+	}
+
+	Chip_WWDT_Init(LPC_WWDT);
+	Chip_WWDT_SelClockSource(LPC_WWDT, WWDT_CLKSRC_IRC);
+	Chip_WWDT_SetTimeOut(LPC_WWDT, WDOG_CLK_HZ / 1000 * WDOG_TIMEOUT_MS);
+	Chip_WWDT_SetOption(LPC_WWDT, WWDT_WDMOD_WDRESET);
+	Chip_WWDT_ClearStatusFlag(LPC_WWDT, WWDT_WDMOD_WDTOF);
+	Chip_WWDT_Start(LPC_WWDT);
+}
+
+/**
+ * Heartbeat task. Simply running shows that deferred tasks are not stuck.
+ *
+ * \param events Unused.
+ *
+ * \return None.
+ */
+static void wdogTask(uint32_t events) {
+	watchdogCheckIn(WDOG_CLIENT_DEFERRED);
+}
+
+/**
+ * Called periodically from Timer IRQ. Feeds watchdog only if all clients
+ *  have checked in since the last feed. Since this runs from the Timer IRQ, 
+ *  any ISR of equal or higher priority getting stuck also stops feeding.
+ *
+ * \param ctx Unused.
+ *
+ * \return None.
+ */
+static void feedTimerCallback(void* ctx) {
+	const uint32_t all_clients = (1 << NUM_WDOG_CLIENTS) - 1;
+
+	if ((checkIns & all_clients) == all_clients) {
+		checkIns = 0;
+		Chip_WWDT_Feed(LPC_WWDT);
+	}
+
+	postTaskEvent(TASK_WDOG, 1);
+}
+
+/**
+ * Start supervising system. Requires Time and Sched to be initialized. Also
+ *  captures reset cause and record of what system was doing before reset.
+ *
+ * \return None.
+ */
+void initWatchdog(void) {
+	resetCause = Chip_SYSCTL_GetSystemRSTStatus();
+	Chip_SYSCTL_ClearSystemRSTStatus(resetCause);
+
+	if (wdogRec.magic != WDOG_REC_MAGIC || (resetCause & SYSCTL_RST_POR)) {
+		wdogRec.magic = WDOG_REC_MAGIC;
+		wdogRec.task = NUM_TASKS;
+		wdogRec.marker = WDOG_MARK_NONE;
+		wdogRec.wdtResets = 0;
+	}
+
+	if (resetCause & SYSCTL_RST_WDT) {
+		wdogRec.wdtResets++;
+	}
+
+	prevRec = wdogRec;
+
+	wdogRec.task = NUM_TASKS;
+	wdogRec.marker = WDOG_MARK_INIT;
+
+	checkIns = 0;
+
+	registerTask(TASK_WDOG, wdogTask, TASK_CTX_DEFERRED);
+
+	startWdt();
+
+	initSwTimer(&feedTimer, feedTimerCallback, NULL);
+	startSwTimer(&feedTimer, WDOG_FEED_PERIOD_US, WDOG_FEED_PERIOD_US);
+}
+
+/**
+ * Indicate that client is still making progress. Safe to call from any 
+ *  context.
+ *
+ * \param client Client checking in.
+ *
+ * \return None.
+ */
+void watchdogCheckIn(WdogClient client) {
+	uint32_t primask = __get_PRIMASK();
+	__disable_irq();
+	checkIns |= 1 << client;
+	__set_PRIMASK(primask);
+}
+
+/**
+ * Record that code has reached a location, so it can be reported if the 
+ *  watchdog resets the chip.
+ *
+ * \param marker Location being recorded.
+ *
+ * \return Previously recorded marker (i.e. to restore after a marked section
+ *	completes).
+ */
+WdogMarker watchdogMark(WdogMarker marker) {
+	WdogMarker prev = (WdogMarker)wdogRec.marker;
+	wdogRec.marker = marker;
+	return prev;
+}
+
+/**
+ * Record task that is running, so it can be reported if the watchdog resets
+ *  the chip.
+ *
+ * \param task Task starting to run. NUM_TASKS when task is done.
+ *
+ * \return Previously recorded task (i.e. task that was preempted).
+ */
+Task watchdogSetTask(Task task) {
+	Task prev = (Task)wdogRec.task;
+	wdogRec.task = task;
+	return prev;
+}
+
+/**
+ * Hard lock in place of a failure that cannot be reported. Watchdog is started
+ *  if not already running, so the chip resets and marker can be reported
+ *  afterwards. Can be called before initWatchdog().
+ *
+ * \param marker Location/reason for lock.
+ *
+ * \return Never returns.
+ */
+void watchdogLock(WdogMarker marker) {
+	__disable_irq();
+
+	wdogRec.magic = WDOG_REC_MAGIC;
+	wdogRec.marker = marker;
+
+	startWdt();
+
+	while (1) {}
+}
+
+/**
+ * Print reset cause and, if the last reset was caused by the watchdog, what 
+ *  the system was doing when it hung.
+ *
+ * \return None.
+ */
+void printWatchdogStats(void) {
+	printf("Reset cause:%s%s%s%s%s\n", 
+		resetCause & SYSCTL_RST_POR ? " POR" : "",
+		resetCause & SYSCTL_RST_EXTRST ? " EXTRST" : "",
+		resetCause & SYSCTL_RST_WDT ? " WDT" : "",
+		resetCause & SYSCTL_RST_BOD ? " BOD" : "",
+		resetCause & SYSCTL_RST_SYSRST ? " SYSRST" : "");
+	printf("Watchdog resets since power on: %d\n", prevRec.wdtResets);
+
+	if (!(resetCause & SYSCTL_RST_WDT)) {
+		return;
+	}
+
+	printf("Before watchdog reset: task=%s marker=%s\n", 
+		prevRec.task < NUM_TASKS ? taskNames[prevRec.task] : "NONE",
+		prevRec.marker < NUM_WDOG_MARKERS ? markerNames[prevRec.marker] :
+		"UNKNOWN");
+}
@@ -0,0 +1,182 @@
+#!/usr/bin/env python3
+#
+# trace_decode.py
+#
+# Host side decoder for records logged by TRACE*() in Firmware/
+#  OpenSteamController/inc/trace.h. Records only hold the address of their
+#  format string, so the strings are looked up in the ELF the firmware was
+#  built from. Records are either read from the controller by issuing 
+#  "trace dump" or from a file holding a captured dump.
+#
+# MIT License
+#
+# Copyright (c) 2019 Gregory Gluszek
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import re
+import struct
+import sys
+
+RECORD_RE = re.compile(r"^([0-9a-f]{8})((?: [0-9a-f]{8}){4})\s*$")
+SPEC_RE = re.compile(r"%([-+ #0]*)(\d*)(?:\.(\d+))?(?:hh|h|ll|l|z|j|t)?"
+	r"([diouxXcsp%])")
+
+SHT_NOBITS = 8 # Section occupies no space in file (i.e. .bss)
+SHF_ALLOC = 0x2 # Section occupies memory on target
+
+class Elf:
+	'Read only access to allocated sections of firmware ELF'
+
+	def __init__(self, path):
+		with open(path, "rb") as f:
+			data = f.read()
+		if data[:4] != b"\x7fELF":
+			raise ValueError("%s is not an ELF file" % path)
+
+		# Only section headers are needed: offset, entry size and count
+		is64 = data[4] == 2
+		endian = "<" if data[5] == 1 else ">"
+		if is64:
+			shoff, = struct.unpack_from(endian + "Q", data, 0x28)
+			shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x3A)
+			shfmt = endian + "IIQQQQ"
+		else:
+			shoff, = struct.unpack_from(endian + "I", data, 0x20)
+			shentsize, shnum = struct.unpack_from(endian + "HH", data, 0x2E)
+			shfmt = endian + "IIIIII"
+
+		self.sections = []
+		for idx in range(shnum):
+			_, shtype, flags, addr, offset, size = struct.unpack_from(shfmt,
+				data, shoff + idx * shentsize)
+			if not (flags & SHF_ALLOC) or shtype == SHT_NOBITS or not size:
+				continue
+			self.sections.append((addr, data[offset:offset + size]))
+
+	def readStr(self, addr):
+		'Return NUL terminated string at addr, or None if not in ELF'
+		for base, data in self.sections:
+			if base <= addr < base + len(data):
+				end = data.find(b"\0", addr - base)
+				if end < 0:
+					end = len(data)
+				return data[addr - base:end].decode(errors="replace")
+		return None
+
+def formatRecord(elf, fmtAddr, args):
+	'printf() the way the firmware would have'
+	fmt = elf.readStr(fmtAddr)
+	if fmt is None:
+		return "<unknown format 0x%08x> %s" % (fmtAddr, 
+			" ".join("0x%08x" % arg for arg in args))
+
+	args = list(args)
+	def convert(match):
+		flags, width, prec, conv = match.groups()
+		if conv == "%":
+			return "%"
+		arg = args.pop(0) if args else 0
+		if conv in "di":
+			arg = arg - (1 << 32) if arg & 0x80000000 else arg
+		elif conv == "c":
+			arg = chr(arg & 0xFF)
+		elif conv == "s":
+			string = elf.readStr(arg)
+			if string is None:
+				return "<str 0x%08x>" % arg
+			arg = string
+		elif conv == "p":
+			conv = "x"
+			flags += "#"
+		elif conv == "u":
+			conv = "d"
+		spec = "%" + flags + width + ("." + prec if prec else "") + conv
+		return spec % arg
+
+	return SPEC_RE.sub(convert, fmt)
+
+def readDumpFromPort(portName):
+	'Issue "trace dump" and return lines of output'
+	import serial # pyserial
+	import time
+
+	port = serial.Serial(portName, timeout=0.1)
+	port.reset_input_buffer()
+	port.write(b"trace dump\n")
+
+	output = b""
+	end = time.time() + 10
+	while b"Trace dump end." not in output:
+		if time.time() > end:
+			raise TimeoutError("Timed out waiting for trace dump, got %r" %
+				output)
+		output += port.read(port.in_waiting or 1)
+	port.close()
+
+	return output.decode(errors="replace").replace("\r", "").split("\n")
+
+def main(argv):
+	parser = argparse.ArgumentParser(description="Decode OpenSteamController"
+		" trace records using the ELF the firmware was built from.")
+	parser.add_argument("elf", help="Firmware ELF (i.e. Debug/"
+		"OpenSteamController.axf)")
+	source = parser.add_mutually_exclusive_group(required=True)
+	source.add_argument("--port", help="Serial port to issue \"trace dump\" "
+		"on (i.e. /dev/ttyACM0)")
+	source.add_argument("--input", help="File holding captured \"trace "
+		"dump\" output (- for stdin)")
+	args = parser.parse_args(argv)
+
+	elf = Elf(args.elf)
+
+	if args.port:
+		lines = readDumpFromPort(args.port)
+	elif args.input == "-":
+		lines = sys.stdin.read().split("\n")
+	else:
+		with open(args.input) as f:
+			lines = f.read().split("\n")
+
+	prev = None
+	num_recs = 0
+	for line in lines:
+		match = RECORD_RE.match(line.strip())
+		if not match:
+			if line.startswith("Trace dump:"):
+				print(line.strip())
+			continue
+
+		words = [int(word, 16) for word in match.group(0).split()]
+		fmt_addr, timestamp, rec_args = words[0], words[1], words[2:]
+		# Timestamp is 32-bit us count, so delta is modulo 2^32
+		delta = 0 if prev is None else (timestamp - prev) & 0xFFFFFFFF
+		prev = timestamp
+		num_recs += 1
+
+		print("%10u us (+%8u): %s" % (timestamp, delta, 
+			formatRecord(elf, fmt_addr, rec_args)))
+
+	print("%d records decoded" % num_recs)
+
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+#
+# usb_cdc_test.py
+#
+# Host side of the "test usb" commands in Firmware/OpenSteamController/src/
+#  test.c. Drives the DEV_BOARD_FW console over its USB CDC serial port to
+#  check that data makes it across intact, how fast and with what latency.
+#
+# MIT License
+#
+# Copyright (c) 2019 Gregory Gluszek
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import re
+import sys
+import time
+
+import serial # pyserial
+
+PATTERN_SEED = 0x2545f491 # Must match TEST_PATTERN_SEED in test.c
+
+def testPattern(numBytes):
+	'Same xorshift32 pattern as nextTestByte() in test.c'
+	state = PATTERN_SEED
+	data = bytearray(numBytes)
+	for idx in range(numBytes):
+		state ^= (state << 13) & 0xFFFFFFFF
+		state ^= state >> 17
+		state ^= (state << 5) & 0xFFFFFFFF
+		data[idx] = state & 0xFF
+	return bytes(data)
+
+class Console:
+	'DEV_BOARD_FW console on a serial port'
+
+	def __init__(self, portName):
+		self.port = serial.Serial(portName, timeout=0.1)
+		self.buff = b"" # Received, but not yet consumed
+
+	def close(self):
+		self.port.close()
+
+	def runCmd(self, cmd):
+		'Send console command, dropping anything printed before it'
+		self.port.reset_input_buffer()
+		self.buff = b""
+		self.port.write((cmd + "\n").encode())
+
+	def readUntil(self, pattern, timeout):
+		'Read output until regex pattern matches. Returns match.'
+		end = time.time() + timeout
+		while True:
+			match = re.search(pattern, self.buff)
+			if match:
+				self.buff = self.buff[match.end():]
+				return match
+			if time.time() > end:
+				raise TimeoutError("Timed out waiting for %s, got %r" %
+					(pattern, self.buff))
+			self.buff += self.port.read(self.port.in_waiting or 1)
+
+	def read(self, numBytes, timeout):
+		'Read exactly numBytes of (binary) data, or less on timeout.'
+		end = time.time() + timeout
+		while len(self.buff) < numBytes and time.time() < end:
+			self.buff += self.port.read(max(self.port.in_waiting,
+				min(numBytes - len(self.buff), 1)))
+		data = self.buff[:numBytes]
+		self.buff = self.buff[numBytes:]
+		return data
+
+	def write(self, data):
+		self.port.write(data)
+		self.port.flush()
+
+def testRx(console, args):
+	'Stream pattern to controller as fast as possible and have it check it'
+	data = testPattern(args.bytes)
+	console.runCmd("test usb rx %d" % args.bytes)
+	console.readUntil(rb"Ready for \d+ bytes\.\n\r", 2)
+
+	start = time.time()
+	for idx in range(0, args.bytes, args.chunk):
+		console.port.write(data[idx:idx + args.chunk])
+	console.port.flush()
+	elapsed = time.time() - start
+
+	match = console.readUntil(rb"Received (\d+)/(\d+) bytes in (\d+) us "
+		rb"\((\d+) B/s\)\. (\d+) errors[^\n]*\n", 10)
+	print(match.group(0).decode().strip())
+	print("Host sent %d bytes in %.3f s (%d B/s)" % (args.bytes, elapsed,
+		args.bytes / elapsed if elapsed else 0))
+
+	return int(match.group(1)) == args.bytes and int(match.group(5)) == 0
+
+def testTx(console, args):
+	'Have controller stream pattern as fast as possible and check it'
+	console.runCmd("test usb tx %d" % args.bytes)
+	console.readUntil(rb"Sending \d+ bytes\.\n\r", 2)
+
+	start = time.time()
+	data = console.read(args.bytes, 10 + args.bytes / 100000)
+	elapsed = time.time() - start
+
+	match = console.readUntil(rb"Sent (\d+) bytes in (\d+) us "
+		rb"\((\d+) B/s\)\.\n", 10)
+	print(match.group(0).decode().strip())
+	print("Host received %d bytes in %.3f s (%d B/s)" % (len(data), elapsed,
+		len(data) / elapsed if elapsed else 0))
+
+	expected = testPattern(args.bytes)
+	if data != expected:
+		for idx in range(len(data)):
+			if data[idx] != expected[idx]:
+				break
+		print("Received %d/%d bytes. First error at byte %d" % (len(data),
+			args.bytes, idx))
+		return False
+
+	return True
+
+def testEcho(console, args):
+	'Echo pings from controller back to it as quickly as possible'
+	console.runCmd("test usb echo %d %d" % (args.pings, args.ping_bytes))
+	console.readUntil(rb"Echo \d+ pings of \d+ bytes\.\n\r", 2)
+
+	for ping in range(args.pings):
+		data = console.read(args.ping_bytes, 2)
+		if len(data) != args.ping_bytes:
+			print("Timed out on ping %d" % ping)
+			break
+		console.write(data)
+
+	match = console.readUntil(rb"Echoed (\d+)/(\d+) pings\. (\d+) errors"
+		rb"\.\n\r", 5)
+	print(match.group(0).decode().strip())
+	if int(match.group(1)):
+		hist = console.readUntil(rb"Round trip us:.*?>=[^\n]*\n", 5)
+		print(hist.group(0).decode().replace("\r", "").strip())
+
+	return (int(match.group(1)) == int(match.group(2)) and
+		int(match.group(3)) == 0)
+
+TESTS = {
+	"rx": testRx,
+	"tx": testTx,
+	"echo": testEcho,
+}
+
+def main(argv):
+	parser = argparse.ArgumentParser(description="USB CDC tests for "
+		"OpenSteamController DEV_BOARD_FW.")
+	parser.add_argument("port", help="Serial port (i.e. /dev/ttyACM0)")
+	parser.add_argument("test", choices=sorted(TESTS.keys()),
+		help="rx = stream data to controller and check it arrives intact, "
+		"tx = stream data from controller and check it arrives intact, "
+		"echo = echo pings back to controller to measure round trip time")
+	parser.add_argument("--bytes", type=int, default=1 << 20,
+		help="Number of bytes to transfer for rx and tx (default 1 MiB)")
+	parser.add_argument("--chunk", type=int, default=4096,
+		help="Bytes per host write for rx (default 4096)")
+	parser.add_argument("--pings", type=int, default=1000,
+		help="Number of pings for echo (default 1000)")
+	parser.add_argument("--ping-bytes", type=int, default=16,
+		help="Number of bytes per ping for echo, at most 64 (default 16)")
+	parser.add_argument("--iterations", type=int, default=1,
+		help="Number of times to run test (default 1)")
+	args = parser.parse_args(argv)
+
+	console = Console(args.port)
+
+	num_fails = 0
+	for iteration in range(args.iterations):
+		if not TESTS[args.test](console, args):
+			print("FAIL: iteration %d" % iteration)
+			num_fails += 1
+
+	console.close()
+
+	print("%d/%d iterations passed" % (args.iterations - num_fails,
+		args.iterations))
+
+	return 1 if num_fails else 0
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv[1:]))
@@ -30,6 +30,7 @@
 #include "composition.h"
 
 #include <QFile>
+#include <QByteArray>
 #include <QMessageBox>
 #include <QDebug>
 
@@ -456,131 +457,305 @@ Composition::ErrorCode Composition::parseXmlPitch(QXmlStreamReader& xml, float&
 }
 
 /**
- * @brief Composition::download Download the Jingle data for each Channel
- *      to the Controller via the providied serial port. This assumes that
- *      the musicxml has been successfully parsed and that the channels
- *      have been configured appropriately.
+ * @brief Composition::buildJingleData Build a complete Jingle Data blob, as it
+ *      is stored in Controller RAM and EEPROM, from a series of Compositions.
+ *      See jingle_data.c in OpenSteamController FW for details on format.
+ *      Identical Jingles (or identical streams for compact format) are only
+ *      stored once, with all offsets referencing the one copy.
  *
- * @param[in] serial Allows for communicating with Controller.
- * @param jingleIdx Defines which Jingle index the Jingle Data will exist under.
+ * @param[in] comps Compositions to build Jingles from. Jingle indices follow order
+ *      in comps.
+ * @param compact Build compact (v2) format Jingle Data.
  *
- * @return Composition::ErrorCode
+ * @return Jingle Data blob. May be larger than MAX_EEPROM_BYTES, so check size
+ *      before uploading.
  */
-Composition::ErrorCode Composition::download(SCSerial& serial, uint32_t jingleIdx) {
-    SCSerial::ErrorCode serial_err_code = SCSerial::NO_ERROR;
-    QString cmd;
-    QString resp;
+std::vector<uint8_t> Composition::buildJingleData(const std::vector<Composition*>& comps,
+        bool compact) {
+    const uint16_t magic_word = compact ? 0xc0de : 0xbead;
+    const uint32_t hdr_bytes = compact ? EEPROM_HDR_V2_NUM_BYTES : EEPROM_HDR_NUM_BYTES;
+    const uint32_t offsets_addr = 6;
+
+    std::vector<uint8_t> data(hdr_bytes, 0);
+
+    auto set16 = [&data](uint32_t addr, uint32_t val) {
+        data[addr] = val & 0xff;
+        data[addr + 1] = (val >> 8) & 0xff;
+    };
+
+    set16(0, magic_word);
+    if (compact) {
+        data[2] = 2; // Format version
+    }
+    data[4] = static_cast<uint8_t>(std::min<size_t>(comps.size(), MAX_NUM_COMPS));
+
+    // Regions (i.e. Jingles or streams) already in blob, by content, so that
+    //  duplicates can reference the first copy
+    std::map<std::vector<uint8_t>, uint32_t> region_offsets;
+    auto addRegion = [&data, &region_offsets](const std::vector<uint8_t>& region) {
+        auto iter = region_offsets.find(region);
+        if (iter != region_offsets.end()) {
+            return iter->second;
+        }
+        const uint32_t offset = static_cast<uint32_t>(data.size());
+        region_offsets[region] = offset;
+        data.insert(data.end(), region.begin(), region.end());
+        return offset;
+    };
+
+    for (uint32_t comp_idx = 0; comp_idx < data[4]; comp_idx++) {
+        if (compact) {
+            for (uint32_t chan_idx = 0; chan_idx < 2; chan_idx++) {
+                const std::vector<uint8_t> stream =
+                    comps[comp_idx]->encodeStream(chan_idx ? LEFT : RIGHT);
+                set16(offsets_addr + (2 * comp_idx + chan_idx) * 2,
+                    stream.empty() ? 0 : addRegion(stream));
+            }
+        } else {
+            const std::vector<uint8_t> notes_r = comps[comp_idx]->encodeNotes(RIGHT);
+            const std::vector<uint8_t> notes_l = comps[comp_idx]->encodeNotes(LEFT);
+
+            std::vector<uint8_t> jingle(2 * sizeof(uint16_t), 0);
+            jingle[0] = (notes_r.size() / 6) & 0xff;
+            jingle[1] = ((notes_r.size() / 6) >> 8) & 0xff;
+            jingle[2] = (notes_l.size() / 6) & 0xff;
+            jingle[3] = ((notes_l.size() / 6) >> 8) & 0xff;
+            jingle.insert(jingle.end(), notes_r.begin(), notes_r.end());
+            jingle.insert(jingle.end(), notes_l.begin(), notes_l.end());
+
+            // Unused offsets reference last Jingle, as official FW expects
+            const uint32_t jingle_addr = addRegion(jingle);
+            for (uint32_t idx = comp_idx; idx < MAX_NUM_COMPS; idx++) {
+                set16(offsets_addr + idx * 2, jingle_addr);
+            }
+        }
+    }
 
-    // Bounds check jingleIdx
-    if (jingleIdx >= MAX_NUM_COMPS) {
-        qDebug() << "Specified jingleIdx is out of bounds " << jingleIdx;
-        return BAD_IDX;
+    if (compact) {
+        set16(hdr_bytes - 2, data.size());
     }
 
-    const uint32_t meas_start_idx = getMeasStartIdx();
-    const uint32_t meas_end_idx = getMeasEndIdx();
+    return data;
+}
 
-    const uint32_t num_notes_l = getNumNotes(LEFT);
-    const uint32_t num_notes_r = getNumNotes(RIGHT);
+/**
+ * @brief Composition::upload Replace all Jingle Data on Controller with the given
+ *      blob in a single binary transfer. This is much faster than sending
+ *      Jingles Note by Note with console commands.
+ *
+ * @param[in] serial Allows for communicating with Controller.
+ * @param[in] jingleData Blob created by buildJingleData().
+ *
+ * @return Composition::ErrorCode
+ */
+Composition::ErrorCode Composition::upload(SCSerial& serial, const std::vector<uint8_t>& jingleData) {
+    SCSerial::ErrorCode serial_err_code = SCSerial::NO_ERROR;
 
-    // No notes so do nothing
-    if (!num_notes_l && !num_notes_r) {
-        qDebug() << "No Notes in Right and Left Channel";
-        return NO_NOTES;
+    if (jingleData.size() > MAX_EEPROM_BYTES) {
+        qDebug() << "Jingle Data too large " << jingleData.size();
+        return TOO_LARGE;
     }
 
-    cmd = "jingle add ";
-    cmd += QString::number(num_notes_r) + QString(" ");
-    cmd += QString::number(num_notes_l) + QString("\n");
-    resp = cmd + "\rJingle " + QString::number(jingleIdx) + " added successfully.\n\r";
+    const QByteArray bytes(reinterpret_cast<const char*>(jingleData.data()),
+        static_cast<int>(jingleData.size()));
+    const uint32_t crc = static_cast<uint32_t>(crc32(0,
+        reinterpret_cast<const Bytef*>(bytes.constData()), static_cast<uInt>(bytes.size())));
+
+    QString cmd = QString("jingle load ") + QString::number(bytes.size()) +
+            QString(" 0x") + QString::number(crc, 16) + QString("\n");
+    QString resp = cmd + "\rReady for " + QString::number(bytes.size()) + " bytes.\n\r";
     serial_err_code = serial.send(cmd, resp);
     if (serial_err_code != SCSerial::NO_ERROR) {
         qDebug() << "serial.send() Error String: " << SCSerial::getErrorString(serial_err_code);
         return CMD_ERR;
     }
 
-    uint32_t note_cnt = 0;
+    serial_err_code = serial.sendData(bytes, "Jingle data loaded successfully.\n\r");
+    if (serial_err_code != SCSerial::NO_ERROR) {
+        qDebug() << "serial.sendData() Error String: " << SCSerial::getErrorString(serial_err_code);
+        return CMD_ERR;
+    }
 
-    // Add Notes to Left Channel
-    if (voices.count(voiceStrL)) {
-        for (uint32_t meas_idx = meas_start_idx; meas_idx <= meas_end_idx; meas_idx++) {
-            Measure& meas = voices[voiceStrL].measures[meas_idx];
-            for (uint32_t notes_idx = 0; notes_idx < meas.notes.size(); notes_idx++) {
-                Note& note = meas.notes[notes_idx];
-
-                cmd = noteToCmd(note, LEFT, jingleIdx, note_cnt, chordIdxL);
-                resp = cmd + "\rNote updated successfully.\n\r";
-                serial_err_code = serial.send(cmd, resp);
-                if (serial_err_code != SCSerial::NO_ERROR) {
-                    qDebug() << "serial.send() Error String: " << SCSerial::getErrorString(serial_err_code);
-                    return CMD_ERR;
-                }
-                note_cnt++;
-            }
-        }
+    return NO_ERROR;
+}
+
+/**
+ * @brief Composition::getNoteFreq
+ *
+ * @param[in] note Contains Note data.
+ * @param chordIdx Defines which Note in chord to use.
+ *
+ * @return Frequency (in Hz) to play Note at on Controller. 0 for a rest.
+ */
+uint32_t Composition::getNoteFreq(const Note& note, uint32_t chordIdx) {
+    if (chordIdx < note.frequencies.size()) {
+        return static_cast<uint32_t>(note.frequencies[chordIdx] * octaveAdjust);
     }
 
-    // Add Notes to Right Channel
-    if (voices.count(voiceStrR)) {
-        note_cnt = 0;
+    return static_cast<uint32_t>(note.frequencies.back() * octaveAdjust);
+}
 
-        for (uint32_t meas_idx = meas_start_idx; meas_idx <= meas_end_idx; meas_idx++) {
-            Measure& meas = voices[voiceStrR].measures[meas_idx];
-            for (uint32_t notes_idx = 0; notes_idx < meas.notes.size(); notes_idx++) {
-                Note& note = meas.notes[notes_idx];
-
-                cmd = noteToCmd(note, RIGHT, jingleIdx, note_cnt, chordIdxR);
-                resp = cmd + "\rNote updated successfully.\n\r";
-                serial_err_code = serial.send(cmd, resp);
-                if (serial_err_code != SCSerial::NO_ERROR) {
-                    qDebug() << "serial.send() Error String: " << SCSerial::getErrorString(serial_err_code);
-                    return CMD_ERR;
-                }
-                note_cnt++;
-            }
+/**
+ * @brief Composition::getNoteDurationMs
+ *
+ * @param[in] note Contains Note data.
+ *
+ * @return Duration of Note in ms given current BPM setting.
+ */
+uint32_t Composition::getNoteDurationMs(const Note& note) {
+    return static_cast<uint32_t>(round(note.length * 60 * 1000 / bpm));
+}
+
+/**
+ * @brief Composition::encodeNotes Encode the Notes of a Channel as they are
+ *      stored in (non-compact) Jingle Data. See Note struct in haptic.h in
+ *      OpenSteamController FW.
+ *
+ * @param chan Specificies which channel to encode.
+ *
+ * @return Encoded Note bytes. Empty if the Channel has no Notes.
+ */
+std::vector<uint8_t> Composition::encodeNotes(Channel chan) {
+    std::vector<uint8_t> notes;
+
+    const QString& voice_str = (chan == LEFT) ? voiceStrL : voiceStrR;
+    const uint32_t chord_idx = (chan == LEFT) ? chordIdxL : chordIdxR;
+    if (!getNumNotes(chan)) {
+        return notes;
+    }
+
+    for (uint32_t meas_idx = getMeasStartIdx(); meas_idx <= getMeasEndIdx(); meas_idx++) {
+        Measure& meas = voices[voice_str].measures[meas_idx];
+        for (uint32_t notes_idx = 0; notes_idx < meas.notes.size(); notes_idx++) {
+            const uint32_t freq = getNoteFreq(meas.notes[notes_idx], chord_idx);
+            const uint32_t dur = getNoteDurationMs(meas.notes[notes_idx]);
+
+            notes.push_back(noteIntensity);
+            notes.push_back(0); // envelope
+            notes.push_back(freq & 0xff);
+            notes.push_back((freq >> 8) & 0xff);
+            notes.push_back(dur & 0xff);
+            notes.push_back((dur >> 8) & 0xff);
         }
     }
 
-    return NO_ERROR;
+    return notes;
 }
 
 /**
- * @brief Composition::noteToCmd Convert information into command string to send to
- *      Controller via serial.
+ * @brief Composition::encodeStream Encode the Notes of a Channel in the compact
+ *      (v2) Jingle Data stream format. See jingle_data.c in OpenSteamController
+ *      FW for details on format.
  *
- * @param[in] note Contains Note data.
- * @param chan Specificies which channel Note will be played on.
- * @param jingleIdx Defines which Jingle index the Jingle Data will exist under.
- * @param noteIdx Defines which Note in the Jingle we are programming.
- * @param chordIdx Defines which Note in chord to use.
+ * @param chan Specificies which channel to encode.
  *
- * @return Command string to send to Controller via serial.
+ * @return Encoded stream bytes. Empty if the Channel has no Notes.
  */
-QString Composition::noteToCmd(const Note& note, Channel chan, uint32_t jingleIdx,
-        uint32_t noteIdx, uint32_t chordIdx) {
+std::vector<uint8_t> Composition::encodeStream(Channel chan) {
+    static const uint8_t TOK_END = 0x00;
+    static const uint8_t TOK_NOTE = 0x40;
+    static const uint8_t TOK_REST = 0x80;
+    static const uint8_t TOK_REPEAT = 0xc0;
+    static const uint8_t DUR_VARINT = 0x3f; // durIdx indicating varint duration follows
+    static const uint32_t MAX_REPEAT = 0x3f;
+    static const uint32_t MAX_DURATION = 0xffff;
+
+    std::vector<uint8_t> stream;
+
+    const QString& voice_str = (chan == LEFT) ? voiceStrL : voiceStrR;
+    const uint32_t chord_idx = (chan == LEFT) ? chordIdxL : chordIdxR;
+    if (!getNumNotes(chan)) {
+        return stream;
+    }
 
-    QString chan_str("right");
-    if (chan == LEFT) {
-        chan_str = "left";
+    // Flatten Measures into (frequency, duration) pairs, merging consecutive rests
+    std::vector<std::pair<uint32_t, uint32_t>> events;
+    for (uint32_t meas_idx = getMeasStartIdx(); meas_idx <= getMeasEndIdx(); meas_idx++) {
+        Measure& meas = voices[voice_str].measures[meas_idx];
+        for (uint32_t notes_idx = 0; notes_idx < meas.notes.size(); notes_idx++) {
+            const uint32_t freq = getNoteFreq(meas.notes[notes_idx], chord_idx);
+            const uint32_t dur = std::min(getNoteDurationMs(meas.notes[notes_idx]), MAX_DURATION);
+
+            if (!freq && !events.empty() && !events.back().first &&
+                    events.back().second + dur <= MAX_DURATION) {
+                events.back().second += dur;
+            } else {
+                events.push_back(std::make_pair(freq, dur));
+            }
+        }
     }
 
-    const uint32_t duty_cydle = noteIntensity;
+    // Durations used more than once go in table. Most common get the indices
+    std::map<uint32_t, uint32_t> dur_cnts;
+    for (uint32_t idx = 0; idx < events.size(); idx++) {
+        dur_cnts[events[idx].second]++;
+    }
+    std::vector<std::pair<uint32_t, uint32_t>> dur_order;
+    for (std::map<uint32_t, uint32_t>::iterator itr = dur_cnts.begin(); itr != dur_cnts.end(); itr++) {
+        if (itr->second > 1) {
+            dur_order.push_back(std::make_pair(itr->second, itr->first));
+        }
+    }
+    std::sort(dur_order.rbegin(), dur_order.rend());
+    if (dur_order.size() > DUR_VARINT) {
+        dur_order.resize(DUR_VARINT);
+    }
 
-    uint32_t frequency = static_cast<uint32_t>(note.frequencies.back() * octaveAdjust);
-    if (chordIdx < note.frequencies.size()) {
-        frequency = static_cast<uint32_t>(note.frequencies[chordIdx] * octaveAdjust);
+    std::map<uint32_t, uint8_t> dur_idxs;
+    stream.push_back(noteIntensity);
+    stream.push_back(0); // envelope
+    stream.push_back(static_cast<uint8_t>(dur_order.size()));
+    for (uint32_t idx = 0; idx < dur_order.size(); idx++) {
+        const uint32_t dur = dur_order[idx].second;
+        dur_idxs[dur] = static_cast<uint8_t>(idx);
+        stream.push_back(dur & 0xff);
+        stream.push_back(dur >> 8);
     }
 
-    const uint32_t duration_ms = static_cast<uint32_t>(round(note.length * 60 * 1000 / bpm));
+    auto push_varint = [&stream](uint32_t val) {
+        while (val >= 0x80) {
+            stream.push_back(static_cast<uint8_t>(val | 0x80));
+            val >>= 7;
+        }
+        stream.push_back(static_cast<uint8_t>(val));
+    };
+
+    uint32_t prev_freq = 0;
+    uint32_t repeats = 0;
+    for (uint32_t idx = 0; idx < events.size(); idx++) {
+        const uint32_t freq = events[idx].first;
+        const uint32_t dur = events[idx].second;
+
+        if (idx && events[idx] == events[idx-1] && repeats < MAX_REPEAT) {
+            repeats++;
+            continue;
+        }
+        if (repeats) {
+            stream.push_back(TOK_REPEAT | repeats);
+            repeats = 0;
+        }
 
-    QString cmd = QString("jingle note ") + QString::number(jingleIdx) + QString(" ") +
-            chan_str + QString(" ") +
-            QString::number(noteIdx) + QString(" ") +
-            QString::number(duty_cydle) + QString(" ") +
-            QString::number(frequency) + QString(" ") +
-            QString::number(duration_ms) + QString("\n");
+        const uint8_t dur_idx = dur_idxs.count(dur) ? dur_idxs[dur] : DUR_VARINT;
+        if (freq) {
+            stream.push_back(TOK_NOTE | dur_idx);
+        } else {
+            stream.push_back(TOK_REST | dur_idx);
+        }
+        if (dur_idx == DUR_VARINT) {
+            push_varint(dur);
+        }
+        if (freq) {
+            const int32_t delta = static_cast<int32_t>(freq) - static_cast<int32_t>(prev_freq);
+            push_varint((static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31));
+            prev_freq = freq;
+        }
+    }
+    if (repeats) {
+        stream.push_back(TOK_REPEAT | repeats);
+    }
+    stream.push_back(TOK_END);
 
-    return cmd;
+    return stream;
 }
 
 /**
@@ -820,10 +995,17 @@ uint32_t Composition::getChordIdx(Channel chan) {
  *      varies based on configuration and is used to make sure we do not try to
  *      write too much, or invalid, Jingle Data to the EEPROM.
  *
+ * @param compact Calculate usage for compact (v2) Jingle Data format.
+ *
  * @return The number of bytes required to store the Jingle data, as currently
  *      configured, in EEPROM of the Controller.
  */
-uint32_t Composition::getMemUsage() {
+uint32_t Composition::getMemUsage(bool compact) {
+    if (compact) {
+        // Stream offsets are in v2 header, so only streams themselves count
+        return static_cast<uint32_t>(encodeStream(RIGHT).size() + encodeStream(LEFT).size());
+    }
+
     static const uint32_t NUM_JINGLE_HDR_BYTES = 4;// Number of bytes required for each
             // Jingle to give data on Jingle (i.e. number of Notes per channel)
     static const uint32_t BYTES_PER_NOTE = 6; // Number of bytes required to store
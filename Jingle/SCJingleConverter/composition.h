@@ -51,6 +51,7 @@ public:
         CMD_ERR,
         BAD_IDX,
         NO_NOTES,
+        TOO_LARGE,
     };
 
     /**
@@ -78,6 +79,8 @@ public:
             return "Specified index out of bouds.";
         case NO_NOTES:
             return "No Notes in specified Channel(s).";
+        case TOO_LARGE:
+            return "Jingle Data is too large to fit in EEPROM.";
         }
 
         return "Unknown Error";
@@ -102,6 +105,12 @@ public:
         // information (i.e. Magic word + num Jingles + packing bytes +
         // offsets for MAX_NUM_COMPS).
 
+    static const uint32_t EEPROM_HDR_V2_NUM_BYTES = 2 + 1 + 1 + 1 + 1 + 2 * 2 * MAX_NUM_COMPS + 2;
+        // Header bytes used by compact (v2) Jingle Data format (i.e. Magic word +
+        // version + num Jingles + packing bytes + Right and Left stream offsets
+        // for MAX_NUM_COMPS + end of data offset). See jingle_data.c in
+        // OpenSteamController FW for additional details.
+
     Composition(QString filename);
 
     /**
@@ -114,7 +123,10 @@ public:
     }
 
     ErrorCode parse();
-    ErrorCode download(SCSerial& serial, uint32_t jingleIdx);
+
+    static std::vector<uint8_t> buildJingleData(const std::vector<Composition*>& comps,
+        bool compact);
+    static ErrorCode upload(SCSerial& serial, const std::vector<uint8_t>& jingleData);
 
     std::vector<QString> getVoiceStrs();
     uint32_t getNumMeasures();
@@ -205,7 +217,7 @@ public:
     ErrorCode setChordIdx(Channel chan, uint32_t chordIdx);
     uint32_t getChordIdx(Channel chan);
 
-    uint32_t getMemUsage();
+    uint32_t getMemUsage(bool compact = false);
 
 private:
     /**
@@ -252,8 +264,11 @@ private:
 
     uint32_t getNumNotes(Channel chan);
 
-    QString noteToCmd(const Note& note, Channel chan, uint32_t jingleIdx,
-        uint32_t noteIdx, uint32_t chordIdx);
+    uint32_t getNoteFreq(const Note& note, uint32_t chordIdx);
+    uint32_t getNoteDurationMs(const Note& note);
+
+    std::vector<uint8_t> encodeNotes(Channel chan);
+    std::vector<uint8_t> encodeStream(Channel chan);
 
     QString filename; // Filename for musicxml file we are extracting data from
 
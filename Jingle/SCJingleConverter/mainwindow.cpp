@@ -119,8 +119,7 @@ void MainWindow::on_playJinglePushButton_clicked() {
 
     // Make sure there is enough memory to download selected Jingle
     //  as currently configured
-    uint32_t num_bytes = Composition::EEPROM_HDR_NUM_BYTES +
-            composition->getMemUsage();
+    uint32_t num_bytes = getMemUsage(composition);
 
     if (num_bytes > Composition::MAX_EEPROM_BYTES) {
         QMessageBox::information(this, tr("Error"),
@@ -132,18 +131,12 @@ void MainWindow::on_playJinglePushButton_clicked() {
     }
 
     // Since this is a demo mode, we are only concerned with the single
-    //  Jingle. Best to start by clearing Steam Controller Jingle Data in
-    //  controller RAM
-    QString cmd("jingle clear\n");
-    QString resp = cmd + "\rJingle data cleared successfully.\n\r";
-    if (serial.send(cmd, resp)) {
-        QMessageBox::information(this, tr("Error"),
-            tr("Failed to clear Jingle Data."));
-        return;
-    }
-
-    // Since we clear before add Jingle, it will always be at index 0
-    Composition::ErrorCode comp_err_code = composition->download(serial, 0);
+    //  Jingle. Replace Steam Controller Jingle Data in controller RAM with
+    //  Jingle Data containing only this Jingle (at index 0)
+    const bool compact = ui->compactFormatCheckBox->isChecked();
+    const std::vector<uint8_t> jingle_data = Composition::buildJingleData(
+        std::vector<Composition*>(1, composition), compact);
+    Composition::ErrorCode comp_err_code = Composition::upload(serial, jingle_data);
     if (comp_err_code != Composition::NO_ERROR) {
         QMessageBox::information(this, tr("Error"),
             tr("Cannot download to %1.\n\nError: %2")
@@ -153,8 +146,8 @@ void MainWindow::on_playJinglePushButton_clicked() {
     }
 
     // Now instruct the Controller to play the Jingle downloaded to index 0
-    cmd = "jingle play 0\n";
-    resp = cmd + "\rJingle play started successfully.\n\r";
+    QString cmd("jingle play 0\n");
+    QString resp = cmd + "\rJingle play started successfully.\n\r";
     if (serial.send(cmd, resp)) {
         QMessageBox::information(this, tr("Error"),
             tr("Failed to send play command."));
@@ -273,11 +266,7 @@ void MainWindow::on_convertPushButton_clicked()
 void MainWindow::updateMemUsage() {
     const int PROG_BAR_MAX = 100;
 
-    uint32_t num_bytes = Composition::EEPROM_HDR_NUM_BYTES;
-
-    for (uint32_t comp_idx = 0; comp_idx < compositions.size(); comp_idx++) {
-        num_bytes += compositions[comp_idx].getMemUsage();
-    }
+    uint32_t num_bytes = getMemUsage();
 
     if (num_bytes >= Composition::MAX_EEPROM_BYTES) {
         ui->memUsageProgressBar->setValue(PROG_BAR_MAX);
@@ -296,6 +285,41 @@ void MainWindow::updateMemUsage() {
     ui->memUsageCurrBytesLabel->repaint();
 }
 
+/**
+ * @brief MainWindow::getMemUsage Calculate how many bytes of EEPROM Jingle Data
+ *      will take up given the currently selected Jingle Data format.
+ *
+ * @param[in] composition Only count this Composition. nullptr counts all
+ *      Compositions.
+ *
+ * @return Number of bytes, including header, Jingle Data requires.
+ */
+uint32_t MainWindow::getMemUsage(Composition* composition) {
+    const bool compact = ui->compactFormatCheckBox->isChecked();
+
+    uint32_t num_bytes = compact ? Composition::EEPROM_HDR_V2_NUM_BYTES :
+        Composition::EEPROM_HDR_NUM_BYTES;
+
+    if (composition) {
+        return num_bytes + composition->getMemUsage(compact);
+    }
+
+    // Identical Jingles/streams are shared, so build blob to get exact size
+    std::vector<Composition*> comps;
+    for (uint32_t comp_idx = 0; comp_idx < compositions.size(); comp_idx++) {
+        comps.push_back(&compositions[comp_idx]);
+    }
+    num_bytes = static_cast<uint32_t>(Composition::buildJingleData(comps, compact).size());
+
+    // Compositions past MAX_NUM_COMPS are dropped from blob, but still count
+    for (uint32_t comp_idx = Composition::MAX_NUM_COMPS; comp_idx < compositions.size();
+            comp_idx++) {
+        num_bytes += compositions[comp_idx].getMemUsage(compact);
+    }
+
+    return num_bytes;
+}
+
 /**
  * @brief MainWindow::updateCompositionDisplay This updates the GUI elements that are
  *      specific to the selected Composition. When a Composition is selected (or new
@@ -828,10 +852,7 @@ void MainWindow::on_saveJinglesPushButton_clicked()
     }
 
     // Make sure there is enough memory to download all Jingle Data...
-    uint32_t num_bytes = Composition::EEPROM_HDR_NUM_BYTES;
-    for (uint32_t comp_idx = 0; comp_idx < compositions.size(); comp_idx++) {
-        num_bytes += compositions[comp_idx].getMemUsage();
-    }
+    uint32_t num_bytes = getMemUsage();
 
     if (num_bytes > Composition::MAX_EEPROM_BYTES) {
         QMessageBox::information(this, tr("Error"),
@@ -842,31 +863,25 @@ void MainWindow::on_saveJinglesPushButton_clicked()
         return;
     }
 
-    // Start fresh with Jingle Data in RAM
-    QString cmd("jingle clear\n");
-    QString resp = cmd + "\rJingle data cleared successfully.\n\r";
-    if (serial.send(cmd, resp)) {
+    // Replace Jingle Data in RAM with all Jingles in a single transfer
+    const bool compact = ui->compactFormatCheckBox->isChecked();
+    std::vector<Composition*> comps;
+    for (uint32_t comp_idx = 0; comp_idx < compositions.size(); comp_idx++) {
+        comps.push_back(&compositions[comp_idx]);
+    }
+    const std::vector<uint8_t> jingle_data = Composition::buildJingleData(comps, compact);
+    Composition::ErrorCode comp_err_code = Composition::upload(serial, jingle_data);
+    if (comp_err_code != Composition::NO_ERROR) {
         QMessageBox::information(this, tr("Error"),
-            tr("Failed to clear Jingle Data."));
+            tr("Failed uploading Jingle Data via %1.\n\nError: %2")
+            .arg(serial_port_name)
+            .arg(Composition::getErrorString(comp_err_code)));
         return;
     }
 
-    // Attempt to write each Jingle to RAM
-    for (uint32_t comp_idx = 0; comp_idx < compositions.size(); comp_idx++) {
-        Composition::ErrorCode comp_err_code = compositions[comp_idx].download(serial, comp_idx);
-        if (comp_err_code != Composition::NO_ERROR) {
-            QMessageBox::information(this, tr("Error"),
-                tr("Failed downloading Jingle %1 via %2.\n\nError: %3")
-                .arg(comp_idx)
-                .arg(serial_port_name)
-                .arg(Composition::getErrorString(comp_err_code)));
-            return;
-        }
-    }
-
     // Save Jingle data in controller RAM to EEPROM
-    cmd = "jingle eeprom save\n";
-    resp = cmd + "\rSave complete\n\r";
+    QString cmd("jingle eeprom save\n");
+    QString resp = cmd + "\rSave complete\n\r";
     if (serial.send(cmd, resp, 100)) {
         QMessageBox::information(this, tr("Error"),
             tr("Failed to save Jingle Data."));
@@ -900,3 +915,19 @@ void MainWindow::on_noteIntensityLineEdit_editingFinished()
 
     composition->setNoteIntensity(note_intensity);
 }
+
+/**
+ * @brief MainWindow::on_compactFormatCheckBox_toggled User is selecting whether
+ *      Jingle Data is sent in compact (v2) format. Compact format fits more Notes,
+ *      but is only understood by OpenSteamController FW.
+ *
+ * @param checked True if compact format is selected.
+ *
+ * @return None.
+ */
+void MainWindow::on_compactFormatCheckBox_toggled(bool checked)
+{
+    qDebug() << "Compact Jingle Data format " << (checked ? "enabled" : "disabled");
+
+    updateMemUsage();
+}
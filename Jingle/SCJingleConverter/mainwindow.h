@@ -83,9 +83,12 @@ private slots:
 
     void on_noteIntensityLineEdit_editingFinished();
 
+    void on_compactFormatCheckBox_toggled(bool checked);
+
 private:
     Composition* getSelectedComposition();
 
+    uint32_t getMemUsage(Composition* composition = nullptr);
     void updateMemUsage();
     void updateCompositionDisplay();
     void updateChordComboBox(Composition::Channel chan);
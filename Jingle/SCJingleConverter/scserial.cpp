@@ -28,7 +28,6 @@
 
 #include "scserial.h"
 
-#include <QThread>
 #include <QDebug>
 
 /**
@@ -54,6 +53,10 @@ SCSerial::ErrorCode SCSerial::open() {
         return SERIAL_OPEN;
     }
 
+    // Let Controller FW know someone is listening, so it waits for us to
+    //  read output instead of overwriting it
+    serial.setDataTerminalReady(true);
+
     // Verify we can communicate with the controller
     const QString ver_cmd = "version\n";
     const QString ver_resp = ver_cmd + "\rOpenSteamController Ver 1.1.\n\r";
@@ -108,10 +111,49 @@ SCSerial::ErrorCode SCSerial::send(QString command, QString response, int fullRe
 
     qDebug() << command;
 
-    // Pause after each command to avoid overflowing NXP's faulty USB CDC UART stack
-    // This can be removed if USB CDC UART stack issues are ever fixed
-//TODO: how much can we decrease this?
-    QThread::msleep(5);
+    // No pause needed between commands. Firmware NAKs the host until it has
+    //  room for more data, so nothing is dropped (see Firmware/tests)
+
+    return NO_ERROR;
+}
+
+/**
+ * @brief SCSerial::sendData Send raw (binary) data to the Steam Controller. This
+ *      is for commands that read a payload after being sent (i.e. jingle load).
+ *
+ * @param data Data to send to Steam Controller.
+ * @param response Expected response from Steam Controller after sending data.
+ * @param fullRespDelay Number of ms after initial response to wait for all response
+ *      values to be received.
+ *
+ * @return SCSerial::ErrorCode
+ */
+SCSerial::ErrorCode SCSerial::sendData(const QByteArray& data, QString response, int fullRespDelay) {
+    serial.write(data);
+
+    if (!serial.waitForBytesWritten(250)) {
+        qDebug() << "serial.waitForBytesWritten() error: " << serial.error();
+        return COMMAND_SEND_TIMEOUT;
+    }
+
+    if (!serial.waitForReadyRead(250)) {
+        qDebug() << "serial.waitForReadyRead() error: " << serial.error();
+        return RESPONSE_RCV_TIMEOUT;
+    }
+
+    QByteArray response_data = serial.readAll();
+    while (serial.waitForReadyRead(fullRespDelay)) {
+        response_data += serial.readAll();
+    }
+
+    const QString rcvd_response = QString::fromUtf8(response_data);
+    if (rcvd_response != response) {
+        qDebug() << "expected response = " << response;
+        qDebug() << "rcvd_response = " << rcvd_response;
+        return RESPONSE_MISMATCH;
+    }
+
+    qDebug() << "Sent " << data.size() << " bytes of data";
 
     return NO_ERROR;
 }
@@ -72,6 +72,7 @@ public:
 
     ErrorCode open();
     ErrorCode send(QString command, QString response, int fullRespDelay=10);
+    ErrorCode sendData(const QByteArray& data, QString response, int fullRespDelay=10);
 
 private:
     QSerialPort serial; // Allows for sending command strings and receiving responses.
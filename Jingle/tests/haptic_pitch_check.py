@@ -0,0 +1,124 @@
+#!/usr/bin/env python3
+#
+# haptic_pitch_check.py
+#
+# Host side check of haptic pitch accuracy. Mirrors the integer math used by
+#  startHapticNote() and nextHapticState() in Firmware/OpenSteamController/
+#  src/haptic.c to compute the pitch actually generated for each Note across
+#  the musical range and compares it to the requested frequency.
+#
+# MIT License
+#
+# Copyright (c) 2019 Gregory Gluszek
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+import argparse
+import math
+import sys
+
+CORE_CLK = 48000000 # SystemCoreClock of LPC11U37 in Steam Controller
+NOTE_NAMES = ["C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B"]
+
+def midiToFreq(midi):
+	'Equal tempered frequency of a MIDI note number (A4 = 69 = 440Hz)'
+	return 440.0 * 2.0 ** ((midi - 69) / 12.0)
+
+def midiToName(midi):
+	return NOTE_NAMES[midi % 12] + str(midi // 12 - 1)
+
+def cents(actual, expected):
+	return 1200.0 * math.log(actual / expected, 2)
+
+def usTimerFreq(pulseFreq):
+	'Pitch generated by firmware with 1us timer ticks and whole us periods'
+	period = 1000000 // pulseFreq
+	return 1000000.0 / period
+
+def clkTimerFreq(pulseFreq, durationMs):
+	'Pitch generated by firmware with core clock ticks and Q16 period fraction'
+	period = CORE_CLK // pulseFreq
+	frac = ((CORE_CLK % pulseFreq) << 16) // pulseFreq
+	numPulses = durationMs * (CORE_CLK // 1000) // period
+	if numPulses < 2:
+		return CORE_CLK / float(period)
+
+	# Last period of a Note is always low, so only pulses that are started
+	#  count towards pitch
+	acc = 0
+	ticks = 0
+	for i in range(numPulses - 1):
+		acc += frac
+		ticks += period + (acc >> 16)
+		acc &= 0xFFFF
+	return CORE_CLK * (numPulses - 1) / float(ticks)
+
+def main(argv):
+	parser = argparse.ArgumentParser(description="Compare pitch generated "
+		"by haptic firmware to requested frequency across musical range.")
+	parser.add_argument("--low", type=int, default=21,
+		help="Lowest MIDI note to check (default A0 = 21)")
+	parser.add_argument("--high", type=int, default=108,
+		help="Highest MIDI note to check (default C8 = 108)")
+	parser.add_argument("--duration", type=int, default=500,
+		help="Note duration in ms used to average pitch (default 500)")
+	parser.add_argument("--max-cents", type=float, default=1.0,
+		help="Fail if core clock timer error exceeds this (default 1.0)")
+	parser.add_argument("--quiet", action="store_true",
+		help="Only print summary")
+	args = parser.parse_args(argv)
+
+	if not args.quiet:
+		print("%-5s %10s %9s %10s %10s %10s" % ("Note", "Requested",
+			"pulseFreq", "1us cents", "clk cents", "Hz cents"))
+
+	max_us = 0.0
+	max_clk = 0.0
+	for midi in range(args.low, args.high + 1):
+		req = midiToFreq(midi)
+		# SCJingleConverter truncates to whole Hz for Note.pulseFreq
+		pulse_freq = int(req)
+		if pulse_freq < 1 or pulse_freq > 65535:
+			continue
+
+		# Timer error is relative to pulseFreq, as that is all the
+		#  firmware is given. Hz error is what Note format costs on top
+		us_err = cents(usTimerFreq(pulse_freq), pulse_freq)
+		clk_err = cents(clkTimerFreq(pulse_freq, args.duration), pulse_freq)
+		hz_err = cents(pulse_freq, req)
+
+		max_us = max(max_us, abs(us_err))
+		max_clk = max(max_clk, abs(clk_err))
+
+		if not args.quiet:
+			print("%-5s %10.3f %9d %10.3f %10.3f %10.3f" % (
+				midiToName(midi), req, pulse_freq, us_err, clk_err, hz_err))
+
+	print("Max timer error with 1us ticks: %.3f cents" % max_us)
+	print("Max timer error with core clock ticks: %.3f cents" % max_clk)
+
+	if max_clk > args.max_cents:
+		print("FAIL: core clock timer error exceeds %.3f cents" %
+			args.max_cents)
+		return 1
+
+	return 0
+
+if __name__ == "__main__":
+	sys.exit(main(sys.argv[1:]))